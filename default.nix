@@ -3,6 +3,8 @@
 rec {
   lvgui = pkgs.callPackage ./support/lvgui.nix {};
   lvgui-simulator = lvgui.override { withSimulator = true; };
+  lvgui-rgb565 = lvgui.override { colorDepth = 16; };
+  lvgui-headless = lvgui.override { withHeadless = true; };
   hello = pkgs.callPackage ./support/hello {
     inherit lvgui;
   };
@@ -1,6 +1,10 @@
 #include <glob.h>
+#include <limits.h>
 #include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include "lvgl/lvgl.h"
 #include "lv_drv_conf.h"
 #include "lv_lib_freetype/lv_freetype.h"
@@ -19,13 +23,39 @@ static lv_obj_t * lvgui_cursor_obj;
 static lv_obj_t * lvgui_touch_obj;
 static lv_group_t * lvgui_focus_group;
 
+#if USE_LIBINPUT
+// Cursors are shown on the display's cursor plane, rather than as objects.
+static bool lvgui_hw_cursor = false;
+#endif
+#if USE_DRM && USE_LIBINPUT
+// Image currently on the cursor plane, and its opacity.
+static const lv_img_dsc_t * lvgui_hw_cursor_img = NULL;
+static lv_opa_t lvgui_hw_cursor_opa = LV_OPA_TRANSP;
+// Fades the touch indicator away. Not an animation, those keep the display
+// refreshing at every vblank while nothing on it changes.
+static lv_task_t * lvgui_hw_cursor_fade_task = NULL;
+#endif
+
 static char* mn_hal_asset_path = "./";
 
+// Input devices whose drivers wake up the main loop through a file descriptor.
+#define HAL_POLL_INDEV_MAX 8
+static lv_indev_t * hal_poll_indevs[HAL_POLL_INDEV_MAX];
+static uint32_t hal_poll_indev_count = 0;
+
+// At most: libinput and its hotplug watch, the DRM card, the flush threads and the SDL thread.
+#define HAL_POLL_FDS_MAX 5
+
+// Size of the draw buffers allocated for the displays, in bytes, and what backs them.
+static size_t hal_disp_buf_bytes = 0;
+static const char * hal_disp_buf_backing_name = "none";
+
 void hal_preinit(void);
 void hal_set_dpi(void);
 void hal_setup_display(void);
 
-#if USE_FBDEV
+#if USE_FBDEV || USE_DRM
+#	include "lv_drivers/display/async_flush.h"
 #	include "lv_drivers/display/fbdev.h"
 #endif
 
@@ -41,6 +71,10 @@ void hal_setup_display(void);
 #	include "lv_drivers/display/monitor.h"
 #endif
 
+#if USE_HEADLESS
+#	include "lv_drivers/display/headless.h"
+#endif
+
 #if USE_MOUSE
 #	include "lv_drivers/indev/mouse.h"
 #endif
@@ -49,11 +83,31 @@ void hal_setup_display(void);
 #	include "lv_drivers/indev/keyboard.h"
 #endif
 
-// irb(main):005:0> (1440 * 2560 * 4)/1024/1024
-//            width * height * bytes MB
-// => 14
-// We can spare 14MiB, it makes the DRM driver behave on SDM845.
-#define DISP_BUF_SIZE (LV_VER_RES_MAX*LV_HOR_RES_MAX)
+#ifndef DISP_BUF_POLICY
+#	define DISP_BUF_POLICY DISP_BUF_POLICY_FULL
+#endif
+#ifndef DISP_BUF_HUGEPAGES
+#	define DISP_BUF_HUGEPAGES 0
+#endif
+
+// Huge pages are only worth it for buffers spanning at least one.
+#define DISP_BUF_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+#if USE_DRM && DRM_MULTI_OUTPUT
+// Drivers of the outputs other than the primary display, mirroring `disp_drv`.
+static lv_disp_drv_t hal_extra_disp_drv[DRM_MAX_OUTPUTS - 1];
+static lv_disp_buf_t hal_extra_disp_buf[DRM_MAX_OUTPUTS - 1];
+static uint32_t hal_extra_disp_count = 0;
+#endif
+
+#if USE_DRM
+// Displays refreshed on page flip completion; see `drm_vblank_sync_init`.
+static lv_disp_t * hal_vblank_disps[DRM_MAX_OUTPUTS];
+static uint32_t hal_vblank_disp_count = 0;
+#	define HAL_PARKED_MAX (HAL_POLL_INDEV_MAX + DRM_MAX_OUTPUTS)
+#else
+#	define HAL_PARKED_MAX HAL_POLL_INDEV_MAX
+#endif
 
 /**
  * Provides a freshly allocated string with the complete path to a given asset.
@@ -120,18 +174,123 @@ void hal_set_dpi()
 	}
 }
 
+/**
+ * Maps `*size` bytes of zeroed, page-aligned, memory for the draw buffer.
+ * `*size` is rounded up to the pages used.
+ */
+static void * hal_alloc_disp_buf(size_t * size)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t len;
+	void * buf;
+
+#if DISP_BUF_HUGEPAGES && defined(MAP_HUGETLB)
+	// Only succeeds when huge pages were reserved on the system.
+	if (*size >= DISP_BUF_HUGEPAGE_SIZE) {
+		len = (*size + DISP_BUF_HUGEPAGE_SIZE - 1) & ~((size_t)DISP_BUF_HUGEPAGE_SIZE - 1);
+		buf = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (buf != MAP_FAILED) {
+			hal_disp_buf_backing_name = "hugetlb";
+			*size = len;
+			return buf;
+		}
+	}
+#endif
+
+	len = (*size + page - 1) & ~(page - 1);
+	buf = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		return NULL;
+	}
+	hal_disp_buf_backing_name = "pages";
+
+#if DISP_BUF_HUGEPAGES && defined(MADV_HUGEPAGE)
+	// Otherwise, ask for transparent huge pages.
+	if (len >= DISP_BUF_HUGEPAGE_SIZE && madvise(buf, len, MADV_HUGEPAGE) == 0) {
+		hal_disp_buf_backing_name = "thp";
+	}
+#endif
+
+	*size = len;
+	return buf;
+}
+
+/**
+ * Allocates the draw buffer, sized by `DISP_BUF_POLICY` from the resolution
+ * the display driver reported.
+ */
+static void hal_setup_disp_buf(lv_disp_drv_t * drv, lv_disp_buf_t * disp_buf)
+{
+	uint32_t width = drv->rotated ? drv->ver_res : drv->hor_res;
+	uint32_t screen = (uint32_t)drv->hor_res * drv->ver_res;
+	uint32_t pixels;
+	size_t size;
+	lv_color_t * buf;
+	bool split = false;
+
+#if DISP_BUF_POLICY == DISP_BUF_POLICY_LINES
+	pixels = width * DISP_BUF_LINES;
+#elif DISP_BUF_POLICY == DISP_BUF_POLICY_FRACTION
+	pixels = screen / DISP_BUF_FRACTION;
+#else
+	pixels = screen;
+#endif
+	// At least a line, at most the screen.
+	pixels = LV_MATH_MIN(LV_MATH_MAX(pixels, width), screen);
+
+#if (USE_FBDEV || USE_DRM) && DISP_ASYNC_FLUSH
+	{
+		async_flush_cb_t flush_area = fbdev_flush_area;
+#if USE_DRM
+		if (drv->flush_cb == drm_flush) {
+			flush_area = drm_flush_area;
+		}
+#endif
+		// Each half is rendered into while the other is flushed.
+		split = pixels >= 2 * width && async_flush_init(drv, flush_area);
+	}
+#endif
+
+	size = pixels * sizeof(lv_color_t);
+	buf = hal_alloc_disp_buf(&size);
+	if (buf == NULL) {
+		LV_LOG_ERROR("Could not allocate the draw buffer");
+		abort();
+	}
+	hal_disp_buf_bytes += size;
+
+	if (split) {
+		lv_disp_buf_init(disp_buf, buf, buf + pixels / 2, pixels / 2);
+	}
+	else {
+		lv_disp_buf_init(disp_buf, buf, NULL, pixels);
+	}
+
+#if LV_LOG_LEVEL <= LV_LOG_LEVEL_INFO
+	printf("[LVGUI:HAL] Draw buffer: %u pixels (%u lines)%s, %zu bytes of %s\n",
+		pixels, pixels / width, split ? " in two halves" : "", size, hal_disp_buf_backing_name
+	);
+#endif
+}
+
+size_t hal_disp_buf_size(void)
+{
+	return hal_disp_buf_bytes;
+}
+
+const char * hal_disp_buf_backing(void)
+{
+	return hal_disp_buf_backing_name;
+}
+
 // Initializes the display, but does **not** register
 // with lvgl. This will be registered once lvgl is initialized.
 // This allows us to use the display driver information for
 // things like setting up the DPI.
 void hal_setup_display()
 {
-	/*A small buffer for LittlevGL to draw the screen's content*/
-	static lv_color_t buf[DISP_BUF_SIZE];
-
-	/*Initialize a descriptor for the buffer*/
+	/*Initialize a descriptor for the buffer; allocated once the resolution is known*/
 	static lv_disp_buf_t disp_buf;
-	lv_disp_buf_init(&disp_buf, buf, NULL, DISP_BUF_SIZE);
 
 	/*Initialize and register a display driver*/
 	lv_disp_drv_init(&disp_drv);
@@ -147,6 +306,9 @@ void hal_setup_display()
 #if USE_MONITOR
     disp_drv.flush_cb = monitor_flush;
 #endif
+#if USE_HEADLESS
+	disp_drv.flush_cb = headless_flush;
+#endif
 
 	// As it's possible the driver re-configures it...
 #if USE_FBDEV
@@ -154,19 +316,206 @@ void hal_setup_display()
 #endif
 #if USE_DRM
 	drm_init(&disp_drv);
+	// Unless falling back to fbdev, try rendering straight into the scanout buffers.
+	if (disp_drv.flush_cb == drm_flush && drm_init_disp_buf(&disp_buf)) {
+		hal_disp_buf_backing_name = "scanout";
+	}
 #endif
 #if USE_MONITOR
     monitor_init();
     monitor_set_resolution(&disp_drv);
 #endif
+#if USE_HEADLESS
+	headless_init(&disp_drv);
+#endif
+
+	if (disp_buf.buf1 == NULL) {
+		hal_setup_disp_buf(&disp_drv, &disp_buf);
+	}
+
+#if USE_DRM && DRM_MULTI_OUTPUT
+	// The other outputs get their own display; rendering into the scanout
+	// buffers is only done for the primary one.
+	if (disp_drv.flush_cb == drm_flush) {
+		uint32_t i;
+		lv_disp_drv_t * drv;
+
+		for (i = 1; i < drm_get_output_count() && hal_extra_disp_count < DRM_MAX_OUTPUTS - 1; i++) {
+			drv = &hal_extra_disp_drv[hal_extra_disp_count];
+			lv_disp_drv_init(drv);
+			drv->buffer = &hal_extra_disp_buf[hal_extra_disp_count];
+			if (!drm_init_output(drv, i)) {
+				continue;
+			}
+			hal_setup_disp_buf(drv, drv->buffer);
+			hal_extra_disp_count++;
+		}
+	}
+#endif
+}
+
+#if USE_DRM && USE_LIBINPUT
+static void hal_hw_cursor_show(const lv_img_dsc_t * img, lv_opa_t opa)
+{
+	if (img != lvgui_hw_cursor_img || opa != lvgui_hw_cursor_opa) {
+		drm_cursor_set_image(img, opa);
+		lvgui_hw_cursor_img = img;
+		lvgui_hw_cursor_opa = opa;
+	}
+	drm_cursor_set_hidden(opa == LV_OPA_TRANSP);
+}
+
+// Same timing as the unclutter animation of the touch indicator object.
+#define HAL_HW_CURSOR_FADE_DELAY 500
+#define HAL_HW_CURSOR_FADE_TIME 300
+
+// Task fading the touch indicator on the cursor plane, once the delay elapsed.
+static void hal_hw_cursor_fade(lv_task_t * task)
+{
+	static uint32_t start;
+	lv_anim_t a;
+
+	// The pointer took over the cursor plane since.
+	if (lvgui_hw_cursor_img != &lvgui_touch) {
+		lv_task_pause(task);
+		return;
+	}
+
+	// The delay elapsed, fading steps follow at the refresh rate.
+	if (task->period == HAL_HW_CURSOR_FADE_DELAY) {
+		lv_task_set_period(task, LV_DISP_DEF_REFR_PERIOD);
+		start = lv_tick_get();
+	}
+
+	// Eased like the animation of the touch indicator object.
+	lv_anim_init(&a);
+	lv_anim_set_time(&a, HAL_HW_CURSOR_FADE_TIME, 0);
+	lv_anim_set_values(&a, LV_OPA_COVER, LV_OPA_TRANSP);
+	a.act_time = LV_MATH_MIN(lv_tick_elaps(start), HAL_HW_CURSOR_FADE_TIME);
+	hal_hw_cursor_show(&lvgui_touch, lv_anim_path_ease_in(&a));
+
+	if (a.act_time == a.time) {
+		lv_task_pause(task);
+	}
+}
+
+// Restarts fading the touch indicator, from the delay.
+static void hal_hw_cursor_fade_restart(void)
+{
+	lv_task_set_period(lvgui_hw_cursor_fade_task, HAL_HW_CURSOR_FADE_DELAY);
+	lv_task_reset(lvgui_hw_cursor_fade_task);
+	lv_task_resume(lvgui_hw_cursor_fade_task);
+}
+
+/**
+ * Reads a pointer device, and moves the cursor plane as LVGL would move the
+ * cursor object. This way moving the pointer does not redraw anything.
+ */
+static bool hal_libinput_read_hw_cursor(lv_indev_drv_t * indev_drv, lv_indev_data_t * data)
+{
+	libinput_drv_instance * instance = indev_drv->user_data;
+	const lv_img_dsc_t * img = instance->is_touchscreen ? &lvgui_touch : &lvgui_cursor;
+	lv_indev_t * indev = NULL;
+	bool ret;
+
+	ret = libinput_read(indev_drv, data);
+
+	while ((indev = lv_indev_get_next(indev))) {
+		if (&indev->driver == indev_drv) {
+			break;
+		}
+	}
+	if (!indev) {
+		return ret;
+	}
+
+	if (
+		data->point.x != indev->proc.pointer.act_point.x ||
+		data->point.y != indev->proc.pointer.act_point.y
+	) {
+		drm_cursor_move(
+			data->point.x + indev->cursor_offset.x,
+			data->point.y + indev->cursor_offset.y
+		);
+		hal_hw_cursor_show(img, LV_OPA_COVER);
+
+		if (instance->is_touchscreen) {
+			hal_hw_cursor_fade_restart();
+		}
+	}
+
+	return ret;
+}
+#endif
+
+/**
+ * Registers an input device fed by the SDL thread or a file descriptor from
+ * `hal_get_poll_fds`, whose read task only runs once woken up by `hal_poll_ready`.
+ */
+static void hal_add_poll_indev(lv_indev_t * indev)
+{
+	if (hal_poll_indev_count == HAL_POLL_INDEV_MAX) {
+		// Its read task keeps running on its period.
+		return;
+	}
+
+	hal_poll_indevs[hal_poll_indev_count++] = indev;
 }
 
 #if USE_LIBINPUT
-static void hal_add_libinput_device(char* dev_path)
+// Input devices getting the events of each kind of libinput devices.
+static lv_indev_t * hal_libinput_indevs[LIBINPUT_DRV_KIND_COUNT];
+
+/**
+ * Gets the orientation of the panel from the driver of the primary display,
+ * so direct input devices are rotated along it.
+ */
+static libinput_drv_orientation_t hal_get_libinput_orientation(void)
+{
+#if USE_DRM
+	if (disp_drv.flush_cb == drm_flush) {
+		switch (drm_display_orientation) {
+			case DRM_ORIENTATION_UPSIDE_DOWN:
+				return LIBINPUT_DRV_ORIENTATION_UPSIDE_DOWN;
+			case DRM_ORIENTATION_CLOCKWISE:
+				return LIBINPUT_DRV_ORIENTATION_CLOCKWISE;
+			case DRM_ORIENTATION_COUNTER_CLOCKWISE:
+				return LIBINPUT_DRV_ORIENTATION_COUNTER_CLOCKWISE;
+			case DRM_ORIENTATION_NORMAL:
+				break;
+		}
+		return LIBINPUT_DRV_ORIENTATION_NORMAL;
+	}
+#endif
+#if USE_FBDEV || USE_DRM
+	// fbdev follows the console rotation, also when DRM falls back to it.
+	if (disp_drv.flush_cb == fbdev_flush) {
+		switch (fbdev_get_rotation()) {
+			case BLIT_ROTATE_180:
+				return LIBINPUT_DRV_ORIENTATION_UPSIDE_DOWN;
+			case BLIT_ROTATE_CW:
+				return LIBINPUT_DRV_ORIENTATION_CLOCKWISE;
+			case BLIT_ROTATE_CCW:
+				return LIBINPUT_DRV_ORIENTATION_COUNTER_CLOCKWISE;
+			case BLIT_ROTATE_0:
+				break;
+		}
+		return LIBINPUT_DRV_ORIENTATION_NORMAL;
+	}
+#endif
+
+	return LIBINPUT_DRV_ORIENTATION_NORMAL;
+}
+
+/**
+ * Registers the input device getting the events of a kind of libinput devices.
+ * Nothing is done until a device of that kind is added, or once it's registered.
+ */
+static void hal_add_libinput_indev(libinput_drv_kind_t kind)
 {
-	libinput_drv_instance* instance = libinput_init_drv(dev_path);
+	libinput_drv_instance* instance = libinput_drv_get_instance(kind);
 
-	if (instance == NULL) {
+	if (instance == NULL || hal_libinput_indevs[kind]) {
 		return;
 	}
 
@@ -176,10 +525,16 @@ static void hal_add_libinput_device(char* dev_path)
 	indev_drv.type = instance->lv_indev_drv_type;
 	indev_drv.read_cb = libinput_read;
 	indev_drv.user_data = instance;
+#if USE_DRM
+	if (lvgui_hw_cursor && (instance->is_pointer || instance->is_touchscreen)) {
+		indev_drv.read_cb = hal_libinput_read_hw_cursor;
+	}
+#endif
 	lv_indev_t * indev = lv_indev_drv_register(&indev_drv);
+	hal_libinput_indevs[kind] = indev;
 
 	// Add a "regular" cursor for touchpads and mice.
-	if (instance->is_pointer) {
+	if (instance->is_pointer && !lvgui_hw_cursor) {
 		lv_indev_set_cursor(indev, lvgui_cursor_obj);
 		lv_obj_set_hidden(lvgui_cursor_obj, true);
 	}
@@ -193,25 +548,62 @@ static void hal_add_libinput_device(char* dev_path)
 		indev->cursor_offset.x = -1 * lvgui_touch.header.w/2;
 		indev->cursor_offset.y = -1 * lvgui_touch.header.h/2;
 
-		lv_indev_set_cursor(indev, lvgui_touch_obj);
-		// Start hidden, there may be a touchscreen that never gets used.
-		// Additionally helps with "one-shot" uses like for splash screens.
-		lv_obj_set_hidden(lvgui_touch_obj, true);
+		if (!lvgui_hw_cursor) {
+			lv_indev_set_cursor(indev, lvgui_touch_obj);
+			// Start hidden, there may be a touchscreen that never gets used.
+			// Additionally helps with "one-shot" uses like for splash screens.
+			lv_obj_set_hidden(lvgui_touch_obj, true);
+		}
 
 		// Setup an animation to "unclutter" (make the cursor disappear)
-		lv_anim_t * a;
-		a = lv_mem_alloc(sizeof(lv_anim_t));
-		indev->cursor_unclutter_animation = a;
-		lv_anim_init(a);
-		lv_anim_set_exec_cb(a, lvgui_touch_obj, (lv_anim_exec_xcb_t)lv_obj_set_opa_scale);
-		// 400ms after the move, take 500ms to disappear.
-		lv_anim_set_time(a, 300, 500);
-		lv_anim_set_values(a, 255, 0);
-		lv_anim_set_path_cb(a, lv_anim_path_ease_in);
+		// The cursor plane is faded by its own task instead.
+		if (!lvgui_hw_cursor) {
+			lv_anim_t * a;
+			a = lv_mem_alloc(sizeof(lv_anim_t));
+			indev->cursor_unclutter_animation = a;
+			lv_anim_init(a);
+			lv_anim_set_exec_cb(a, lvgui_touch_obj, (lv_anim_exec_xcb_t)lv_obj_set_opa_scale);
+			// 500ms after the move, take 300ms to disappear.
+			lv_anim_set_time(a, 300, 500);
+			lv_anim_set_values(a, 255, 0);
+			lv_anim_set_path_cb(a, lv_anim_path_ease_in);
+		}
 	}
 
 	// Link the input device to the main focus group.
 	lv_indev_set_group(indev, lvgui_focus_group);
+
+	hal_add_poll_indev(indev);
+}
+
+/**
+ * Follows the devices being plugged and unplugged.
+ * The input devices of LVGL cannot be unregistered: they stay, released
+ * and idle, until a device of their kind comes back.
+ */
+static void hal_libinput_hotplug(void)
+{
+	libinput_drv_kind_t kind;
+
+	if (!libinput_drv_hotplug_dispatch()) {
+		return;
+	}
+
+	for (kind = 0; kind < LIBINPUT_DRV_KIND_COUNT; kind++) {
+		hal_add_libinput_indev(kind);
+	}
+
+	// Nothing left to move the cursor.
+	if (libinput_drv_get_device_count(LIBINPUT_DRV_POINTER) == 0) {
+		if (!lvgui_hw_cursor) {
+			lv_obj_set_hidden(lvgui_cursor_obj, true);
+		}
+#if USE_DRM
+		else if (lvgui_hw_cursor_img == &lvgui_cursor) {
+			hal_hw_cursor_show(&lvgui_cursor, LV_OPA_TRANSP);
+		}
+#endif
+	}
 }
 #endif
 
@@ -246,7 +638,28 @@ void hal_init(const char* asset_path)
 	// Finish initializing hardware.
 	LV_LOG_INFO("HAL begins");
 
-	lv_disp_drv_register(&disp_drv);
+	lv_disp_t * disp = lv_disp_drv_register(&disp_drv);
+
+#if USE_DRM
+	if (disp_drv.flush_cb == drm_flush && drm_vblank_sync_init(disp)) {
+		hal_vblank_disps[hal_vblank_disp_count++] = disp;
+	}
+#if DRM_MULTI_OUTPUT
+	{
+		uint32_t i;
+
+		// The primary display, registered first, stays the default one screens are created on.
+		for (i = 0; i < hal_extra_disp_count; i++) {
+			disp = lv_disp_drv_register(&hal_extra_disp_drv[i]);
+			if (drm_vblank_sync_init(disp)) {
+				hal_vblank_disps[hal_vblank_disp_count++] = disp;
+			}
+		}
+	}
+#endif
+#else
+	(void) disp;
+#endif
 
 	{
 	// Prepare the "main" focus group
@@ -277,14 +690,45 @@ void hal_init(const char* asset_path)
 	lv_obj_set_opa_scale_enable(lvgui_touch_obj, true);
 	}
 
+#if USE_DRM && USE_LIBINPUT
+	// Prefer the cursor plane, so moving cursors does not redraw the UI.
+	if (disp_drv.flush_cb == drm_flush) {
+		lvgui_hw_cursor =
+			drm_cursor_init() &&
+			drm_cursor_set_image(&lvgui_cursor, LV_OPA_COVER) &&
+			drm_cursor_set_image(&lvgui_touch, LV_OPA_COVER)
+		;
+		drm_cursor_set_hidden(true);
+		if (lvgui_hw_cursor) {
+			lvgui_hw_cursor_fade_task = lv_task_create(hal_hw_cursor_fade, HAL_HW_CURSOR_FADE_DELAY, LV_TASK_PRIO_MID, NULL);
+			lv_task_pause(lvgui_hw_cursor_fade_task);
+		}
+	}
+#endif
+
 #if USE_LIBINPUT
 	{
 		char **dev_path;
 		size_t cnt;
 		glob_t globbuf;
-		glob("/dev/input/event*", 0, NULL, &globbuf);
+		libinput_drv_kind_t kind;
+
+		// Direct input devices are rotated along the primary display.
+		libinput_drv_set_orientation(hal_get_libinput_orientation());
+
+		// Devices plugged from now on are added as they come...
+		libinput_drv_hotplug_init();
+
+		// ... like the ones already there. All devices share one libinput context...
+		glob(LIBINPUT_DRV_HOTPLUG_DIR "/event*", 0, NULL, &globbuf);
 		for (dev_path = globbuf.gl_pathv, cnt = globbuf.gl_pathc; cnt; dev_path++, cnt--) {
-			hal_add_libinput_device(*dev_path);
+			libinput_drv_add_device(*dev_path);
+		}
+		globfree(&globbuf);
+
+		// ... and their events go to one input device per kind.
+		for (kind = 0; kind < LIBINPUT_DRV_KIND_COUNT; kind++) {
+			hal_add_libinput_indev(kind);
 		}
 	}
 #endif
@@ -299,6 +743,9 @@ void hal_init(const char* asset_path)
 	lv_indev_t * indev = lv_indev_drv_register(&indev_drv);
 	// Link the input device to the main focus group.
 	lv_indev_set_group(indev, lvgui_focus_group);
+#if USE_MONITOR
+	hal_add_poll_indev(indev);
+#endif
 	}
 #endif
 #if USE_KEYBOARD
@@ -311,12 +758,190 @@ void hal_init(const char* asset_path)
 	lv_indev_t * indev = lv_indev_drv_register(&indev_drv);
 	// Link the input device to the main focus group.
 	lv_indev_set_group(indev, lvgui_focus_group);
+#if USE_MONITOR
+	hal_add_poll_indev(indev);
+#endif
 	}
 #endif
 
 	LV_LOG_INFO("HAL Finished");
 }
 
+/**
+ * Tells whether an input device only has something to do once a new event arrives.
+ * Long presses, key repeats and drag throws go on without new events.
+ */
+static bool hal_indev_is_idle(lv_indev_t * indev)
+{
+	return indev->proc.state == LV_INDEV_STATE_REL && !indev->proc.pointer.drag_in_prog;
+}
+
+/**
+ * Empties an eventfd, or a pipe.
+ */
+static void hal_drain_fd(int fd)
+{
+	uint64_t buf[8];
+
+	while (read(fd, buf, sizeof(buf)) > 0) {
+	}
+}
+
+int hal_get_poll_fds(int * fds, int max)
+{
+	int all[HAL_POLL_FDS_MAX];
+	int count = 0;
+	int found = 0;
+	int i;
+
+#if USE_LIBINPUT
+	all[count++] = libinput_drv_get_fd();
+	all[count++] = libinput_drv_get_hotplug_fd();
+#endif
+#if USE_DRM
+	// Page flips are otherwise waited on by the refresh itself.
+	all[count++] = hal_vblank_disp_count ? drm_get_fd() : -1;
+#endif
+#if USE_FBDEV || USE_DRM
+	all[count++] = async_flush_get_fd();
+#endif
+#if USE_MONITOR
+	all[count++] = monitor_get_fd();
+#endif
+
+	for (i = 0; i < count && found < max; i++) {
+		if (all[i] >= 0) {
+			fds[found++] = all[i];
+		}
+	}
+
+	return found;
+}
+
+int hal_get_poll_timeout(void)
+{
+	lv_task_t * parked[HAL_PARKED_MAX];
+	uint32_t parked_count = 0;
+#if USE_DRM
+	bool flip_pending = false;
+#endif
+	uint32_t timeout;
+	uint32_t i;
+
+	// Tasks waiting on a file descriptor have nothing to do until it's readable,
+	// whatever their period; they are left out while looking for the next one due.
+	for (i = 0; i < hal_poll_indev_count; i++) {
+		lv_task_t * task = hal_poll_indevs[i]->driver.read_task;
+		if (!task->paused && hal_indev_is_idle(hal_poll_indevs[i])) {
+			lv_task_pause(task);
+			parked[parked_count++] = task;
+		}
+	}
+#if USE_DRM
+	for (i = 0; i < hal_vblank_disp_count; i++) {
+		lv_task_t * task = hal_vblank_disps[i]->refr_task;
+		if (!task->paused && drm_is_waiting(hal_vblank_disps[i])) {
+			lv_task_pause(task);
+			parked[parked_count++] = task;
+			flip_pending = true;
+		}
+	}
+#endif
+
+	timeout = lv_task_get_time_till_next();
+
+	for (i = 0; i < parked_count; i++) {
+		lv_task_resume(parked[i]);
+	}
+
+#if USE_DRM
+	// Lets the refresh notice lost page flip events.
+	if (flip_pending && timeout > DRM_FLIP_TIMEOUT_MS) {
+		timeout = DRM_FLIP_TIMEOUT_MS;
+	}
+#endif
+
+	if (timeout == LV_NO_TASK_READY) {
+		return -1;
+	}
+
+	return timeout > INT_MAX ? INT_MAX : (int)timeout;
+}
+
+void hal_poll_ready(void)
+{
+	uint32_t i;
+
+#if USE_FBDEV || USE_DRM
+	if (async_flush_get_fd() >= 0) {
+		hal_drain_fd(async_flush_get_fd());
+	}
+#endif
+#if USE_MONITOR
+	if (monitor_get_fd() >= 0) {
+		hal_drain_fd(monitor_get_fd());
+	}
+#endif
+#if USE_LIBINPUT
+	hal_libinput_hotplug();
+	// Even for disabled input devices, the file descriptor has to be read.
+	libinput_drv_dispatch();
+#endif
+#if USE_DRM
+	// Page flip completions are handled by the refresh, even when idle.
+	for (i = 0; i < hal_vblank_disp_count; i++) {
+		lv_task_resume(hal_vblank_disps[i]->refr_task);
+	}
+#endif
+
+	// Read new events right away, rather than once the read period elapsed.
+	for (i = 0; i < hal_poll_indev_count; i++) {
+		lv_task_ready(hal_poll_indevs[i]->driver.read_task);
+	}
+}
+
+void hal_run(bool (*cb)(void * user_data), void * user_data)
+{
+	struct epoll_event events[HAL_POLL_FDS_MAX];
+	struct epoll_event event;
+	int fds[HAL_POLL_FDS_MAX];
+	int count;
+	int epfd;
+	int i;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0) {
+		LV_LOG_ERROR("Could not create the epoll instance of the main loop");
+		abort();
+	}
+
+	count = hal_get_poll_fds(fds, HAL_POLL_FDS_MAX);
+	for (i = 0; i < count; i++) {
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = fds[i];
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &event) < 0) {
+			LV_LOG_ERROR("Could not wait on a file descriptor of the main loop");
+			abort();
+		}
+	}
+
+	for (;;) {
+		lv_task_handler();
+
+		if (cb && !cb(user_data)) {
+			break;
+		}
+
+		// Interrupted by a signal, or timed out: the tasks know what to do.
+		if (epoll_wait(epfd, events, HAL_POLL_FDS_MAX, hal_get_poll_timeout()) > 0) {
+			hal_poll_ready();
+		}
+	}
+
+	close(epfd);
+}
+
 /*Set in lv_conf.h as `LV_TICK_CUSTOM_SYS_TIME_EXPR`*/
 uint32_t custom_tick_get(void)
 {
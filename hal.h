@@ -5,6 +5,23 @@ void hal_init(const char* asset_path);
 lv_group_t * lvgui_get_focus_group();
 void lvgui_focus_ring_disable();
 char * hal_asset_path(const char* asset_path);
+// Size of the draw buffer, in bytes (0 when rendering into scanout buffers).
+size_t hal_disp_buf_size(void);
+// What backs the draw buffer: "scanout", "hugetlb", "thp" or "pages".
+const char * hal_disp_buf_backing(void);
+
+// Event-driven main loop: instead of calling lv_task_handler() on a fixed
+// period, wait for the fds from hal_get_poll_fds() to be readable, for at most
+// hal_get_poll_timeout() ms, then call hal_poll_ready() and lv_task_handler().
+// Fills `fds` with the fds to wait on (input, page flips, flushes); returns how many.
+int hal_get_poll_fds(int * fds, int max);
+// Milliseconds lv_task_handler() has nothing to do for; -1 to wait on the fds only.
+int hal_get_poll_timeout(void);
+// Once the fds are readable, hands their events to the tasks of LVGL.
+void hal_poll_ready(void);
+// Runs LVGL as described above, calling `cb` after every lv_task_handler(),
+// until it returns false.
+void hal_run(bool (*cb)(void * user_data), void * user_data);
 
 extern lv_disp_drv_t disp_drv;
 extern int mn_hal_default_dpi;
@@ -16,6 +16,10 @@
 #	include "lv_drivers/display/monitor.h"
 #endif
 
+#if USE_HEADLESS
+#	include "lv_drivers/display/headless.h"
+#endif
+
 #if LVGL_ENV_SIMULATOR
 #define IS_SIMULATOR true
 #else
@@ -47,6 +51,144 @@ const char * lv_introspection_display_driver(void)
 #if USE_MONITOR
 	if (disp_drv.flush_cb == monitor_flush)
 		return "monitor";
+#endif
+#if USE_HEADLESS
+	if (disp_drv.flush_cb == headless_flush)
+		return "headless";
 #endif
 	return "unknown";
 }
+
+uint32_t lv_introspection_display_buffer_size(void)
+{
+	return hal_disp_buf_size();
+}
+
+const char * lv_introspection_display_buffer_backing(void)
+{
+	return hal_disp_buf_backing();
+}
+
+const char * lv_introspection_display_rotation(void)
+{
+#if USE_DRM
+	if (disp_drv.flush_cb == drm_flush) {
+		switch (drm_get_rotation_path()) {
+			case DRM_ROTATION_NONE:
+				return "none";
+			case DRM_ROTATION_HARDWARE:
+				return "hardware";
+			case DRM_ROTATION_SOFTWARE:
+				return "software";
+		}
+	}
+#endif
+	return "none";
+}
+
+uint32_t lv_introspection_display_render_scale(void)
+{
+#if USE_DRM
+	uint32_t num, den;
+
+	if (disp_drv.flush_cb == drm_flush && drm_get_render_scale(&num, &den)) {
+		return 100 * num / den;
+	}
+#endif
+	return 100;
+}
+
+uint32_t lv_introspection_input_latency_count(void)
+{
+#if LV_USE_LATENCY
+	return lv_latency_get_stats()->count;
+#else
+	return 0;
+#endif
+}
+
+uint32_t lv_introspection_input_latency_bucket_count(void)
+{
+#if LV_USE_LATENCY
+	return LV_LATENCY_HIST_SIZE;
+#else
+	return 0;
+#endif
+}
+
+uint32_t lv_introspection_input_latency_bucket_width(void)
+{
+#if LV_USE_LATENCY
+	return LV_LATENCY_HIST_STEP;
+#else
+	return 0;
+#endif
+}
+
+uint32_t lv_introspection_input_latency_bucket(uint32_t index)
+{
+#if LV_USE_LATENCY
+	if (index < LV_LATENCY_HIST_SIZE) {
+		return lv_latency_get_stats()->hist[index];
+	}
+#else
+	(void) index;
+#endif
+	return 0;
+}
+
+uint32_t lv_introspection_input_latency_percentile(uint32_t percent)
+{
+#if LV_USE_LATENCY
+	return lv_latency_get_percentile(percent);
+#else
+	(void) percent;
+	return 0;
+#endif
+}
+
+uint32_t lv_introspection_input_latency_max(void)
+{
+#if LV_USE_LATENCY
+	return lv_latency_get_stats()->max;
+#else
+	return 0;
+#endif
+}
+
+uint32_t lv_introspection_input_latency_read(void)
+{
+#if LV_USE_LATENCY
+	const lv_latency_stats_t * stats = lv_latency_get_stats();
+	return stats->count ? stats->read_sum / stats->count : 0;
+#else
+	return 0;
+#endif
+}
+
+uint32_t lv_introspection_input_latency_draw(void)
+{
+#if LV_USE_LATENCY
+	const lv_latency_stats_t * stats = lv_latency_get_stats();
+	return stats->count ? stats->draw_sum / stats->count : 0;
+#else
+	return 0;
+#endif
+}
+
+uint32_t lv_introspection_input_latency_show(void)
+{
+#if LV_USE_LATENCY
+	const lv_latency_stats_t * stats = lv_latency_get_stats();
+	return stats->count ? stats->show_sum / stats->count : 0;
+#else
+	return 0;
+#endif
+}
+
+void lv_introspection_input_latency_reset(void)
+{
+#if LV_USE_LATENCY
+	lv_latency_reset();
+#endif
+}
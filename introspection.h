@@ -10,5 +10,26 @@ bool lv_introspection_is_simulator(void);
 bool lv_introspection_is_debug(void);
 bool lv_introspection_use_assert_style(void);
 const char * lv_introspection_display_driver(void);
+const char * lv_introspection_display_rotation(void);
+uint32_t lv_introspection_display_buffer_size(void);
+const char * lv_introspection_display_buffer_backing(void);
+// Resolution LVGL renders at, in percents of the display's.
+uint32_t lv_introspection_display_render_scale(void);
+
+// Latency from input events to their result being shown, in microseconds.
+// Histogram of `lv_introspection_input_latency_bucket_count()` ranges of
+// `lv_introspection_input_latency_bucket_width()`, the last one for all longer ones.
+uint32_t lv_introspection_input_latency_count(void);
+uint32_t lv_introspection_input_latency_bucket_count(void);
+uint32_t lv_introspection_input_latency_bucket_width(void);
+uint32_t lv_introspection_input_latency_bucket(uint32_t index);
+uint32_t lv_introspection_input_latency_percentile(uint32_t percent);
+uint32_t lv_introspection_input_latency_max(void);
+// Average time from the event to its read, from its read to the frame
+// drawn, and from the frame drawn to the frame shown.
+uint32_t lv_introspection_input_latency_read(void);
+uint32_t lv_introspection_input_latency_draw(void);
+uint32_t lv_introspection_input_latency_show(void);
+void lv_introspection_input_latency_reset(void);
 
 #endif
@@ -33,13 +33,20 @@
  * - 8:  RGB233
  * - 16: RGB565
  * - 32: ARGB8888
+ * (Set with `LVGL_COLOR_DEPTH` when building; only 16 and 32 are supported.)
  */
+#ifndef LV_COLOR_DEPTH
 #define LV_COLOR_DEPTH     32
+#endif
 
 /* Swap the 2 bytes of RGB565 color.
  * Useful if the display has a 8 bit interface (e.g. SPI)*/
 #define LV_COLOR_16_SWAP   0
 
+/* 1: Apply an ordered dither to gradients with `LV_COLOR_DEPTH 16`.
+ * Hides the banding of RGB565 at the cost of computing every pixel of gradients. */
+#define LV_DITHER_GRADIENT 1
+
 /* 1: Enable screen transparency.
  * Useful for OSD or other overlapping GUIs.
  * Requires `LV_COLOR_DEPTH = 32` colors and the screen's style should be modified: `style.body.opa = ...`*/
@@ -128,6 +135,23 @@ typedef int16_t lv_coord_t;
  * Time between `LV_EVENT_LONG_PRESSED_REPEAT */
 #define LV_INDEV_DEF_LONG_PRESS_REP_TIME  100
 
+/* 1: Show the result of an input right away: the refresh doesn't wait
+ * for its period and runs before the other tasks. The input devices
+ * are also read again just before drawing.*/
+#define LV_INDEV_FAST_REFR                1
+
+/* 1: Measure how long the result of inputs takes to be shown, from the
+ * timestamps of input drivers (see `lv_latency.h`). Uses `CLOCK_MONOTONIC`.
+ * Adds bookkeeping to every input and refresh.
+ * (Set with `LVGL_LATENCY` when building.)*/
+#ifndef LV_USE_LATENCY
+#define LV_USE_LATENCY                    0
+#endif
+#if LV_USE_LATENCY
+/* Log a summary every this many inputs shown, at the info level. 0: never*/
+#  define LV_LATENCY_LOG_PERIOD           0
+#endif
+
 /*==================
  * Feature usage
  *==================*/
@@ -177,6 +201,21 @@ typedef void * lv_fs_drv_user_data_t;
  * LV_IMG_CACHE_DEF_SIZE must be >= 1 */
 #define LV_IMG_CACHE_DEF_SIZE       8
 
+/*1: Keep the pixels of the last shown screens so loading them again
+ * only copies them back instead of drawing all of their objects.
+ * Costs a whole display of pixels per kept screen (e.g. 8 MB for 1920x1080 at 32 bit),
+ * and copying every refreshed area into the cache.
+ * (Set with `LVGL_SCR_CACHE` when building.)*/
+#ifndef LV_USE_SCR_CACHE
+#define LV_USE_SCR_CACHE            0
+#endif
+#if LV_USE_SCR_CACHE
+/*Number of screens to keep, including the active one*/
+#  define LV_SCR_CACHE_MAX          4
+/*Memory used by the kept screens at most, in bytes*/
+#  define LV_SCR_CACHE_SIZE         (16 * 1024 * 1024)
+#endif
+
 /*Declare the type of the user data of image decoder (can be e.g. `void *`, `int`, `struct`)*/
 typedef void * lv_img_decoder_user_data_t;
 
@@ -0,0 +1,205 @@
+/**
+ * @file async_flush.c
+ *
+ */
+
+/* Implementation notes:
+ *
+ *  - LVGL only ever has one area being flushed per display: with two display
+ *    buffers it waits for `flushing` to clear before flushing the next one.
+ *    A single job slot per display is then enough.
+ *
+ *  - Every display has its own thread, so the outputs of a device flush and
+ *    wait on their page flips concurrently.
+ *
+ *  - `lv_disp_flush_is_last` describes the part being *rendered*, which is
+ *    the next one by the time the thread gets to flush. It is sampled when
+ *    the area is queued.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "async_flush.h"
+#if USE_FBDEV || USE_DRM
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+// Displays which can be flushed asynchronously.
+#ifndef ASYNC_FLUSH_MAX
+#define ASYNC_FLUSH_MAX 4
+#endif
+
+#define err(msg, ...)   fprintf(stderr, "[display/async_flush]: error: " msg "\n", ##__VA_ARGS__);
+#define print(msg, ...)	fprintf(stdout, "[display/async_flush]: " msg, ##__VA_ARGS__);
+#define info(msg, ...)    print(msg "\n", ##__VA_ARGS__)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+struct async_flush {
+	lv_disp_drv_t *drv;
+	async_flush_cb_t cb;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	// The queued area, protected by `lock`.
+	bool pending;
+	lv_area_t area;
+	const lv_color_t *color_p;
+	bool last;
+};
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static struct async_flush * async_flush_find(lv_disp_drv_t *drv);
+static void * async_flush_thread(void *data);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static struct async_flush async_flush[ASYNC_FLUSH_MAX];
+static uint32_t async_flush_count = 0;
+static int async_flush_fd = -1;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+bool async_flush_init(lv_disp_drv_t *drv, async_flush_cb_t cb)
+{
+	struct async_flush *af;
+	int ret;
+
+	if (async_flush_find(drv)) {
+		return true;
+	}
+
+	if (async_flush_count == ASYNC_FLUSH_MAX) {
+		err("only %d displays can be flushed asynchronously", ASYNC_FLUSH_MAX);
+		return false;
+	}
+
+	if (async_flush_fd < 0) {
+		async_flush_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (async_flush_fd < 0) {
+			err("cannot create eventfd: %m");
+			return false;
+		}
+	}
+
+	// Only published by bumping the count once the thread runs.
+	af = &async_flush[async_flush_count];
+	pthread_mutex_init(&af->lock, NULL);
+	pthread_cond_init(&af->cond, NULL);
+	af->drv = drv;
+	af->cb = cb;
+	af->pending = false;
+
+	ret = pthread_create(&af->thread, NULL, async_flush_thread, af);
+	if (ret) {
+		err("cannot start flush thread: %s", strerror(ret));
+		pthread_cond_destroy(&af->cond);
+		pthread_mutex_destroy(&af->lock);
+		af->drv = NULL;
+		return false;
+	}
+	async_flush_count++;
+
+	info("flushing display %u from a separate thread", async_flush_count);
+
+	return true;
+}
+
+bool async_flush_queue(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p)
+{
+	struct async_flush *af = async_flush_find(drv);
+
+	if (!af) {
+		return false;
+	}
+
+	pthread_mutex_lock(&af->lock);
+	af->area = *area;
+	af->color_p = color_p;
+	af->last = lv_disp_flush_is_last(drv);
+	af->pending = true;
+	pthread_cond_signal(&af->cond);
+	pthread_mutex_unlock(&af->lock);
+
+	return true;
+}
+
+bool async_flush_busy(lv_disp_drv_t *drv)
+{
+	// Pairs with the release in `lv_disp_flush_ready`.
+	return __atomic_load_n(&drv->buffer->flushing, __ATOMIC_ACQUIRE) != 0;
+}
+
+int async_flush_get_fd(void)
+{
+	return async_flush_fd;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static struct async_flush * async_flush_find(lv_disp_drv_t *drv)
+{
+	uint32_t i;
+
+	for (i = 0; i < async_flush_count; i++) {
+		if (async_flush[i].drv == drv) {
+			return &async_flush[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void * async_flush_thread(void *data)
+{
+	struct async_flush *af = data;
+	lv_area_t area;
+	const lv_color_t *color_p;
+	bool last;
+	uint64_t one = 1;
+
+	for (;;) {
+		pthread_mutex_lock(&af->lock);
+		while (!af->pending) {
+			pthread_cond_wait(&af->cond, &af->lock);
+		}
+		area = af->area;
+		color_p = af->color_p;
+		last = af->last;
+		af->pending = false;
+		pthread_mutex_unlock(&af->lock);
+
+		af->cb(af->drv, &area, color_p, last);
+		lv_disp_flush_ready(af->drv);
+
+		// Wakes up a main loop waiting for the flush to be done.
+		if (write(async_flush_fd, &one, sizeof(one)) < 0) {
+			err("cannot signal flush completion: %m");
+		}
+	}
+
+	return NULL;
+}
+
+#endif
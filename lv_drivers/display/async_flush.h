@@ -0,0 +1,102 @@
+/**
+ * @file async_flush.h
+ *
+ * Flushes the rendered areas from a separate thread, so that the next part
+ * is rendered while the previous one is being copied to the framebuffer.
+ *
+ */
+
+#ifndef ASYNC_FLUSH_H
+#define ASYNC_FLUSH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#ifndef LV_DRV_NO_CONF
+#ifdef LV_CONF_INCLUDE_SIMPLE
+#include "lv_drv_conf.h"
+#else
+#include "../../lv_drv_conf.h"
+#endif
+#endif
+
+#if USE_FBDEV || USE_DRM
+
+#include <stdbool.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#ifndef DISP_ASYNC_FLUSH
+#  define DISP_ASYNC_FLUSH 0
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Flushes an area, without calling `lv_disp_flush_ready`.
+ * `last` tells whether it is the last area of the refresh cycle; the
+ * display buffer cannot be asked anymore, rendering already moved on.
+ */
+typedef void (*async_flush_cb_t)(lv_disp_drv_t * drv, const lv_area_t * area, const lv_color_t * color_p, bool last);
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Starts the flush thread for the display driver.
+ * The display buffer should have two buffers so the rendering can go on
+ * in one of them while the other is flushed.
+ * @param drv display driver whose `flush_cb` uses `async_flush_queue`
+ * @param cb function doing the actual flushing on the flush thread
+ * @return whether the flushing is now done by the thread
+ */
+bool async_flush_init(lv_disp_drv_t * drv, async_flush_cb_t cb);
+
+/**
+ * Hands over an area to the flush thread.
+ * Call from `flush_cb`; on success `lv_disp_flush_ready` is called by the
+ * flush thread once the area is flushed.
+ * @return false when the flush thread is not used for the driver, the
+ *         area should then be flushed right away
+ */
+bool async_flush_queue(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_p);
+
+/**
+ * Tells whether the flush thread is still flushing an area of the driver.
+ * Until then, the state of the display device belongs to the flush thread.
+ */
+bool async_flush_busy(lv_disp_drv_t * drv);
+
+/**
+ * Gets an eventfd, shared by all the flush threads, readable once an area
+ * was flushed. Reading it clears it.
+ * @return the file descriptor, or -1 when no flush thread was started.
+ */
+int async_flush_get_fd(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif  /*USE_FBDEV || USE_DRM*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*ASYNC_FLUSH_H*/
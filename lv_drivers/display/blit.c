@@ -0,0 +1,928 @@
+/**
+ * @file blit.c
+ *
+ */
+
+/* Implementation notes:
+ *
+ *  - Quarter turns are all done as a transposition, walking either the
+ *    source or the destination lines backwards.
+ *
+ *  - Transpositions go through the buffers in square tiles, so that both
+ *    the lines read and the lines written stay in the cache. Within a tile,
+ *    the SIMD kernels transpose whole blocks in registers.
+ *
+ *  - Conversions rotate a tile into a small buffer, still in the cache, and
+ *    convert its lines from there. Only the conversion of lines then needs
+ *    specific kernels.
+ *
+ *  - Scaling samples the nearest source pixel of every destination pixel
+ *    into a tile, which is then rotated as for conversions. Without
+ *    rotation, it samples straight into the destination, and lines sampling
+ *    the same source line as the previous one are copied from it.
+ *
+ *  - Dithering adds the threshold of the ordered pattern to each component
+ *    (saturating) before dropping the low bits. The thresholds of four
+ *    consecutive pixels are packed as pixels, so they are added in one go.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "blit.h"
+#if USE_FBDEV || USE_DRM || USE_HEADLESS
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  if defined(__SSE2__)
+#    define BLIT_HAVE_SSE2
+#    include <emmintrin.h>
+#  endif
+#  if defined(__GNUC__)
+#    define BLIT_HAVE_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+#if defined(__ARM_NEON)
+#  define BLIT_HAVE_NEON
+#  include <arm_neon.h>
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+// Side of the square tiles transpositions are done in, in pixels.
+// 32×32 pixels is 4KiB for both source and destination, which fits in L1.
+#define BLIT_TILE 32
+
+// Side of the tiles rotated before conversion, in pixels; the tile lives on the stack.
+#define BLIT_CONVERT_TILE 16
+
+#define err(msg, ...)   fprintf(stderr, "[display/blit]: error: " msg "\n", ##__VA_ARGS__);
+#define print(msg, ...)	fprintf(stdout, "[display/blit]: " msg, ##__VA_ARGS__);
+#define info(msg, ...)    print(msg "\n", ##__VA_ARGS__)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+struct blit_impl {
+	const char * name;
+
+	// Whether the running CPU can use this implementation.
+	bool (*supported)(void);
+
+	// Side of the square blocks handled by the kernels, in pixels.
+	// A zero means the reference implementation is used.
+	ptrdiff_t block;
+
+	// Transposes a block; dst[x][y] = src[y][x].
+	// Strides are in pixels, and may be negative.
+	void (*transpose)(const uint32_t * src, ptrdiff_t src_stride, uint32_t * dst, ptrdiff_t dst_stride);
+
+	// Copies a block-wide line of pixels, in reverse order.
+	void (*reverse)(const uint32_t * src, uint32_t * dst);
+
+	// Converts a line of `n` pixels to RGB565, or BGR565.
+	// `bias` is added to the pixels, in turn, before conversion.
+	void (*line_565)(const uint32_t * src, uint16_t * dst, ptrdiff_t n, const uint32_t bias[4], bool bgr);
+};
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static const struct blit_impl * blit_find(const char * name);
+static const struct blit_impl * blit_select(void);
+static void blit_reference(blit_rotation_t rotation, const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h);
+static void blit_transpose(const struct blit_impl * impl, const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h);
+static void blit_reverse(const struct blit_impl * impl, const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h);
+static void blit_transpose_16(const uint16_t * src, ptrdiff_t ss, uint16_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h);
+static void blit_convert_line(const struct blit_impl * impl, blit_format_t format, bool dither, const uint32_t * src, uint8_t * dst, ptrdiff_t n, uint32_t x, uint32_t y);
+static void blit_line_565_scalar(const uint32_t * src, uint16_t * dst, ptrdiff_t n, const uint32_t bias[4], bool bgr);
+static void blit_scale(size_t size, blit_rotation_t rotation, uint32_t num, uint32_t den, const void * src, ptrdiff_t ss, uint32_t src_x, uint32_t src_y, void * dst, ptrdiff_t ds, uint32_t w, uint32_t h);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const struct blit_impl * blit_impl = NULL;
+
+// Dithering thresholds for RGB565, from a 4×4 Bayer matrix; 0 to 7 for the
+// 5 bit components, 0 to 3 for the 6 bit one.
+#define BLIT_BIAS_565(b) ((((b) >> 1) << 16) | (((b) >> 2) << 8) | ((b) >> 1))
+static const uint32_t blit_bias_565[4][4] = {
+	{ BLIT_BIAS_565( 0), BLIT_BIAS_565( 8), BLIT_BIAS_565( 2), BLIT_BIAS_565(10) },
+	{ BLIT_BIAS_565(12), BLIT_BIAS_565( 4), BLIT_BIAS_565(14), BLIT_BIAS_565( 6) },
+	{ BLIT_BIAS_565( 3), BLIT_BIAS_565(11), BLIT_BIAS_565( 1), BLIT_BIAS_565( 9) },
+	{ BLIT_BIAS_565(15), BLIT_BIAS_565( 7), BLIT_BIAS_565(13), BLIT_BIAS_565( 5) },
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void blit_rotate_32(blit_rotation_t rotation, const uint32_t * src, uint32_t src_stride, uint32_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h)
+{
+	const struct blit_impl * impl = blit_select();
+	ptrdiff_t ss = src_stride / sizeof(uint32_t);
+	ptrdiff_t ds = dst_stride / sizeof(uint32_t);
+	ptrdiff_t y;
+
+	if (w == 0 || h == 0) {
+		return;
+	}
+
+	if (impl->block == 0) {
+		blit_reference(rotation, src, ss, dst, ds, w, h);
+		return;
+	}
+
+	switch (rotation) {
+		case BLIT_ROTATE_0:
+			for (y = 0; y < h; y++) {
+				memcpy(dst + y * ds, src + y * ss, w * sizeof(uint32_t));
+			}
+			break;
+		case BLIT_ROTATE_180:
+			blit_reverse(impl, src, ss, dst, ds, w, h);
+			break;
+		case BLIT_ROTATE_CW:
+			// Reading the source bottom-up turns the transposition into a clockwise turn.
+			blit_transpose(impl, src + (h - 1) * ss, -ss, dst, ds, w, h);
+			break;
+		case BLIT_ROTATE_CCW:
+			// Writing the destination bottom-up turns the transposition into a counter-clockwise turn.
+			blit_transpose(impl, src, ss, dst + (w - 1) * ds, -ds, w, h);
+			break;
+	}
+}
+
+void blit_rotate_16(blit_rotation_t rotation, const uint16_t * src, uint32_t src_stride, uint16_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h)
+{
+	ptrdiff_t ss = src_stride / sizeof(uint16_t);
+	ptrdiff_t ds = dst_stride / sizeof(uint16_t);
+	ptrdiff_t x, y;
+	uint16_t * d;
+
+	if (w == 0 || h == 0) {
+		return;
+	}
+
+	switch (rotation) {
+		case BLIT_ROTATE_0:
+			for (y = 0; y < h; y++) {
+				memcpy(dst + y * ds, src + y * ss, w * sizeof(uint16_t));
+			}
+			break;
+		case BLIT_ROTATE_180:
+			for (y = 0; y < h; y++) {
+				d = dst + (h - 1 - y) * ds + w - 1;
+				for (x = 0; x < w; x++) {
+					d[-x] = src[y * ss + x];
+				}
+			}
+			break;
+		case BLIT_ROTATE_CW:
+			blit_transpose_16(src + (h - 1) * ss, -ss, dst, ds, w, h);
+			break;
+		case BLIT_ROTATE_CCW:
+			blit_transpose_16(src, ss, dst + (w - 1) * ds, -ds, w, h);
+			break;
+	}
+}
+
+void blit_convert_32(blit_rotation_t rotation, blit_format_t format, bool dither, const uint32_t * src, uint32_t src_stride, void * dst, uint32_t dst_stride, uint32_t dst_x, uint32_t dst_y, uint32_t w, uint32_t h)
+{
+	const struct blit_impl * impl = blit_select();
+	uint32_t tile[BLIT_CONVERT_TILE * BLIT_CONVERT_TILE];
+	ptrdiff_t ss = src_stride / sizeof(uint32_t);
+	ptrdiff_t size = blit_format_size(format);
+	bool turn = rotation == BLIT_ROTATE_CW || rotation == BLIT_ROTATE_CCW;
+	ptrdiff_t tx, ty, tw, th;
+	ptrdiff_t x = 0, y = 0;
+	ptrdiff_t i;
+	uint8_t * d;
+
+	if (w == 0 || h == 0) {
+		return;
+	}
+
+	// Nothing to convert.
+	if (format == BLIT_FORMAT_XRGB8888) {
+		blit_rotate_32(rotation, src, src_stride, dst, dst_stride, w, h);
+		return;
+	}
+
+	if (rotation == BLIT_ROTATE_0) {
+		for (i = 0; i < h; i++) {
+			blit_convert_line(impl, format, dither, src + i * ss, (uint8_t *)dst + i * dst_stride, w, dst_x, dst_y + i);
+		}
+		return;
+	}
+
+	for (ty = 0; ty < h; ty += BLIT_CONVERT_TILE) {
+		th = h - ty < BLIT_CONVERT_TILE ? h - ty : BLIT_CONVERT_TILE;
+
+		for (tx = 0; tx < w; tx += BLIT_CONVERT_TILE) {
+			tw = w - tx < BLIT_CONVERT_TILE ? w - tx : BLIT_CONVERT_TILE;
+
+			blit_rotate_32(rotation, src + ty * ss + tx, src_stride, tile, sizeof(tile) / BLIT_CONVERT_TILE, tw, th);
+
+			// Where the rotated tile lands in the destination.
+			switch (rotation) {
+				case BLIT_ROTATE_0:
+					x = tx;
+					y = ty;
+					break;
+				case BLIT_ROTATE_180:
+					x = w - tx - tw;
+					y = h - ty - th;
+					break;
+				case BLIT_ROTATE_CW:
+					x = h - ty - th;
+					y = tx;
+					break;
+				case BLIT_ROTATE_CCW:
+					x = ty;
+					y = w - tx - tw;
+					break;
+			}
+
+			d = (uint8_t *)dst + y * dst_stride + x * size;
+			for (i = 0; i < (turn ? tw : th); i++) {
+				blit_convert_line(impl, format, dither, tile + i * BLIT_CONVERT_TILE, d + i * dst_stride, turn ? th : tw, dst_x + x, dst_y + y + i);
+			}
+		}
+	}
+}
+
+void blit_scale_32(blit_rotation_t rotation, uint32_t num, uint32_t den, const uint32_t * src, uint32_t src_stride, uint32_t src_x, uint32_t src_y, uint32_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h)
+{
+	blit_scale(sizeof(uint32_t), rotation, num, den, src, src_stride, src_x, src_y, dst, dst_stride, w, h);
+}
+
+void blit_scale_16(blit_rotation_t rotation, uint32_t num, uint32_t den, const uint16_t * src, uint32_t src_stride, uint32_t src_x, uint32_t src_y, uint16_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h)
+{
+	blit_scale(sizeof(uint16_t), rotation, num, den, src, src_stride, src_x, src_y, dst, dst_stride, w, h);
+}
+
+uint32_t blit_scale_coord(uint32_t x, uint32_t num, uint32_t den)
+{
+	return ((uint64_t)x * num + den - 1) / den;
+}
+
+uint32_t blit_format_size(blit_format_t format)
+{
+	switch (format) {
+		case BLIT_FORMAT_XRGB8888:
+		case BLIT_FORMAT_XBGR8888:
+			return 4;
+		case BLIT_FORMAT_RGB888:
+		case BLIT_FORMAT_BGR888:
+			return 3;
+		case BLIT_FORMAT_RGB565:
+		case BLIT_FORMAT_BGR565:
+			return 2;
+	}
+
+	return 0;
+}
+
+const char * blit_get_impl(void)
+{
+	return blit_select()->name;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+// {{{ Generic implementation
+
+/**
+ * Per-pixel implementation, the behaviour other implementations have to match.
+ */
+static void blit_reference(blit_rotation_t rotation, const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h)
+{
+	ptrdiff_t x, y;
+	uint32_t px;
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			px = src[y * ss + x];
+			switch (rotation) {
+				case BLIT_ROTATE_0:
+					dst[y * ds + x] = px;
+					break;
+				case BLIT_ROTATE_180:
+					dst[(h - 1 - y) * ds + (w - 1 - x)] = px;
+					break;
+				case BLIT_ROTATE_CW:
+					dst[x * ds + (h - 1 - y)] = px;
+					break;
+				case BLIT_ROTATE_CCW:
+					dst[(w - 1 - x) * ds + y] = px;
+					break;
+			}
+		}
+	}
+}
+
+/**
+ * Transposes a `w`×`h` area tile by tile; dst[x][y] = src[y][x].
+ */
+static void blit_transpose(const struct blit_impl * impl, const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h)
+{
+	ptrdiff_t n = impl->block;
+	ptrdiff_t tx, ty, tw, th, bw, bh;
+	ptrdiff_t x, y;
+
+	for (ty = 0; ty < h; ty += BLIT_TILE) {
+		th = h - ty < BLIT_TILE ? h - ty : BLIT_TILE;
+		bh = th - th % n;
+
+		for (tx = 0; tx < w; tx += BLIT_TILE) {
+			tw = w - tx < BLIT_TILE ? w - tx : BLIT_TILE;
+			bw = tw - tw % n;
+
+			for (y = ty; y < ty + bh; y += n) {
+				for (x = tx; x < tx + bw; x += n) {
+					impl->transpose(src + y * ss + x, ss, dst + x * ds + y, ds);
+				}
+			}
+
+			// Whatever does not fill a whole block, on the right...
+			for (y = ty; y < ty + bh; y++) {
+				for (x = tx + bw; x < tx + tw; x++) {
+					dst[x * ds + y] = src[y * ss + x];
+				}
+			}
+			// ... and at the bottom of the tile.
+			for (y = ty + bh; y < ty + th; y++) {
+				for (x = tx; x < tx + tw; x++) {
+					dst[x * ds + y] = src[y * ss + x];
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Turns a `w`×`h` area upside down.
+ */
+static void blit_reverse(const struct blit_impl * impl, const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h)
+{
+	ptrdiff_t n = impl->block;
+	ptrdiff_t x, y;
+	const uint32_t * s;
+	uint32_t * d;
+
+	for (y = 0; y < h; y++) {
+		s = src + y * ss;
+		// One past the end of the destination line.
+		d = dst + (h - 1 - y) * ds + w;
+
+		for (x = 0; x + n <= w; x += n) {
+			impl->reverse(s + x, d - x - n);
+		}
+		for (; x < w; x++) {
+			d[-x - 1] = s[x];
+		}
+	}
+}
+
+// }}}
+
+// {{{ Scaling
+
+/**
+ * Samples a line of `n` pixels of `size` bytes, from the source columns in `cols`.
+ */
+static inline void blit_scale_line(size_t size, const uint8_t * src, uint8_t * dst, const uint32_t * cols, ptrdiff_t n)
+{
+	ptrdiff_t i;
+
+	if (size == sizeof(uint32_t)) {
+		for (i = 0; i < n; i++) {
+			((uint32_t *)dst)[i] = ((const uint32_t *)src)[cols[i]];
+		}
+	}
+	else {
+		for (i = 0; i < n; i++) {
+			((uint16_t *)dst)[i] = ((const uint16_t *)src)[cols[i]];
+		}
+	}
+}
+
+/**
+ * Implements `blit_scale_32` and `blit_scale_16` for pixels of `size` bytes; strides are in bytes.
+ * Inlined in the callers, so the size is known at compile time.
+ */
+static inline void blit_scale(size_t size, blit_rotation_t rotation, uint32_t num, uint32_t den, const void * src, ptrdiff_t ss, uint32_t src_x, uint32_t src_y, void * dst, ptrdiff_t ds, uint32_t w, uint32_t h)
+{
+	uint32_t tile[BLIT_CONVERT_TILE * BLIT_CONVERT_TILE];
+	uint32_t cols[BLIT_CONVERT_TILE];
+	ptrdiff_t x1 = blit_scale_coord(src_x, num, den);
+	ptrdiff_t y1 = blit_scale_coord(src_y, num, den);
+	ptrdiff_t sw = blit_scale_coord(src_x + w, num, den) - x1;
+	ptrdiff_t sh = blit_scale_coord(src_y + h, num, den) - y1;
+	ptrdiff_t ts = BLIT_CONVERT_TILE * size;
+	ptrdiff_t tx, ty, tw, th;
+	ptrdiff_t x = 0, y = 0;
+	ptrdiff_t row, prev;
+	ptrdiff_t i;
+	uint8_t * d;
+
+	if (w == 0 || h == 0) {
+		return;
+	}
+
+	for (ty = 0; ty < sh; ty += BLIT_CONVERT_TILE) {
+		th = sh - ty < BLIT_CONVERT_TILE ? sh - ty : BLIT_CONVERT_TILE;
+
+		for (tx = 0; tx < sw; tx += BLIT_CONVERT_TILE) {
+			tw = sw - tx < BLIT_CONVERT_TILE ? sw - tx : BLIT_CONVERT_TILE;
+
+			// Source column of every column of the tile.
+			for (i = 0; i < tw; i++) {
+				cols[i] = (uint64_t)(x1 + tx + i) * den / num - src_x;
+			}
+
+			if (rotation == BLIT_ROTATE_0) {
+				d = (uint8_t *)dst + ty * ds + tx * size;
+				prev = -1;
+				for (i = 0; i < th; i++) {
+					row = (uint64_t)(y1 + ty + i) * den / num - src_y;
+					if (row == prev) {
+						memcpy(d + i * ds, d + (i - 1) * ds, tw * size);
+					}
+					else {
+						blit_scale_line(size, (const uint8_t *)src + row * ss, d + i * ds, cols, tw);
+					}
+					prev = row;
+				}
+				continue;
+			}
+
+			for (i = 0; i < th; i++) {
+				row = (uint64_t)(y1 + ty + i) * den / num - src_y;
+				blit_scale_line(size, (const uint8_t *)src + row * ss, (uint8_t *)tile + i * ts, cols, tw);
+			}
+
+			// Where the rotated tile lands in the destination.
+			switch (rotation) {
+				case BLIT_ROTATE_0:
+					x = tx;
+					y = ty;
+					break;
+				case BLIT_ROTATE_180:
+					x = sw - tx - tw;
+					y = sh - ty - th;
+					break;
+				case BLIT_ROTATE_CW:
+					x = sh - ty - th;
+					y = tx;
+					break;
+				case BLIT_ROTATE_CCW:
+					x = ty;
+					y = sw - tx - tw;
+					break;
+			}
+
+			d = (uint8_t *)dst + y * ds + x * size;
+			if (size == sizeof(uint32_t)) {
+				blit_rotate_32(rotation, tile, ts, (uint32_t *)d, ds, tw, th);
+			}
+			else {
+				blit_rotate_16(rotation, (const uint16_t *)tile, ts, (uint16_t *)d, ds, tw, th);
+			}
+		}
+	}
+}
+
+// }}}
+
+// {{{ 16 bit pixels
+
+/**
+ * Transposes a `w`×`h` area of 16 bit pixels tile by tile; dst[x][y] = src[y][x].
+ * The tiles alone give most of the gain, without specific kernels.
+ */
+static void blit_transpose_16(const uint16_t * src, ptrdiff_t ss, uint16_t * dst, ptrdiff_t ds, ptrdiff_t w, ptrdiff_t h)
+{
+	ptrdiff_t tx, ty, tw, th;
+	ptrdiff_t x, y;
+
+	for (ty = 0; ty < h; ty += BLIT_TILE) {
+		th = h - ty < BLIT_TILE ? h - ty : BLIT_TILE;
+		for (tx = 0; tx < w; tx += BLIT_TILE) {
+			tw = w - tx < BLIT_TILE ? w - tx : BLIT_TILE;
+			for (x = tx; x < tx + tw; x++) {
+				for (y = ty; y < ty + th; y++) {
+					dst[x * ds + y] = src[y * ss + x];
+				}
+			}
+		}
+	}
+}
+
+// {{{ Format conversion
+
+/**
+ * Converts a line of `n` XRGB8888 pixels, the first one being at `x`, `y` on the screen.
+ */
+static void blit_convert_line(const struct blit_impl * impl, blit_format_t format, bool dither, const uint32_t * src, uint8_t * dst, ptrdiff_t n, uint32_t x, uint32_t y)
+{
+	static const uint32_t no_bias[4] = { 0 };
+	uint32_t bias[4];
+	uint32_t * d32 = (uint32_t *)dst;
+	uint32_t px;
+	ptrdiff_t i;
+
+	switch (format) {
+		case BLIT_FORMAT_XRGB8888:
+			memcpy(dst, src, n * sizeof(uint32_t));
+			break;
+		case BLIT_FORMAT_XBGR8888:
+			for (i = 0; i < n; i++) {
+				px = src[i];
+				d32[i] = (px & 0xFF00FF00) | ((px >> 16) & 0xFF) | ((px & 0xFF) << 16);
+			}
+			break;
+		case BLIT_FORMAT_RGB888:
+			for (i = 0; i < n; i++) {
+				px = src[i];
+				dst[i * 3 + 0] = px;
+				dst[i * 3 + 1] = px >> 8;
+				dst[i * 3 + 2] = px >> 16;
+			}
+			break;
+		case BLIT_FORMAT_BGR888:
+			for (i = 0; i < n; i++) {
+				px = src[i];
+				dst[i * 3 + 0] = px >> 16;
+				dst[i * 3 + 1] = px >> 8;
+				dst[i * 3 + 2] = px;
+			}
+			break;
+		case BLIT_FORMAT_RGB565:
+		case BLIT_FORMAT_BGR565:
+			if (!dither) {
+				impl->line_565(src, (uint16_t *)dst, n, no_bias, format == BLIT_FORMAT_BGR565);
+				break;
+			}
+			// The thresholds for the pixels at `x` to `x + 3`.
+			for (i = 0; i < 4; i++) {
+				bias[i] = blit_bias_565[y & 3][(x + i) & 3];
+			}
+			impl->line_565(src, (uint16_t *)dst, n, bias, format == BLIT_FORMAT_BGR565);
+			break;
+	}
+}
+
+/**
+ * Adds the components of `bias` to the ones of `px`, saturating.
+ */
+static inline uint32_t blit_adds(uint32_t px, uint32_t bias)
+{
+	uint32_t r = ((px >> 16) & 0xFF) + ((bias >> 16) & 0xFF);
+	uint32_t g = ((px >> 8) & 0xFF) + ((bias >> 8) & 0xFF);
+	uint32_t b = (px & 0xFF) + (bias & 0xFF);
+
+	r = r > 0xFF ? 0xFF : r;
+	g = g > 0xFF ? 0xFF : g;
+	b = b > 0xFF ? 0xFF : b;
+
+	return (r << 16) | (g << 8) | b;
+}
+
+static void blit_line_565_scalar(const uint32_t * src, uint16_t * dst, ptrdiff_t n, const uint32_t bias[4], bool bgr)
+{
+	ptrdiff_t i;
+	uint32_t px;
+
+	for (i = 0; i < n; i++) {
+		px = blit_adds(src[i], bias[i & 3]);
+		if (bgr) {
+			dst[i] = ((px << 8) & 0xF800) | ((px >> 5) & 0x07E0) | ((px >> 19) & 0x001F);
+		}
+		else {
+			dst[i] = ((px >> 8) & 0xF800) | ((px >> 5) & 0x07E0) | ((px >> 3) & 0x001F);
+		}
+	}
+}
+
+// }}}
+
+// {{{ Scalar kernels
+
+static void blit_transpose_scalar(const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds)
+{
+	int i, j;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 4; j++) {
+			dst[i * ds + j] = src[j * ss + i];
+		}
+	}
+}
+
+static void blit_reverse_scalar(const uint32_t * src, uint32_t * dst)
+{
+	dst[0] = src[3];
+	dst[1] = src[2];
+	dst[2] = src[1];
+	dst[3] = src[0];
+}
+
+// }}}
+
+// {{{ SSE2 kernels
+
+#ifdef BLIT_HAVE_SSE2
+static void blit_transpose_sse2(const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds)
+{
+	__m128i r0 = _mm_loadu_si128((const __m128i *)(src + 0 * ss));
+	__m128i r1 = _mm_loadu_si128((const __m128i *)(src + 1 * ss));
+	__m128i r2 = _mm_loadu_si128((const __m128i *)(src + 2 * ss));
+	__m128i r3 = _mm_loadu_si128((const __m128i *)(src + 3 * ss));
+
+	__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+	__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+	_mm_storeu_si128((__m128i *)(dst + 0 * ds), _mm_unpacklo_epi64(t0, t1));
+	_mm_storeu_si128((__m128i *)(dst + 1 * ds), _mm_unpackhi_epi64(t0, t1));
+	_mm_storeu_si128((__m128i *)(dst + 2 * ds), _mm_unpacklo_epi64(t2, t3));
+	_mm_storeu_si128((__m128i *)(dst + 3 * ds), _mm_unpackhi_epi64(t2, t3));
+}
+
+static void blit_reverse_sse2(const uint32_t * src, uint32_t * dst)
+{
+	__m128i v = _mm_loadu_si128((const __m128i *)src);
+	_mm_storeu_si128((__m128i *)dst, _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+}
+
+/**
+ * Four pixels to RGB565 (or BGR565), in the low half of each 32 bit lane.
+ */
+static inline __m128i blit_565_sse2(__m128i px, bool bgr)
+{
+	__m128i g = _mm_and_si128(_mm_srli_epi32(px, 5), _mm_set1_epi32(0x07E0));
+
+	if (bgr) {
+		return _mm_or_si128(g, _mm_or_si128(
+			_mm_and_si128(_mm_slli_epi32(px, 8), _mm_set1_epi32(0xF800)),
+			_mm_and_si128(_mm_srli_epi32(px, 19), _mm_set1_epi32(0x001F))
+		));
+	}
+
+	return _mm_or_si128(g, _mm_or_si128(
+		_mm_and_si128(_mm_srli_epi32(px, 8), _mm_set1_epi32(0xF800)),
+		_mm_and_si128(_mm_srli_epi32(px, 3), _mm_set1_epi32(0x001F))
+	));
+}
+
+static void blit_line_565_sse2(const uint32_t * src, uint16_t * dst, ptrdiff_t n, const uint32_t bias[4], bool bgr)
+{
+	__m128i b = _mm_loadu_si128((const __m128i *)bias);
+	__m128i p0, p1;
+	ptrdiff_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		p0 = blit_565_sse2(_mm_adds_epu8(_mm_loadu_si128((const __m128i *)(src + i)), b), bgr);
+		p1 = blit_565_sse2(_mm_adds_epu8(_mm_loadu_si128((const __m128i *)(src + i + 4)), b), bgr);
+		// SSE2 only packs with signed saturation; sign extend the 16 bit values first.
+		p0 = _mm_srai_epi32(_mm_slli_epi32(p0, 16), 16);
+		p1 = _mm_srai_epi32(_mm_slli_epi32(p1, 16), 16);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(p0, p1));
+	}
+
+	// Multiples of four pixels keep the thresholds in phase.
+	blit_line_565_scalar(src + i, dst + i, n - i, bias, bgr);
+}
+#endif
+
+// }}}
+
+// {{{ AVX2 kernels
+
+#ifdef BLIT_HAVE_AVX2
+static bool blit_supported_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2")))
+static void blit_transpose_avx2(const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds)
+{
+	__m256i r0 = _mm256_loadu_si256((const __m256i *)(src + 0 * ss));
+	__m256i r1 = _mm256_loadu_si256((const __m256i *)(src + 1 * ss));
+	__m256i r2 = _mm256_loadu_si256((const __m256i *)(src + 2 * ss));
+	__m256i r3 = _mm256_loadu_si256((const __m256i *)(src + 3 * ss));
+	__m256i r4 = _mm256_loadu_si256((const __m256i *)(src + 4 * ss));
+	__m256i r5 = _mm256_loadu_si256((const __m256i *)(src + 5 * ss));
+	__m256i r6 = _mm256_loadu_si256((const __m256i *)(src + 6 * ss));
+	__m256i r7 = _mm256_loadu_si256((const __m256i *)(src + 7 * ss));
+
+	// Within each 128 bit lane, interleave pairs of lines...
+	__m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+	__m256i t1 = _mm256_unpackhi_epi32(r0, r1);
+	__m256i t2 = _mm256_unpacklo_epi32(r2, r3);
+	__m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+	__m256i t4 = _mm256_unpacklo_epi32(r4, r5);
+	__m256i t5 = _mm256_unpackhi_epi32(r4, r5);
+	__m256i t6 = _mm256_unpacklo_epi32(r6, r7);
+	__m256i t7 = _mm256_unpackhi_epi32(r6, r7);
+
+	// ... then the pairs, giving four lines of each lane's columns...
+	__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+	__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+	__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+	__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+	__m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+	__m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+	__m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+	__m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+	// ... which are finally paired across lanes.
+	_mm256_storeu_si256((__m256i *)(dst + 0 * ds), _mm256_permute2x128_si256(u0, u4, 0x20));
+	_mm256_storeu_si256((__m256i *)(dst + 1 * ds), _mm256_permute2x128_si256(u1, u5, 0x20));
+	_mm256_storeu_si256((__m256i *)(dst + 2 * ds), _mm256_permute2x128_si256(u2, u6, 0x20));
+	_mm256_storeu_si256((__m256i *)(dst + 3 * ds), _mm256_permute2x128_si256(u3, u7, 0x20));
+	_mm256_storeu_si256((__m256i *)(dst + 4 * ds), _mm256_permute2x128_si256(u0, u4, 0x31));
+	_mm256_storeu_si256((__m256i *)(dst + 5 * ds), _mm256_permute2x128_si256(u1, u5, 0x31));
+	_mm256_storeu_si256((__m256i *)(dst + 6 * ds), _mm256_permute2x128_si256(u2, u6, 0x31));
+	_mm256_storeu_si256((__m256i *)(dst + 7 * ds), _mm256_permute2x128_si256(u3, u7, 0x31));
+}
+
+__attribute__((target("avx2")))
+static void blit_reverse_avx2(const uint32_t * src, uint32_t * dst)
+{
+	__m256i v = _mm256_loadu_si256((const __m256i *)src);
+	__m256i idx = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	_mm256_storeu_si256((__m256i *)dst, _mm256_permutevar8x32_epi32(v, idx));
+}
+
+/**
+ * Eight pixels to RGB565 (or BGR565), in the low half of each 32 bit lane.
+ */
+__attribute__((target("avx2")))
+static inline __m256i blit_565_avx2(__m256i px, bool bgr)
+{
+	__m256i g = _mm256_and_si256(_mm256_srli_epi32(px, 5), _mm256_set1_epi32(0x07E0));
+
+	if (bgr) {
+		return _mm256_or_si256(g, _mm256_or_si256(
+			_mm256_and_si256(_mm256_slli_epi32(px, 8), _mm256_set1_epi32(0xF800)),
+			_mm256_and_si256(_mm256_srli_epi32(px, 19), _mm256_set1_epi32(0x001F))
+		));
+	}
+
+	return _mm256_or_si256(g, _mm256_or_si256(
+		_mm256_and_si256(_mm256_srli_epi32(px, 8), _mm256_set1_epi32(0xF800)),
+		_mm256_and_si256(_mm256_srli_epi32(px, 3), _mm256_set1_epi32(0x001F))
+	));
+}
+
+__attribute__((target("avx2")))
+static void blit_line_565_avx2(const uint32_t * src, uint16_t * dst, ptrdiff_t n, const uint32_t bias[4], bool bgr)
+{
+	__m128i b4 = _mm_loadu_si128((const __m128i *)bias);
+	__m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(b4), b4, 1);
+	__m256i p0, p1;
+	ptrdiff_t i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		p0 = blit_565_avx2(_mm256_adds_epu8(_mm256_loadu_si256((const __m256i *)(src + i)), b), bgr);
+		p1 = blit_565_avx2(_mm256_adds_epu8(_mm256_loadu_si256((const __m256i *)(src + i + 8)), b), bgr);
+		// Packing works within 128 bit lanes; put the quarters back in order.
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute4x64_epi64(_mm256_packus_epi32(p0, p1), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+
+	// Multiples of four pixels keep the thresholds in phase.
+	blit_line_565_scalar(src + i, dst + i, n - i, bias, bgr);
+}
+#endif
+
+// }}}
+
+// {{{ NEON kernels
+
+#ifdef BLIT_HAVE_NEON
+static void blit_transpose_neon(const uint32_t * src, ptrdiff_t ss, uint32_t * dst, ptrdiff_t ds)
+{
+	uint32x4x2_t p0 = vtrnq_u32(vld1q_u32(src + 0 * ss), vld1q_u32(src + 1 * ss));
+	uint32x4x2_t p1 = vtrnq_u32(vld1q_u32(src + 2 * ss), vld1q_u32(src + 3 * ss));
+
+	vst1q_u32(dst + 0 * ds, vcombine_u32(vget_low_u32(p0.val[0]), vget_low_u32(p1.val[0])));
+	vst1q_u32(dst + 1 * ds, vcombine_u32(vget_low_u32(p0.val[1]), vget_low_u32(p1.val[1])));
+	vst1q_u32(dst + 2 * ds, vcombine_u32(vget_high_u32(p0.val[0]), vget_high_u32(p1.val[0])));
+	vst1q_u32(dst + 3 * ds, vcombine_u32(vget_high_u32(p0.val[1]), vget_high_u32(p1.val[1])));
+}
+
+static void blit_reverse_neon(const uint32_t * src, uint32_t * dst)
+{
+	uint32x4_t v = vrev64q_u32(vld1q_u32(src));
+	vst1q_u32(dst, vcombine_u32(vget_high_u32(v), vget_low_u32(v)));
+}
+
+static void blit_line_565_neon(const uint32_t * src, uint16_t * dst, ptrdiff_t n, const uint32_t bias[4], bool bgr)
+{
+	uint8x16_t b = vreinterpretq_u8_u32(vld1q_u32(bias));
+	uint32x4_t px, hi, lo;
+	ptrdiff_t i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		px = vreinterpretq_u32_u8(vqaddq_u8(vreinterpretq_u8_u32(vld1q_u32(src + i)), b));
+		if (bgr) {
+			hi = vandq_u32(vshlq_n_u32(px, 8), vdupq_n_u32(0xF800));
+			lo = vandq_u32(vshrq_n_u32(px, 19), vdupq_n_u32(0x001F));
+		}
+		else {
+			hi = vandq_u32(vshrq_n_u32(px, 8), vdupq_n_u32(0xF800));
+			lo = vandq_u32(vshrq_n_u32(px, 3), vdupq_n_u32(0x001F));
+		}
+		px = vorrq_u32(vorrq_u32(hi, lo), vandq_u32(vshrq_n_u32(px, 5), vdupq_n_u32(0x07E0)));
+		vst1_u16(dst + i, vmovn_u32(px));
+	}
+
+	blit_line_565_scalar(src + i, dst + i, n - i, bias, bgr);
+}
+#endif
+
+// }}}
+
+// {{{ Implementation selection
+
+// In order of preference.
+static const struct blit_impl blit_impls[] = {
+#ifdef BLIT_HAVE_AVX2
+	{ "avx2", blit_supported_avx2, 8, blit_transpose_avx2, blit_reverse_avx2, blit_line_565_avx2 },
+#endif
+#ifdef BLIT_HAVE_SSE2
+	{ "sse2", NULL, 4, blit_transpose_sse2, blit_reverse_sse2, blit_line_565_sse2 },
+#endif
+#ifdef BLIT_HAVE_NEON
+	{ "neon", NULL, 4, blit_transpose_neon, blit_reverse_neon, blit_line_565_neon },
+#endif
+	{ "scalar", NULL, 4, blit_transpose_scalar, blit_reverse_scalar, blit_line_565_scalar },
+	{ "reference", NULL, 0, NULL, NULL, blit_line_565_scalar },
+};
+
+/**
+ * Finds the preferred implementation usable on this CPU, matching `name` if given.
+ */
+static const struct blit_impl * blit_find(const char * name)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(blit_impls) / sizeof(blit_impls[0]); i++) {
+		if (blit_impls[i].supported && !blit_impls[i].supported()) {
+			continue;
+		}
+		if (name && strcmp(name, blit_impls[i].name)) {
+			continue;
+		}
+		return &blit_impls[i];
+	}
+
+	return NULL;
+}
+
+static const struct blit_impl * blit_select(void)
+{
+	const char * forced;
+
+	if (blit_impl) {
+		return blit_impl;
+	}
+
+	forced = getenv("LVGUI_BLIT");
+	blit_impl = blit_find(forced);
+
+	if (!blit_impl) {
+		err("'%s' blit implementation not available here", forced);
+		blit_impl = blit_find(NULL);
+	}
+
+	info("using '%s' kernels", blit_impl->name);
+
+	return blit_impl;
+}
+
+// }}}
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * @file blit.h
+ *
+ * Pixel copy kernels shared by the framebuffer drivers.
+ *
+ */
+
+#ifndef BLIT_H
+#define BLIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#ifndef LV_DRV_NO_CONF
+#ifdef LV_CONF_INCLUDE_SIMPLE
+#include "lv_drv_conf.h"
+#else
+#include "../../lv_drv_conf.h"
+#endif
+#endif
+
+#if USE_FBDEV || USE_DRM || USE_HEADLESS
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Rotation applied to the pixels while copying them.
+ * Quarter turns are given in the direction the image turns.
+ */
+enum blit_rotation {
+	BLIT_ROTATE_0,
+	BLIT_ROTATE_180,
+	BLIT_ROTATE_CW,
+	BLIT_ROTATE_CCW,
+};
+typedef enum blit_rotation blit_rotation_t;
+
+/**
+ * Pixel formats pixels can be converted to, named as the DRM formats.
+ * Components are listed from the most significant bits of a little endian word.
+ */
+enum blit_format {
+	BLIT_FORMAT_XRGB8888,
+	BLIT_FORMAT_XBGR8888,
+	BLIT_FORMAT_RGB888,
+	BLIT_FORMAT_BGR888,
+	BLIT_FORMAT_RGB565,
+	BLIT_FORMAT_BGR565,
+};
+typedef enum blit_format blit_format_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Copy a `w`×`h` area of 32 bit pixels, rotating it on the way.
+ * @param rotation rotation to apply
+ * @param src first pixel of the source area
+ * @param src_stride length of a source line, in bytes
+ * @param dst top left pixel of the destination area, which is `h`×`w` for quarter turns
+ * @param dst_stride length of a destination line, in bytes
+ * @param w width of the source area, in pixels
+ * @param h height of the source area, in pixels
+ */
+void blit_rotate_32(blit_rotation_t rotation, const uint32_t * src, uint32_t src_stride, uint32_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h);
+
+/**
+ * Same as `blit_rotate_32`, for 16 bit pixels.
+ */
+void blit_rotate_16(blit_rotation_t rotation, const uint16_t * src, uint32_t src_stride, uint16_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h);
+
+/**
+ * Same as `blit_rotate_32`, converting the XRGB8888 pixels to `format` in the same pass.
+ * @param format format of the destination pixels
+ * @param dither whether to dither the components losing precision, with a 4×4 ordered pattern
+ * @param dst_x horizontal position of `dst` on the screen, keeping the dithering pattern in place
+ * @param dst_y vertical position of `dst` on the screen
+ */
+void blit_convert_32(blit_rotation_t rotation, blit_format_t format, bool dither, const uint32_t * src, uint32_t src_stride, void * dst, uint32_t dst_stride, uint32_t dst_x, uint32_t dst_y, uint32_t w, uint32_t h);
+
+/**
+ * Same as `blit_rotate_32`, scaling the area up by `num`/`den` on the way, to the nearest pixels.
+ * The area is placed on a grid of the scaled size, so areas scaled separately join without
+ * gaps or overlaps; see `blit_scale_coord`.
+ * @param num numerator of the scale, at least `den`
+ * @param den denominator of the scale
+ * @param src_x horizontal position of `src` in the unscaled image
+ * @param src_y vertical position of `src` in the unscaled image
+ * @param dst top left pixel of the scaled area, placed as for `blit_rotate_32`
+ */
+void blit_scale_32(blit_rotation_t rotation, uint32_t num, uint32_t den, const uint32_t * src, uint32_t src_stride, uint32_t src_x, uint32_t src_y, uint32_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h);
+
+/**
+ * Same as `blit_scale_32`, for 16 bit pixels.
+ */
+void blit_scale_16(blit_rotation_t rotation, uint32_t num, uint32_t den, const uint16_t * src, uint32_t src_stride, uint32_t src_x, uint32_t src_y, uint16_t * dst, uint32_t dst_stride, uint32_t w, uint32_t h);
+
+/**
+ * Where the pixel at `x` in an image lands once scaled by `num`/`den`.
+ * The pixels from `x1` to `x2` cover the scaled ones from `blit_scale_coord(x1)` to `blit_scale_coord(x2 + 1) - 1`.
+ */
+uint32_t blit_scale_coord(uint32_t x, uint32_t num, uint32_t den);
+
+/**
+ * Size of a pixel of the format, in bytes.
+ */
+uint32_t blit_format_size(blit_format_t format);
+
+/**
+ * Name of the kernels implementation in use.
+ * The implementation is picked at runtime according to the CPU features.
+ * Setting `LVGUI_BLIT` in the environment to the name of an implementation forces it;
+ * `reference` is the plain per-pixel implementation, for validating the others.
+ */
+const char * blit_get_impl(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif  /*USE_FBDEV || USE_DRM || USE_HEADLESS*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*BLIT_H*/
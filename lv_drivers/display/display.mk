@@ -1,5 +1,9 @@
+CSRCS += async_flush.c
+CSRCS += blit.c
 CSRCS += drm.c
 CSRCS += fbdev.c
+CSRCS += flush_hash.c
+CSRCS += headless.c
 CSRCS += monitor.c
 
 DEPPATH += --dep-path $(LVGL_DIR)/lv_drivers/display
@@ -26,15 +26,22 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <glob.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
+#include "lv_drivers/display/async_flush.h"
+#include "lv_drivers/display/blit.h"
 #include "lv_drivers/display/fbdev.h"
+#include "lv_drivers/display/flush_hash.h"
 
 // #define DRV_DEBUG
 
@@ -47,36 +54,195 @@
 #define dbg(msg, ...) {}
 #endif
 
+// How many damaged areas are tracked per frame before merging the
+// extra ones together.
+#define DRM_DAMAGE_MAX LV_INV_BUF_SIZE
+
+// How many changed bands of a flushed area are copied separately, with DRM_SKIP_UNCHANGED.
+#define DRM_FLUSH_BANDS 8
+
+// How long a thread waiting on a page flip polls the device at once. Outputs
+// share the device; a thread may handle the event another one waits for.
+#define DRM_FLIP_POLL_MS 4
+
+// Buffers are scanned out in the format LVGL renders in; XRGB8888 or RGB565.
+#if LV_COLOR_DEPTH == 32
+#define DRM_BPP 32
+#elif LV_COLOR_DEPTH == 16 && !LV_COLOR_16_SWAP
+#define DRM_BPP 16
+#else
+#error "The DRM driver needs LV_COLOR_DEPTH 32, or 16 without LV_COLOR_16_SWAP"
+#endif
+
+struct modeset_buf;
 struct modeset_dev;
 static int modeset_find_crtc(int fd, drmModeRes *res, drmModeConnector *conn, struct modeset_dev *dev);
-static int modeset_create_fb(int fd, struct modeset_dev *dev);
+static int modeset_create_fb(int fd, struct modeset_buf *buf);
+static void modeset_destroy_fb(int fd, struct modeset_buf *buf);
 static int modeset_setup_dev(int fd, drmModeRes *res, drmModeConnector *conn, struct modeset_dev *dev);
 static int modeset_open(int *out, const char *node);
 static int modeset_prepare(int fd);
-
-static void dbg_fill_buffer(struct modeset_dev *iter, uint8_t r, uint8_t g, uint8_t b);
-
-struct modeset_dev {
-	struct modeset_dev *next;
-
+static int modeset_get_prop(int fd, uint32_t obj_id, uint32_t obj_type, const char *name, uint32_t *prop_id, uint64_t *value);
+static int modeset_setup_atomic(int fd, struct modeset_dev *dev);
+static int modeset_commit_atomic(struct modeset_dev *dev, struct modeset_buf *buf);
+static int modeset_setup_rotation(int fd, struct modeset_dev *dev);
+static int modeset_commit_modeset(struct modeset_dev *dev, struct modeset_buf *buf, uint32_t flags);
+static void modeset_dirty_fb(struct modeset_dev *dev, struct modeset_buf *buf);
+static void modeset_page_flip_event(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data);
+static void modeset_wait_flip(struct modeset_dev *dev);
+static void modeset_flip_done(struct modeset_dev *dev);
+static void modeset_begin_frame(struct modeset_dev *dev);
+static void modeset_add_damage(struct modeset_dev *dev, const lv_area_t *area);
+static void modeset_copy_area(struct modeset_dev *dev, const lv_area_t *area, const lv_color_t *color_p, lv_coord_t stride);
+static void modeset_present(struct modeset_dev *dev);
+static void modeset_flush_zero_copy(struct modeset_dev *dev, lv_disp_drv_t *disp_drv, lv_color_t *color_p);
+static int modeset_poll_events(struct modeset_dev *dev, int timeout);
+static void modeset_vblank_task(lv_task_t *task);
+static void modeset_cursor_place(struct modeset_dev *dev);
+static void modeset_cursor_update(struct modeset_dev *dev);
+static void modeset_cursor_setup_alpha(struct modeset_dev *dev);
+static void modeset_cursor_set_alpha(struct modeset_dev *dev, lv_opa_t opa);
+static void modeset_setup_render_scale(struct modeset_dev *dev);
+static drm_orientation_t modeset_get_orientation(int fd, struct modeset_dev *dev);
+
+static void dbg_fill_buffer(struct modeset_buf *buf, uint8_t r, uint8_t g, uint8_t b);
+
+struct modeset_buf {
 	uint32_t width;
 	uint32_t height;
+	uint32_t bpp;
 	uint32_t stride;
 	uint32_t size;
 	uint32_t handle;
 	uint8_t *map;
+	uint32_t fb;
+};
+
+struct modeset_dev {
+	struct modeset_dev *next;
+
+	uint32_t width;
+	uint32_t height;
+
+	// The buffer at `front_buf` is being scanned out, the other one is drawn into.
+	unsigned int front_buf;
+	struct modeset_buf bufs[2];
 
 	drmModeModeInfo mode;
-	uint32_t fb;
 	uint32_t conn;
 	uint32_t crtc;
+	uint32_t crtc_index;
 	drmModeCrtc *saved_crtc;
 
+	// Primary plane of the CRTC, only used when presenting through atomic commits.
+	bool atomic;
+	uint32_t plane;
+	struct {
+		uint32_t fb_id;
+		uint32_t fb_damage_clips;
+		uint32_t crtc_id;
+		uint32_t src_x;
+		uint32_t src_y;
+		uint32_t src_w;
+		uint32_t src_h;
+		uint32_t crtc_x;
+		uint32_t crtc_y;
+		uint32_t crtc_w;
+		uint32_t crtc_h;
+		uint32_t rotation;
+	} plane_props;
+
+	// The primary plane rotates the buffers at scanout; the CRTC is then set
+	// through an atomic commit, with these properties.
+	bool hw_rotation;
+	uint64_t rotation;
+	uint32_t mode_blob;
+	struct {
+		uint32_t mode_id;
+		uint32_t active;
+	} crtc_props;
+	struct {
+		uint32_t crtc_id;
+	} conn_props;
+
+	// Orientation of the panel, from the connector properties.
+	drm_orientation_t orientation;
+	// Orientation the pixels are rotated to when flushing.
+	// Normal when the plane rotates them instead.
+	drm_orientation_t sw_orientation;
+
+	// LVGL renders at render_num/render_den of the resolution, scaled up
+	// when flushing (see DRM_RENDER_SCALE_NUM).
+	uint32_t render_num;
+	uint32_t render_den;
+
+	// Sprite shown on the cursor plane (see drm_cursor_init).
+	struct {
+		bool available;
+		bool hidden;
+		// The buffer at `front` is shown; the other one is drawn into, then swapped,
+		// so the sprite never changes while it is scanned out.
+		unsigned int front;
+		struct modeset_buf bufs[2];
+		// Image in the front buffer, and the opacity its pixels were faded to.
+		const lv_img_dsc_t * img;
+		lv_opa_t img_opa;
+		// "alpha" property of the cursor plane, fading the sprite at scanout; 0 if missing.
+		uint32_t plane;
+		uint32_t alpha_prop;
+		lv_opa_t opa;
+		// Size and position of the image, in display coordinates.
+		lv_coord_t w;
+		lv_coord_t h;
+		lv_coord_t x;
+		lv_coord_t y;
+		// Position of the buffer on the CRTC.
+		int crtc_x;
+		int crtc_y;
+	} cursor;
+
+	// The driver does not implement drmModeDirtyFB.
+	bool no_dirty_fb;
+
+	// The CRTC has been set to scan out one of our buffers.
+	bool mode_set;
+	// The driver refused a page flip once, present through drmModeSetCrtc.
+	bool no_page_flip;
+	// A page flip was queued, and its completion event was not received yet.
+	bool pflip_pending;
+	// When the pending page flip was queued, in LVGL ticks.
+	uint32_t pflip_time;
+	// The vblank at which the last page flip completed.
+	bool vblank_valid;
+	uint32_t vblank_sequence;
+	uint64_t vblank_usec;
+	// The back buffer has been prepared for the frame being rendered.
+	bool frame_started;
+	// LVGL renders directly into the buffers (see drm_init_disp_buf).
+	bool zero_copy;
+	// Display whose flush is the pending page flip, made ready once it completes.
+	lv_disp_drv_t *flush_drv;
+
+	// Areas, in buffer coordinates, changed in the frame being rendered...
+	lv_area_t damage[DRM_DAMAGE_MAX];
+	uint32_t damage_count;
+	// ... and in the frame presented last, which the back buffer lacks.
+	lv_area_t prev_damage[DRM_DAMAGE_MAX];
+	uint32_t prev_damage_count;
+
+	// Flushed content, to skip copying what did not change (see DRM_SKIP_UNCHANGED).
+	flush_hash_t flush_hash;
+
 	int fd;
 };
 
+// Outputs, in the order of their connectors; the first one is the primary display.
 static struct modeset_dev *modeset_list = NULL;
 
+// Serializes handling the events of the device, shared by the outputs
+// which may be flushed from different threads.
+static pthread_mutex_t modeset_event_lock = PTHREAD_MUTEX_INITIALIZER;
+
 drm_orientation_t drm_display_orientation;
 
 /****************************************
@@ -85,108 +251,93 @@ drm_orientation_t drm_display_orientation;
 
 void drm_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p)
 {
-	int ret;
-	// Pick the first device
-	struct modeset_dev* dev = modeset_list;
+	// The output this display was set up for.
+	struct modeset_dev* dev = disp_drv->user_data;
 
-	if (modeset_list->fd < 0) {
+	if (dev->fd < 0) {
 		err("drm_flush called when DRM device is not initialized properly.");
 
 		return;
 	}
 
-	lv_coord_t w = (area->x2 - area->x1 + 1);
-	lv_coord_t h = (area->y2 - area->y1 + 1);
-	int i, y, x = 0;
+	// Ready once the page flip completes.
+	if (dev->zero_copy) {
+		modeset_flush_zero_copy(dev, disp_drv, color_p);
 
-	dbg("drm_flush() x %d:%d y %d:%d w %d h %d", area->x1, area->x2, area->y1, area->y2, w, h);
-
-	// TODO: for a partial update, copy current framebuffer into back buffer before doing the partial update.
-	// Partial update, so we need to update the back buffer with the front buffer content first.
-	// if ((w != modeset_list->width || h != modeset_list->height) && modeset_list->cur_bufs[1])
-	// 	memcpy(dev->map, modeset_list->cur_bufs[1]->map, dev->size);
-	(int) h; // temporary until ^ is added back...
+		return;
+	}
 
-	// Just in case, this is most likely a BUG in this driver.
-	if (drm_display_orientation == DRM_ORIENTATION_NORMAL || drm_display_orientation == DRM_ORIENTATION_UPSIDE_DOWN) {
-		if (area->y2 > modeset_list->height) {
-			err("drm_flush() too large to fit in buffer!!!! [BUG!!]");
-			return;
-		}
+	// The flush thread takes it from there.
+	if (async_flush_queue(disp_drv, area, color_p)) {
+		return;
 	}
-	else {
-		if (area->y2 > modeset_list->width) {
-			err("drm_flush() too large to fit in buffer!!!! [BUG!!]");
-			return;
-		}
+
+	drm_flush_area(disp_drv, area, color_p, lv_disp_flush_is_last(disp_drv));
+	lv_disp_flush_ready(disp_drv);
+}
+
+void drm_wait(lv_disp_drv_t *disp_drv)
+{
+	// The output this display was set up for.
+	struct modeset_dev* dev = disp_drv->user_data;
+
+	// Flushes are otherwise made ready by the flush thread, or right away.
+	if (dev->zero_copy) {
+		modeset_wait_flip(dev);
 	}
+}
 
-	switch (drm_display_orientation) {
-		case DRM_ORIENTATION_NORMAL:
-			for (y = 0, i = area->y1 ; i <= area->y2 ; ++i, ++y) {
-				memcpy(
-					(uint8_t *)dev->map + (area->x1 * (LV_COLOR_SIZE/8)) + (dev->stride * i),
-					(uint8_t *)color_p + (w * (LV_COLOR_SIZE/8) * y),
-					w * (LV_COLOR_SIZE/8)
-				);
-			}
-			break;
-		case DRM_ORIENTATION_UPSIDE_DOWN:
-			{
-				int off = 0;
-				for (y = area->y1; y <= area->y2 && y < disp_drv->ver_res; y++) {
-					for (x = area->x1; x <= area->x2 && x < disp_drv->hor_res; x++) {
-						off = dev->stride * (disp_drv->ver_res - y - 1) + (disp_drv->hor_res - x) * 4;
-						*(uint32_t*)&dev->map[off] = lv_color_to32(*color_p);
-						color_p++;
-					}
-				}
-			}
-			break;
-		case DRM_ORIENTATION_CLOCKWISE:
-			{
-				int off = 0;
-				for (y = area->y1; y <= area->y2 && y < disp_drv->hor_res; y++) {
-					for (x = area->x1; x <= area->x2 && x < disp_drv->ver_res; x++) {
-						off = dev->stride * x + (disp_drv->hor_res - y) * 4;
-						*(uint32_t*)&dev->map[off] = lv_color_to32(*color_p);
-						color_p++;
-					}
-				}
-			}
-			break;
-		case DRM_ORIENTATION_COUNTER_CLOCKWISE:
-			{
-				int off = 0;
-				for (y = area->y1; y <= area->y2 && y < disp_drv->hor_res; y++) {
-					for (x = area->x1; x <= area->x2 && x < disp_drv->ver_res; x++) {
-						off = dev->stride * (disp_drv->ver_res - x - 1) + y * 4;
-						*(uint32_t*)&dev->map[off] = lv_color_to32(*color_p);
-						color_p++;
-					}
-				}
-			}
-			break;
+void drm_flush_area(lv_disp_drv_t *disp_drv, const lv_area_t *area, const lv_color_t *color_p, bool last)
+{
+	// The output this display was set up for.
+	struct modeset_dev* dev = disp_drv->user_data;
+	lv_coord_t w = (area->x2 - area->x1 + 1);
+#if DRM_SKIP_UNCHANGED
+	lv_area_t bands[DRM_FLUSH_BANDS];
+	uint32_t count;
+	uint32_t i;
+#endif
+
+	dbg("drm_flush() x %d:%d y %d:%d w %d h %d", area->x1, area->x2, area->y1, area->y2, w, lv_area_get_height(area));
+
+	// First flush of a refresh cycle; bring the back buffer up to date.
+	if (!dev->frame_started) {
+		modeset_begin_frame(dev);
 	}
 
-	// This normally is used with double-buffering, where we would flip to
-	// another buffer, rather than presenting the same buffer.
-	// Though, this does allow rendering to work on some devices (e.g. SDM845).
-	// This also serves to do the actual modesetting.
-	ret = drmModeSetCrtc(dev->fd, dev->crtc, dev->fb, 0, 0,
-			&dev->conn, 1, &dev->mode);
-	if (ret) {
-		err("cannot flip CRTC for connector %u (%d): %m", dev->conn, errno);
+#if DRM_SKIP_UNCHANGED
+	if (dev->flush_hash.hashes) {
+		count = flush_hash_diff(&dev->flush_hash, area, color_p, bands, DRM_FLUSH_BANDS);
+		for (i = 0; i < count; i++) {
+			modeset_copy_area(
+				dev, &bands[i],
+				color_p + (bands[i].y1 - area->y1) * w + (bands[i].x1 - area->x1), w
+			);
+		}
+	}
+	else
+#endif
+	{
+		modeset_copy_area(dev, area, color_p, w);
 	}
 
-	lv_disp_flush_ready(disp_drv);
+	// Only present once every area of this refresh cycle is in the back buffer.
+	if (last) {
+		// Nothing changed; the back buffer already matches the front buffer.
+		if (dev->mode_set && !dev->damage_count) {
+			dev->prev_damage_count = 0;
+			dev->frame_started = false;
+		}
+		else {
+			modeset_present(dev);
+		}
+	}
 }
 
 void drm_init(lv_disp_drv_t* drv)
 {
 	int fd = 0;
 	int ret = 0;
-	struct modeset_dev *dev;
 
 	// Ensure drivers peeking at DRM orientation gets something sensible as a default value.
 	drm_display_orientation = DRM_ORIENTATION_NORMAL;
@@ -223,72 +374,15 @@ void drm_init(lv_disp_drv_t* drv)
 
 	if (ret) goto err;
 
-	// Prepare for later modesetting on the first found connector+CRTC
-	// Delaying until the first render prevents a needless unsightly black frame.
-	dev = modeset_list;
-	dev->saved_crtc = drmModeGetCrtc(fd, dev->crtc);
-
-#ifdef DRV_DEBUG
-	dbg_fill_buffer(dev, 0x00, 0xFF, 0x00);
-#endif
-
-	{
-		int i;
-		char * name = 0;
-		uint64_t value;
-		drmModeObjectProperties *props;
-		drmModePropertyRes *prop;
-
-		props = drmModeObjectGetProperties(fd, dev->conn, DRM_MODE_OBJECT_CONNECTOR);
-		if (props) {
-			for (i = 0; i < props->count_props; i++) {
-				prop = drmModeGetProperty(fd, props->props[i]);
-				value = props->prop_values[i];
-				dbg("prop->name = %s; (value = %lu) (count_enums = %d) (count_values = %d)", prop->name, value, prop->count_enums, prop->count_values);
-				if (!strcmp(prop->name, "panel orientation")) {
-					for (i = 0; i < prop->count_enums; i++) {
-						name = prop->enums[i].name;
-						dbg("name = %s", name)
-						dbg("value = %llu", prop->enums[i].value)
-						if (value == prop->enums[i].value) {
-							if (!strcmp(name, "Normal")) {
-								drm_display_orientation = DRM_ORIENTATION_NORMAL;
-							}
-							else if (!strcmp(name, "Upside Down")) {
-								drm_display_orientation = DRM_ORIENTATION_UPSIDE_DOWN;
-							}
-							else if (!strcmp(name, "Left Side Up")) {
-								drm_display_orientation = DRM_ORIENTATION_COUNTER_CLOCKWISE;
-							}
-							else if (!strcmp(name, "Right Side Up")) {
-								drm_display_orientation = DRM_ORIENTATION_CLOCKWISE;
-							}
-							break;
-						}
-					}
-
-					// We only care about panel orientation
-					info("DRM panel orientation from property: %s (%d)", name, drm_display_orientation);
-					break;
-				}
-				drmModeFreeProperty(prop);
-			}
-			drmModeFreeObjectProperties(props);
-		}
+	if (!modeset_list) {
+		err("no connected display found");
+		goto err;
 	}
 
-	drv->hor_res = modeset_list->width;
-	drv->ver_res = modeset_list->height;
-
-	if (drm_display_orientation == DRM_ORIENTATION_NORMAL || drm_display_orientation == DRM_ORIENTATION_UPSIDE_DOWN) {
-		drv->rotated = 0;
-	}
-	else {
-		drv->rotated = 1;
-	}
+	// The first output is the primary display, and the only one set up here.
+	if (!drm_init_output(drv, 0)) goto err;
 
 	goto ok;
-	goto err;
 
 err:
 	if (modeset_list) {
@@ -304,286 +398,1703 @@ ok:
 	info("DRM subsystem and buffer mapped successfully");
 }
 
-void drm_exit(void)
+uint32_t drm_get_output_count(void)
 {
-	close(modeset_list->fd);
-	modeset_list->fd = -1;
+	struct modeset_dev *dev;
+	uint32_t count = 0;
+
+	for (dev = modeset_list; dev; dev = dev->next) {
+		count++;
+	}
+
+	return count;
 }
 
+bool drm_init_output(lv_disp_drv_t *drv, uint32_t index)
+{
+	struct modeset_dev *dev = modeset_list;
+	uint32_t i;
 
-/****************************************
- *          STATIC FUNCTIONS            *
- ***************************************/
+	for (i = 0; dev && i < index; i++) {
+		dev = dev->next;
+	}
+	if (!dev || dev->fd < 0) {
+		err("no output %u", index);
+		return false;
+	}
 
-// {{{ Generic modeset handling
+	// Prepare for later modesetting on this connector+CRTC
+	// Delaying until the first render prevents a needless unsightly black frame.
+	dev->saved_crtc = drmModeGetCrtc(dev->fd, dev->crtc);
 
-static int modeset_open(int *out, const char *node)
-{
-	int fd, ret;
-	uint64_t has_dumb;
+	// Presenting through atomic commits allows passing damage clips along.
+	// Otherwise legacy page flips are used.
+	modeset_setup_atomic(dev->fd, dev);
 
-	fd = open(node, O_RDWR | O_CLOEXEC);
-	if (fd < 0) {
-		ret = -errno;
-		err("cannot open '%s': %m", node);
-		return ret;
+#ifdef DRV_DEBUG
+	dbg_fill_buffer(&dev->bufs[dev->front_buf], 0x00, 0xFF, 0x00);
+#endif
+
+	dev->orientation = modeset_get_orientation(dev->fd, dev);
+	// Input devices are rotated along the primary display.
+	if (index == 0) {
+		drm_display_orientation = dev->orientation;
 	}
 
-	if (drmGetCap(fd, DRM_CAP_DUMB_BUFFER, &has_dumb) < 0 ||
-	    !has_dumb) {
-			err("drm device '%s' does not support dumb buffers", node);
-		close(fd);
-		return -EOPNOTSUPP;
+	// Rotating at scanout, when possible, saves rotating every pixel when flushing.
+	modeset_setup_rotation(dev->fd, dev);
+
+	modeset_setup_render_scale(dev);
+
+	drv->hor_res = dev->width * dev->render_num / dev->render_den;
+	drv->ver_res = dev->height * dev->render_num / dev->render_den;
+
+	if (dev->orientation == DRM_ORIENTATION_NORMAL || dev->orientation == DRM_ORIENTATION_UPSIDE_DOWN) {
+		drv->rotated = 0;
+	}
+	else {
+		drv->rotated = 1;
 	}
 
-	*out = fd;
-	return 0;
+#if DRM_SKIP_UNCHANGED
+	// Hashed as LVGL renders, with the resolution swapped for quarter turns.
+	if (drv->rotated) {
+		flush_hash_init(&dev->flush_hash, drv->ver_res, drv->hor_res);
+	}
+	else {
+		flush_hash_init(&dev->flush_hash, drv->hor_res, drv->ver_res);
+	}
+#endif
+
+	drv->user_data = dev;
+	drv->flush_cb = drm_flush;
+	drv->wait_cb = drm_wait;
+
+	if (index > 0) {
+		info("output %u on connector %u: %ux%u", index, dev->conn, dev->width, dev->height);
+	}
+
+	return true;
 }
 
-static int modeset_prepare(int fd)
+bool drm_init_disp_buf(lv_disp_buf_t * disp_buf)
 {
-	drmModeRes *res;
-	drmModeConnector *conn;
-	unsigned int i;
-	struct modeset_dev *dev;
-	int ret;
+#if DRM_ZERO_COPY
+	struct modeset_dev *dev = modeset_list;
+	struct modeset_buf *back;
 
-	/* retrieve resources */
-	res = drmModeGetResources(fd);
-	if (!res) {
-		err("cannot retrieve DRM resources (%d): %m", errno);
-		return -errno;
+	if (!dev || dev->fd < 0) {
+		return false;
 	}
 
-	/* iterate all connectors */
-	// Keeps only the first found and working device.
-	for (i = 0; i < res->count_connectors; ++i) {
-		/* get information for each connector */
-		conn = drmModeGetConnector(fd, res->connectors[i]);
-		if (!conn) {
-			err("cannot retrieve DRM connector %u:%u (%d): %m", i, res->connectors[i], errno);
-			continue;
-		}
+	if (dev->sw_orientation != DRM_ORIENTATION_NORMAL) {
+		info("Not rendering directly in scanout buffers: panel is rotated in software");
+		return false;
+	}
 
-		/* create a device structure */
-		dev = malloc(sizeof(*dev));
-		memset(dev, 0, sizeof(*dev));
-		dev->fd = fd;
-		dev->conn = conn->connector_id;
+	if (dev->render_num != dev->render_den) {
+		info("Not rendering directly in scanout buffers: rendering at %u/%u of the resolution", dev->render_num, dev->render_den);
+		return false;
+	}
 
-		/* call helper function to prepare this connector */
-		ret = modeset_setup_dev(fd, res, conn, dev);
-		if (ret) {
-			if (ret != -ENOENT) {
-				errno = -ret;
-				err("cannot setup device for connector %u:%u (%d): %m", i, res->connectors[i], errno);
-			}
-			free(dev);
-			drmModeFreeConnector(conn);
-			continue;
-		}
+	if (dev->bufs[0].stride != dev->bufs[0].width * sizeof(lv_color_t) || dev->bufs[1].stride != dev->bufs[1].width * sizeof(lv_color_t)) {
+		info("Not rendering directly in scanout buffers: stride %u does not match width %u", dev->bufs[0].stride, dev->bufs[0].width);
+		return false;
+	}
 
-		/* free connector data and link device into global list */
-		drmModeFreeConnector(conn);
-		dev->next = modeset_list;
-		modeset_list = dev;
+	// LVGL starts rendering in `buf1`, make it the back buffer.
+	back = &dev->bufs[dev->front_buf ^ 1];
+	lv_disp_buf_init(
+		disp_buf,
+		back->map,
+		dev->bufs[dev->front_buf].map,
+		dev->bufs[0].width * dev->bufs[0].height
+	);
+	dev->zero_copy = true;
 
-		// Only work off the first found connector
-		break;
-	}
+	// LVGL renders in place; there is no copy to skip.
+	free(dev->flush_hash.hashes);
+	dev->flush_hash.hashes = NULL;
 
-	/* free resources again */
-	drmModeFreeResources(res);
-	return 0;
+	info("Rendering directly in scanout buffers");
+
+	return true;
+#else
+	(void) disp_buf;
+
+	return false;
+#endif
 }
 
-static int modeset_setup_dev(int fd, drmModeRes *res, drmModeConnector *conn,
-			     struct modeset_dev *dev)
+drm_rotation_path_t drm_get_rotation_path(void)
 {
-	int ret;
+	struct modeset_dev *dev = modeset_list;
 
-	/* check if a monitor is connected */
-	if (conn->connection != DRM_MODE_CONNECTED) {
-		err("ignoring unused connector %u", conn->connector_id);
-		return -ENOENT;
+	if (!dev || dev->orientation == DRM_ORIENTATION_NORMAL) {
+		return DRM_ROTATION_NONE;
 	}
 
-	/* check if there is at least one valid mode */
-	if (conn->count_modes == 0) {
-		err("no valid mode for connector %u", conn->connector_id);
-		return -EFAULT;
-	}
+	return dev->hw_rotation ? DRM_ROTATION_HARDWARE : DRM_ROTATION_SOFTWARE;
+}
 
-	/* copy the mode information into our device structure */
-	memcpy(&dev->mode, &conn->modes[0], sizeof(dev->mode));
-	dev->width = conn->modes[0].hdisplay;
-	dev->height = conn->modes[0].vdisplay;
-	info("mode for connector %u is %ux%u", conn->connector_id, dev->width, dev->height);
+bool drm_get_render_scale(uint32_t * num, uint32_t * den)
+{
+	struct modeset_dev *dev = modeset_list;
 
-	/* find a crtc for this connector */
-	ret = modeset_find_crtc(fd, res, conn, dev);
-	if (ret) {
-		err("no valid crtc for connector %u", conn->connector_id);
-		return ret;
+	if (!dev || dev->render_num == dev->render_den) {
+		return false;
 	}
 
-	/* create a framebuffer for this CRTC */
-	ret = modeset_create_fb(fd, dev);
-	if (ret) {
-		err("cannot create framebuffer for connector %u", conn->connector_id);
-		return ret;
+	if (num) {
+		*num = dev->render_num;
+	}
+	if (den) {
+		*den = dev->render_den;
 	}
 
-	return 0;
+	return true;
 }
 
-static int modeset_find_crtc(int fd, drmModeRes *res, drmModeConnector *conn,
-			     struct modeset_dev *dev)
+bool drm_cursor_init(void)
 {
-	drmModeEncoder *enc;
-	unsigned int i, j;
-	int32_t crtc;
-	struct modeset_dev *iter;
+	struct modeset_dev *dev = modeset_list;
+	uint64_t width = 64;
+	uint64_t height = 64;
+	int i;
 
-	/* first try the currently conected encoder+crtc */
-	if (conn->encoder_id)
-		enc = drmModeGetEncoder(fd, conn->encoder_id);
-	else
-		enc = NULL;
+	if (!dev || dev->fd < 0) {
+		return false;
+	}
 
-	if (enc) {
-		if (enc->crtc_id) {
-			crtc = enc->crtc_id;
-			for (iter = modeset_list; iter; iter = iter->next) {
-				if (iter->crtc == crtc) {
-					crtc = -1;
-					break;
-				}
-			}
+	if (dev->cursor.available) {
+		return true;
+	}
 
-			if (crtc >= 0) {
-				drmModeFreeEncoder(enc);
-				dev->crtc = crtc;
-				return 0;
+	// Drivers not exposing the capabilities only support 64×64 cursors.
+	drmGetCap(dev->fd, DRM_CAP_CURSOR_WIDTH, &width);
+	drmGetCap(dev->fd, DRM_CAP_CURSOR_HEIGHT, &height);
+
+	// Cursor planes are only guaranteed to take ARGB8888 pixels.
+	for (i = 0; i < 2; i++) {
+		dev->cursor.bufs[i].width = width;
+		dev->cursor.bufs[i].height = height;
+		dev->cursor.bufs[i].bpp = 32;
+		if (modeset_create_fb(dev->fd, &dev->cursor.bufs[i])) {
+			err("cannot create cursor buffer for connector %u", dev->conn);
+			if (i) {
+				modeset_destroy_fb(dev->fd, &dev->cursor.bufs[0]);
 			}
+			return false;
 		}
+	}
 
-		drmModeFreeEncoder(enc);
+	// Probing by hiding the cursor; fails when the CRTC has no cursor plane.
+	if (drmModeSetCursor(dev->fd, dev->crtc, 0, 0, 0)) {
+		info("no cursor plane on CRTC %u (%d): %m", dev->crtc, errno);
+		modeset_destroy_fb(dev->fd, &dev->cursor.bufs[0]);
+		modeset_destroy_fb(dev->fd, &dev->cursor.bufs[1]);
+		return false;
 	}
 
-	/* If the connector is not currently bound to an encoder or if the
-	 * encoder+crtc is already used by another connector (actually unlikely
-	 * but lets be safe), iterate all other available encoders to find a
-	 * matching CRTC. */
-	for (i = 0; i < conn->count_encoders; ++i) {
-		enc = drmModeGetEncoder(fd, conn->encoders[i]);
+	dev->cursor.available = true;
+	dev->cursor.hidden = true;
+	dev->cursor.front = 0;
+	dev->cursor.img = NULL;
+	dev->cursor.opa = LV_OPA_COVER;
+	modeset_cursor_setup_alpha(dev);
+	info("using the cursor plane (%ux%u, fading %s)", dev->cursor.bufs[0].width, dev->cursor.bufs[0].height, dev->cursor.alpha_prop ? "at scanout" : "the pixels");
+
+	return true;
+}
+
+bool drm_cursor_set_image(const lv_img_dsc_t * img, lv_opa_t opa)
+{
+	struct modeset_dev *dev = modeset_list;
+	struct modeset_buf *buf;
+	lv_opa_t img_opa;
+	blit_rotation_t rotation = BLIT_ROTATE_0;
+	bool quarter_turn = false;
+	uint32_t x, y;
+	uint8_t *px;
+	const uint32_t *pixels;
+#if LV_COLOR_DEPTH != 32
+	uint32_t *argb;
+	uint32_t i;
+	lv_color_t color;
+#endif
+
+	if (!dev->cursor.available) {
+		return false;
+	}
+
+	// With the plane fading the sprite, the pixels are kept opaque...
+	img_opa = dev->cursor.alpha_prop ? LV_OPA_COVER : opa;
+	if (img == dev->cursor.img && img_opa == dev->cursor.img_opa) {
+		modeset_cursor_set_alpha(dev, opa);
+		return true;
+	}
+
+	// ... otherwise they are redrawn, in the buffer not shown.
+	buf = &dev->cursor.bufs[dev->cursor.front ^ 1];
+
+	switch (drm_display_orientation) {
+		case DRM_ORIENTATION_NORMAL:
+			rotation = BLIT_ROTATE_0;
+			break;
+		case DRM_ORIENTATION_UPSIDE_DOWN:
+			rotation = BLIT_ROTATE_180;
+			break;
+		case DRM_ORIENTATION_CLOCKWISE:
+			rotation = BLIT_ROTATE_CW;
+			quarter_turn = true;
+			break;
+		case DRM_ORIENTATION_COUNTER_CLOCKWISE:
+			rotation = BLIT_ROTATE_CCW;
+			quarter_turn = true;
+			break;
+	}
+
+	if (
+		img->header.cf != LV_IMG_CF_TRUE_COLOR_ALPHA ||
+		(quarter_turn ? img->header.h : img->header.w) > buf->width ||
+		(quarter_turn ? img->header.w : img->header.h) > buf->height
+	) {
+		err("cannot use a %ux%u image in format %u as cursor", img->header.w, img->header.h, img->header.cf);
+		return false;
+	}
+
+#if LV_COLOR_DEPTH == 32
+	pixels = (const uint32_t *)img->data;
+#else
+	// Images carry their alpha after each pixel; cursor planes take ARGB8888.
+	argb = malloc(img->header.w * img->header.h * sizeof(uint32_t));
+	if (!argb) {
+		return false;
+	}
+	for (i = 0; i < img->header.w * img->header.h; i++) {
+		memcpy(&color, img->data + i * LV_IMG_PX_SIZE_ALPHA_BYTE, sizeof(color));
+		argb[i] = (lv_color_to32(color) & 0x00FFFFFF) | (uint32_t)img->data[i * LV_IMG_PX_SIZE_ALPHA_BYTE + sizeof(color)] << 24;
+	}
+	pixels = argb;
+#endif
+
+	memset(buf->map, 0, buf->size);
+	blit_rotate_32(
+		rotation,
+		pixels, img->header.w * sizeof(uint32_t),
+		(uint32_t *)buf->map, buf->stride,
+		img->header.w, img->header.h
+	);
+
+#if LV_COLOR_DEPTH != 32
+	free(argb);
+#endif
+
+	// The plane does not fade the sprite, the pixels are faded instead.
+	if (img_opa < LV_OPA_MAX) {
+		for (y = 0; y < buf->height; y++) {
+			px = buf->map + buf->stride * y;
+			for (x = 0; x < buf->width * 4; x++) {
+				px[x] = (px[x] * img_opa) >> 8;
+			}
+		}
+	}
+
+	// The new sprite replaces the shown one at once, on the next vblank.
+	dev->cursor.front ^= 1;
+	dev->cursor.img = img;
+	dev->cursor.img_opa = img_opa;
+	dev->cursor.w = img->header.w;
+	dev->cursor.h = img->header.h;
+	modeset_cursor_place(dev);
+	modeset_cursor_update(dev);
+	modeset_cursor_set_alpha(dev, opa);
+
+	return true;
+}
+
+void drm_cursor_move(lv_coord_t x, lv_coord_t y)
+{
+	struct modeset_dev *dev = modeset_list;
+
+	if (!dev->cursor.available) {
+		return;
+	}
+
+	// The sprite is not scaled, only its position.
+	dev->cursor.x = x * (int)dev->render_den / (int)dev->render_num;
+	dev->cursor.y = y * (int)dev->render_den / (int)dev->render_num;
+	modeset_cursor_place(dev);
+
+	if (!dev->cursor.hidden && drmModeMoveCursor(dev->fd, dev->crtc, dev->cursor.crtc_x, dev->cursor.crtc_y)) {
+		dbg("cannot move cursor (%d): %m", errno);
+	}
+}
+
+void drm_cursor_set_hidden(bool hidden)
+{
+	struct modeset_dev *dev = modeset_list;
+
+	if (!dev->cursor.available || dev->cursor.hidden == hidden) {
+		return;
+	}
+
+	dev->cursor.hidden = hidden;
+	modeset_cursor_update(dev);
+}
+
+bool drm_vblank_sync_init(lv_disp_t * disp)
+{
+#if DRM_VBLANK_SYNC
+	struct modeset_dev *dev = disp->driver.user_data;
+
+	if (!dev || dev->fd < 0) {
+		return false;
+	}
+
+	// The periodic refresh is replaced by modeset_vblank_task, running on
+	// every call to lv_task_handler to notice page flips completing as soon as possible.
+	lv_task_set_cb(disp->refr_task, modeset_vblank_task);
+	lv_task_set_period(disp->refr_task, 0);
+#if LV_USE_LATENCY
+	// Frames are shown once their page flip completes, see modeset_vblank_task.
+	disp->driver.present_report = 1;
+#endif
+
+	info("refreshing the display on page flip completion");
+
+	return true;
+#else
+	(void) disp;
+
+	return false;
+#endif
+}
+
+int drm_get_fd(void)
+{
+	if (!modeset_list) {
+		return -1;
+	}
+
+	return modeset_list->fd;
+}
+
+bool drm_is_waiting(lv_disp_t * disp)
+{
+	struct modeset_dev *dev = disp->driver.user_data;
+
+	return async_flush_busy(&disp->driver) || dev->pflip_pending;
+}
+
+bool drm_get_last_vblank(uint32_t * sequence, uint64_t * usec)
+{
+	struct modeset_dev *dev = modeset_list;
+
+	if (!dev || !dev->vblank_valid) {
+		return false;
+	}
+
+	if (sequence) *sequence = dev->vblank_sequence;
+	if (usec) *usec = dev->vblank_usec;
+
+	return true;
+}
+
+void drm_exit(void)
+{
+	struct modeset_dev *dev;
+
+	// All outputs share the file descriptor of the card.
+	close(modeset_list->fd);
+	for (dev = modeset_list; dev; dev = dev->next) {
+		dev->fd = -1;
+	}
+}
+
+
+/****************************************
+ *          STATIC FUNCTIONS            *
+ ***************************************/
+
+// {{{ Generic modeset handling
+
+static int modeset_open(int *out, const char *node)
+{
+	int fd, ret;
+	uint64_t has_dumb;
+
+	fd = open(node, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		ret = -errno;
+		err("cannot open '%s': %m", node);
+		return ret;
+	}
+
+	if (drmGetCap(fd, DRM_CAP_DUMB_BUFFER, &has_dumb) < 0 ||
+	    !has_dumb) {
+			err("drm device '%s' does not support dumb buffers", node);
+		close(fd);
+		return -EOPNOTSUPP;
+	}
+
+	*out = fd;
+	return 0;
+}
+
+static int modeset_prepare(int fd)
+{
+	drmModeRes *res;
+	drmModeConnector *conn;
+	unsigned int i;
+	struct modeset_dev *dev;
+	struct modeset_dev **tail = &modeset_list;
+	int ret;
+
+	/* retrieve resources */
+	res = drmModeGetResources(fd);
+	if (!res) {
+		err("cannot retrieve DRM resources (%d): %m", errno);
+		return -errno;
+	}
+
+	/* iterate all connectors */
+	// Keeps only the first found and working device, unless using them all.
+	for (i = 0; i < res->count_connectors; ++i) {
+		/* get information for each connector */
+		conn = drmModeGetConnector(fd, res->connectors[i]);
+		if (!conn) {
+			err("cannot retrieve DRM connector %u:%u (%d): %m", i, res->connectors[i], errno);
+			continue;
+		}
+
+		/* create a device structure */
+		dev = malloc(sizeof(*dev));
+		memset(dev, 0, sizeof(*dev));
+		dev->fd = fd;
+		dev->conn = conn->connector_id;
+
+		/* call helper function to prepare this connector */
+		ret = modeset_setup_dev(fd, res, conn, dev);
+		if (ret) {
+			if (ret != -ENOENT) {
+				errno = -ret;
+				err("cannot setup device for connector %u:%u (%d): %m", i, res->connectors[i], errno);
+			}
+			free(dev);
+			drmModeFreeConnector(conn);
+			continue;
+		}
+
+		/* free connector data and link device at the end of the global list */
+		drmModeFreeConnector(conn);
+		*tail = dev;
+		tail = &dev->next;
+
+#if !DRM_MULTI_OUTPUT
+		// Only work off the first found connector
+		break;
+#endif
+	}
+
+	/* free resources again */
+	drmModeFreeResources(res);
+	return 0;
+}
+
+static int modeset_setup_dev(int fd, drmModeRes *res, drmModeConnector *conn,
+			     struct modeset_dev *dev)
+{
+	int ret;
+	int i;
+
+	/* check if a monitor is connected */
+	if (conn->connection != DRM_MODE_CONNECTED) {
+		err("ignoring unused connector %u", conn->connector_id);
+		return -ENOENT;
+	}
+
+	/* check if there is at least one valid mode */
+	if (conn->count_modes == 0) {
+		err("no valid mode for connector %u", conn->connector_id);
+		return -EFAULT;
+	}
+
+	/* copy the mode information into our device structure */
+	memcpy(&dev->mode, &conn->modes[0], sizeof(dev->mode));
+	dev->width = conn->modes[0].hdisplay;
+	dev->height = conn->modes[0].vdisplay;
+	dev->bufs[0].width = dev->width;
+	dev->bufs[0].height = dev->height;
+	dev->bufs[0].bpp = DRM_BPP;
+	dev->bufs[1].width = dev->width;
+	dev->bufs[1].height = dev->height;
+	dev->bufs[1].bpp = DRM_BPP;
+	info("mode for connector %u is %ux%u", conn->connector_id, dev->width, dev->height);
+
+	/* find a crtc for this connector */
+	ret = modeset_find_crtc(fd, res, conn, dev);
+	if (ret) {
+		err("no valid crtc for connector %u", conn->connector_id);
+		return ret;
+	}
+
+	/* planes refer to CRTCs by their index */
+	for (i = 0; i < res->count_crtcs; ++i) {
+		if (res->crtcs[i] == dev->crtc) {
+			dev->crtc_index = i;
+			break;
+		}
+	}
+
+	/* create the front framebuffer for this CRTC */
+	ret = modeset_create_fb(fd, &dev->bufs[0]);
+	if (ret) {
+		err("cannot create framebuffer for connector %u", conn->connector_id);
+		return ret;
+	}
+
+	/* create the back framebuffer for this CRTC */
+	ret = modeset_create_fb(fd, &dev->bufs[1]);
+	if (ret) {
+		err("cannot create back framebuffer for connector %u", conn->connector_id);
+		modeset_destroy_fb(fd, &dev->bufs[0]);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int modeset_find_crtc(int fd, drmModeRes *res, drmModeConnector *conn,
+			     struct modeset_dev *dev)
+{
+	drmModeEncoder *enc;
+	unsigned int i, j;
+	int32_t crtc;
+	struct modeset_dev *iter;
+
+	/* first try the currently conected encoder+crtc */
+	if (conn->encoder_id)
+		enc = drmModeGetEncoder(fd, conn->encoder_id);
+	else
+		enc = NULL;
+
+	if (enc) {
+		if (enc->crtc_id) {
+			crtc = enc->crtc_id;
+			for (iter = modeset_list; iter; iter = iter->next) {
+				if (iter->crtc == crtc) {
+					crtc = -1;
+					break;
+				}
+			}
+
+			if (crtc >= 0) {
+				drmModeFreeEncoder(enc);
+				dev->crtc = crtc;
+				return 0;
+			}
+		}
+
+		drmModeFreeEncoder(enc);
+	}
+
+	/* If the connector is not currently bound to an encoder or if the
+	 * encoder+crtc is already used by another connector (actually unlikely
+	 * but lets be safe), iterate all other available encoders to find a
+	 * matching CRTC. */
+	for (i = 0; i < conn->count_encoders; ++i) {
+		enc = drmModeGetEncoder(fd, conn->encoders[i]);
 		if (!enc) {
 			err("cannot retrieve encoder %u:%u (%d): %m", i, conn->encoders[i], errno);
 			continue;
 		}
 
-		/* iterate all global CRTCs */
-		for (j = 0; j < res->count_crtcs; ++j) {
-			/* check whether this CRTC works with the encoder */
-			if (!(enc->possible_crtcs & (1 << j)))
-				continue;
+		/* iterate all global CRTCs */
+		for (j = 0; j < res->count_crtcs; ++j) {
+			/* check whether this CRTC works with the encoder */
+			if (!(enc->possible_crtcs & (1 << j)))
+				continue;
+
+			/* check that no other device already uses this CRTC */
+			crtc = res->crtcs[j];
+			for (iter = modeset_list; iter; iter = iter->next) {
+				if (iter->crtc == crtc) {
+					crtc = -1;
+					break;
+				}
+			}
+
+			/* we have found a CRTC, so save it and return */
+			if (crtc >= 0) {
+				drmModeFreeEncoder(enc);
+				dev->crtc = crtc;
+				return 0;
+			}
+		}
+
+		drmModeFreeEncoder(enc);
+	}
+
+	err("cannot find suitable CRTC for connector %u", conn->connector_id);
+	return -ENOENT;
+}
+
+static int modeset_create_fb(int fd, struct modeset_buf *buf)
+{
+	struct drm_mode_create_dumb creq;
+	struct drm_mode_destroy_dumb dreq;
+	struct drm_mode_map_dumb mreq;
+	int ret;
+
+	/* create dumb buffer */
+	memset(&creq, 0, sizeof(creq));
+	creq.width = buf->width;
+	creq.height = buf->height;
+	creq.bpp = buf->bpp;
+	ret = drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &creq);
+	if (ret < 0) {
+		err("cannot create dumb buffer (%d): %m", errno);
+		return -errno;
+	}
+	buf->stride = creq.pitch;
+	buf->size = creq.size;
+	buf->handle = creq.handle;
+
+	/* create framebuffer object for the dumb-buffer */
+	ret = drmModeAddFB(fd, buf->width, buf->height, buf->bpp == 16 ? 16 : 24, buf->bpp, buf->stride,
+			   buf->handle, &buf->fb);
+	if (ret) {
+		err("cannot create framebuffer (%d): %m", errno);
+		ret = -errno;
+		goto err_destroy;
+	}
+
+	/* prepare buffer for memory mapping */
+	memset(&mreq, 0, sizeof(mreq));
+	mreq.handle = buf->handle;
+	ret = drmIoctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &mreq);
+	if (ret) {
+		err("cannot map dumb buffer (%d): %m", errno);
+		ret = -errno;
+		goto err_fb;
+	}
+
+	/* perform actual memory mapping */
+	buf->map = mmap(0, buf->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		        fd, mreq.offset);
+	if (buf->map == MAP_FAILED) {
+		err("cannot mmap dumb buffer (%d): %m", errno);
+		ret = -errno;
+		goto err_fb;
+	}
+
+	return 0;
+
+err_fb:
+	drmModeRmFB(fd, buf->fb);
+err_destroy:
+	memset(&dreq, 0, sizeof(dreq));
+	dreq.handle = buf->handle;
+	drmIoctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq);
+	return ret;
+}
+
+static void modeset_destroy_fb(int fd, struct modeset_buf *buf)
+{
+	struct drm_mode_destroy_dumb dreq;
+
+	munmap(buf->map, buf->size);
+	drmModeRmFB(fd, buf->fb);
+
+	memset(&dreq, 0, sizeof(dreq));
+	dreq.handle = buf->handle;
+	drmIoctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq);
+}
+
+// }}}
+
+// {{{ Atomic modesetting
+
+/**
+ * Looks up a property by name on a DRM object.
+ * `prop_id` and `value` are only written to when not NULL.
+ */
+static int modeset_get_prop(int fd, uint32_t obj_id, uint32_t obj_type, const char *name, uint32_t *prop_id, uint64_t *value)
+{
+	int ret = -ENOENT;
+	uint32_t i;
+	drmModeObjectProperties *props;
+	drmModePropertyRes *prop;
+
+	props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+	if (!props) {
+		return -errno;
+	}
+
+	for (i = 0; i < props->count_props && ret; i++) {
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop) {
+			continue;
+		}
+		if (!strcmp(prop->name, name)) {
+			if (prop_id) *prop_id = prop->prop_id;
+			if (value) *value = props->prop_values[i];
+			ret = 0;
+		}
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	return ret;
+}
+
+static int modeset_setup_atomic(int fd, struct modeset_dev *dev)
+{
+	drmModePlaneRes *planes;
+	drmModePlane *plane;
+	uint32_t i;
+	uint32_t prop_id;
+	uint64_t type = 0;
+
+	if (drmSetClientCap(fd, DRM_CLIENT_CAP_ATOMIC, 1)) {
+		info("DRM driver does not support atomic modesetting");
+		return -EOPNOTSUPP;
+	}
+
+	planes = drmModeGetPlaneResources(fd);
+	if (!planes) {
+		err("cannot retrieve DRM planes (%d): %m", errno);
+		return -errno;
+	}
+
+	for (i = 0; i < planes->count_planes && !dev->plane; i++) {
+		plane = drmModeGetPlane(fd, planes->planes[i]);
+		if (!plane) {
+			continue;
+		}
+		if (
+			(plane->possible_crtcs & (1 << dev->crtc_index)) &&
+			!modeset_get_prop(fd, plane->plane_id, DRM_MODE_OBJECT_PLANE, "type", &prop_id, &type) &&
+			type == DRM_PLANE_TYPE_PRIMARY
+		) {
+			dev->plane = plane->plane_id;
+		}
+		drmModeFreePlane(plane);
+	}
+	drmModeFreePlaneResources(planes);
+
+	if (!dev->plane) {
+		err("cannot find primary plane for CRTC %u", dev->crtc);
+		return -ENOENT;
+	}
+
+	if (modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "FB_ID", &dev->plane_props.fb_id, NULL)) {
+		err("cannot find FB_ID property for plane %u", dev->plane);
+		return -ENOENT;
+	}
+
+	// Only some drivers make use of damage clips, it is fine without.
+	if (modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "FB_DAMAGE_CLIPS", &dev->plane_props.fb_damage_clips, NULL)) {
+		dev->plane_props.fb_damage_clips = 0;
+	}
+
+	dev->atomic = true;
+	info("presenting through atomic commits on plane %u (damage clips: %s)", dev->plane, dev->plane_props.fb_damage_clips ? "yes" : "no");
+
+	return 0;
+}
+
+/**
+ * Flips the primary plane to the given buffer, passing the damaged areas along.
+ * Completion is signalled through the same event as a page flip.
+ */
+static int modeset_commit_atomic(struct modeset_dev *dev, struct modeset_buf *buf)
+{
+	int ret;
+	uint32_t i;
+	uint32_t blob_id = 0;
+	struct drm_mode_rect clips[DRM_DAMAGE_MAX];
+	drmModeAtomicReq *req;
+
+	req = drmModeAtomicAlloc();
+	if (!req) {
+		errno = ENOMEM;
+		return -ENOMEM;
+	}
+
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.fb_id, buf->fb);
+
+	if (dev->plane_props.fb_damage_clips && dev->damage_count) {
+		// Damage clips are exclusive of their bottom right corner.
+		for (i = 0; i < dev->damage_count; i++) {
+			clips[i].x1 = dev->damage[i].x1;
+			clips[i].y1 = dev->damage[i].y1;
+			clips[i].x2 = dev->damage[i].x2 + 1;
+			clips[i].y2 = dev->damage[i].y2 + 1;
+		}
+
+		// Damage is only a hint; without it the whole buffer is presented.
+		if (drmModeCreatePropertyBlob(dev->fd, clips, sizeof(clips[0]) * dev->damage_count, &blob_id)) {
+			dbg("cannot create damage clips blob (%d): %m", errno);
+			blob_id = 0;
+		}
+		else {
+			drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.fb_damage_clips, blob_id);
+		}
+	}
+
+	ret = drmModeAtomicCommit(dev->fd, req, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, dev);
+
+	// The committed state holds its own reference to the blob.
+	if (blob_id) {
+		drmModeDestroyPropertyBlob(dev->fd, blob_id);
+	}
+	drmModeAtomicFree(req);
+
+	return ret;
+}
+
+/**
+ * Reads the orientation of the panel from the "panel orientation" property of the connector.
+ */
+static drm_orientation_t modeset_get_orientation(int fd, struct modeset_dev *dev)
+{
+	drm_orientation_t orientation = DRM_ORIENTATION_NORMAL;
+	int i, j;
+	char * name = 0;
+	uint64_t value;
+	drmModeObjectProperties *props;
+	drmModePropertyRes *prop;
+	bool found = false;
+
+	props = drmModeObjectGetProperties(fd, dev->conn, DRM_MODE_OBJECT_CONNECTOR);
+	if (!props) {
+		return orientation;
+	}
+
+	for (i = 0; i < props->count_props && !found; i++) {
+		prop = drmModeGetProperty(fd, props->props[i]);
+		if (!prop) {
+			continue;
+		}
+		value = props->prop_values[i];
+		dbg("prop->name = %s; (value = %lu) (count_enums = %d) (count_values = %d)", prop->name, value, prop->count_enums, prop->count_values);
+		if (!strcmp(prop->name, "panel orientation")) {
+			for (j = 0; j < prop->count_enums; j++) {
+				name = prop->enums[j].name;
+				dbg("name = %s", name)
+				dbg("value = %llu", prop->enums[j].value)
+				if (value == prop->enums[j].value) {
+					if (!strcmp(name, "Normal")) {
+						orientation = DRM_ORIENTATION_NORMAL;
+					}
+					else if (!strcmp(name, "Upside Down")) {
+						orientation = DRM_ORIENTATION_UPSIDE_DOWN;
+					}
+					else if (!strcmp(name, "Left Side Up")) {
+						orientation = DRM_ORIENTATION_COUNTER_CLOCKWISE;
+					}
+					else if (!strcmp(name, "Right Side Up")) {
+						orientation = DRM_ORIENTATION_CLOCKWISE;
+					}
+					break;
+				}
+			}
+
+			// We only care about panel orientation
+			info("DRM panel orientation from property: %s (%d)", name, orientation);
+			found = true;
+		}
+		drmModeFreeProperty(prop);
+	}
+	drmModeFreeObjectProperties(props);
+
+	return orientation;
+}
+
+/**
+ * Makes the primary plane rotate the buffers at scanout, to match the panel orientation.
+ *
+ * The buffers are re-created in the logical orientation, and the rotation is
+ * validated through a test-only atomic modeset. Drivers often limit rotation
+ * to some buffer layouts; when anything fails, pixels are rotated in software.
+ */
+static int modeset_setup_rotation(int fd, struct modeset_dev *dev)
+{
+	int ret;
+	uint32_t i;
+	const char *name = NULL;
+	bool found = false;
+	bool quarter_turn;
+	drmModePropertyRes *prop;
+	struct modeset_buf bufs[2];
+
+	dev->sw_orientation = dev->orientation;
+
+	switch (dev->orientation) {
+		case DRM_ORIENTATION_NORMAL:
+			return 0;
+		// The rotation property turns the image counter-clockwise.
+		case DRM_ORIENTATION_UPSIDE_DOWN:
+			name = "rotate-180";
+			break;
+		case DRM_ORIENTATION_COUNTER_CLOCKWISE:
+			name = "rotate-90";
+			break;
+		case DRM_ORIENTATION_CLOCKWISE:
+			name = "rotate-270";
+			break;
+	}
+
+	if (!dev->atomic) {
+		info("rotating in software: atomic modesetting unavailable");
+		return -EOPNOTSUPP;
+	}
+
+	if (modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "rotation", &dev->plane_props.rotation, NULL)) {
+		info("rotating in software: plane %u has no rotation property", dev->plane);
+		return -EOPNOTSUPP;
+	}
+
+	// Values of the bitmask enum are bit positions.
+	prop = drmModeGetProperty(fd, dev->plane_props.rotation);
+	if (prop) {
+		for (i = 0; i < prop->count_enums && !found; i++) {
+			if (!strcmp(prop->enums[i].name, name)) {
+				dev->rotation = 1ULL << prop->enums[i].value;
+				found = true;
+			}
+		}
+		drmModeFreeProperty(prop);
+	}
+	if (!found) {
+		info("rotating in software: plane %u does not support %s", dev->plane, name);
+		return -EOPNOTSUPP;
+	}
+
+	if (
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "CRTC_ID", &dev->plane_props.crtc_id, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "SRC_X", &dev->plane_props.src_x, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "SRC_Y", &dev->plane_props.src_y, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "SRC_W", &dev->plane_props.src_w, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "SRC_H", &dev->plane_props.src_h, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "CRTC_X", &dev->plane_props.crtc_x, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "CRTC_Y", &dev->plane_props.crtc_y, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "CRTC_W", &dev->plane_props.crtc_w, NULL) ||
+		modeset_get_prop(fd, dev->plane, DRM_MODE_OBJECT_PLANE, "CRTC_H", &dev->plane_props.crtc_h, NULL) ||
+		modeset_get_prop(fd, dev->crtc, DRM_MODE_OBJECT_CRTC, "MODE_ID", &dev->crtc_props.mode_id, NULL) ||
+		modeset_get_prop(fd, dev->crtc, DRM_MODE_OBJECT_CRTC, "ACTIVE", &dev->crtc_props.active, NULL) ||
+		modeset_get_prop(fd, dev->conn, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID", &dev->conn_props.crtc_id, NULL)
+	) {
+		err("rotating in software: cannot find atomic modesetting properties");
+		return -ENOENT;
+	}
+
+	if (drmModeCreatePropertyBlob(fd, &dev->mode, sizeof(dev->mode), &dev->mode_blob)) {
+		err("cannot create mode blob (%d): %m", errno);
+		return -errno;
+	}
+
+	// Quarter turns scan out buffers in the logical orientation.
+	quarter_turn = dev->orientation != DRM_ORIENTATION_UPSIDE_DOWN;
+	memset(bufs, 0, sizeof(bufs));
+	for (i = 0; i < 2; i++) {
+		bufs[i].width = quarter_turn ? dev->height : dev->width;
+		bufs[i].height = quarter_turn ? dev->width : dev->height;
+		bufs[i].bpp = DRM_BPP;
+		ret = modeset_create_fb(fd, &bufs[i]);
+		if (ret) {
+			err("cannot create rotated framebuffer for connector %u", dev->conn);
+			if (i) {
+				modeset_destroy_fb(fd, &bufs[0]);
+			}
+			goto err_blob;
+		}
+	}
+
+	ret = modeset_commit_modeset(dev, &bufs[dev->front_buf ^ 1], DRM_MODE_ATOMIC_TEST_ONLY);
+	if (ret) {
+		info("rotating in software: plane %u refused %s (%d): %m", dev->plane, name, errno);
+		modeset_destroy_fb(fd, &bufs[0]);
+		modeset_destroy_fb(fd, &bufs[1]);
+		goto err_blob;
+	}
+
+	for (i = 0; i < 2; i++) {
+		modeset_destroy_fb(fd, &dev->bufs[i]);
+		dev->bufs[i] = bufs[i];
+	}
+
+	dev->hw_rotation = true;
+	dev->sw_orientation = DRM_ORIENTATION_NORMAL;
+	info("rotating at scanout on plane %u (%s)", dev->plane, name);
+
+	return 0;
+
+err_blob:
+	drmModeDestroyPropertyBlob(fd, dev->mode_blob);
+	dev->mode_blob = 0;
+
+	return ret;
+}
+
+/**
+ * Picks the fraction of the resolution LVGL renders at.
+ */
+static void modeset_setup_render_scale(struct modeset_dev *dev)
+{
+	const char *env = getenv("LVGUI_RENDER_SCALE");
+	unsigned int num = DRM_RENDER_SCALE_NUM;
+	unsigned int den = DRM_RENDER_SCALE_DEN;
+
+	if (env && sscanf(env, "%u/%u", &num, &den) != 2) {
+		err("LVGUI_RENDER_SCALE should be <num>/<den>, not '%s'", env);
+		num = DRM_RENDER_SCALE_NUM;
+		den = DRM_RENDER_SCALE_DEN;
+	}
+
+	// Only ever scaling up.
+	if (num == 0 || num > den) {
+		err("cannot render at %u/%u of the resolution", num, den);
+		num = 1;
+		den = 1;
+	}
+
+	// Scaled back up, LVGL's pixels only cover the whole panel, up to its last
+	// lines and columns, when both dimensions divide evenly.
+	if ((uint64_t)dev->width * num % den || (uint64_t)dev->height * num % den) {
+		err("cannot render %ux%u at %u/%u of the resolution, it does not divide evenly", dev->width, dev->height, num, den);
+		num = 1;
+		den = 1;
+	}
+
+	dev->render_num = num;
+	dev->render_den = den;
+
+	if (num != den) {
+		info("rendering at %u/%u of the resolution: %ux%u", num, den, dev->width * num / den, dev->height * num / den);
+	}
+}
+
+/**
+ * Sets the mode on the CRTC, scanning out the given buffer through the rotated primary plane.
+ * Stands in for drmModeSetCrtc, which cannot set up the plane rotation.
+ */
+static int modeset_commit_modeset(struct modeset_dev *dev, struct modeset_buf *buf, uint32_t flags)
+{
+	int ret;
+	drmModeAtomicReq *req;
+
+	req = drmModeAtomicAlloc();
+	if (!req) {
+		errno = ENOMEM;
+		return -ENOMEM;
+	}
+
+	drmModeAtomicAddProperty(req, dev->conn, dev->conn_props.crtc_id, dev->crtc);
+	drmModeAtomicAddProperty(req, dev->crtc, dev->crtc_props.mode_id, dev->mode_blob);
+	drmModeAtomicAddProperty(req, dev->crtc, dev->crtc_props.active, 1);
+
+	// Source coordinates are in the buffer, in 16.16 fixed point.
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.fb_id, buf->fb);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.crtc_id, dev->crtc);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.src_x, 0);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.src_y, 0);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.src_w, (uint64_t)buf->width << 16);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.src_h, (uint64_t)buf->height << 16);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.crtc_x, 0);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.crtc_y, 0);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.crtc_w, dev->width);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.crtc_h, dev->height);
+	drmModeAtomicAddProperty(req, dev->plane, dev->plane_props.rotation, dev->rotation);
+
+	ret = drmModeAtomicCommit(dev->fd, req, flags | DRM_MODE_ATOMIC_ALLOW_MODESET, NULL);
+	drmModeAtomicFree(req);
+
+	return ret;
+}
+
+/**
+ * Tells the driver which areas of a buffer changed.
+ * Used on the legacy path, for drivers that need to upload the buffer to the panel.
+ */
+static void modeset_dirty_fb(struct modeset_dev *dev, struct modeset_buf *buf)
+{
+	int ret;
+	uint32_t i;
+	struct drm_clip_rect clips[DRM_DAMAGE_MAX];
+
+	if (dev->no_dirty_fb || !dev->damage_count) {
+		return;
+	}
+
+	// Clip rects are exclusive of their bottom right corner.
+	for (i = 0; i < dev->damage_count; i++) {
+		clips[i].x1 = dev->damage[i].x1;
+		clips[i].y1 = dev->damage[i].y1;
+		clips[i].x2 = dev->damage[i].x2 + 1;
+		clips[i].y2 = dev->damage[i].y2 + 1;
+	}
+
+	ret = drmModeDirtyFB(dev->fd, buf->fb, clips, dev->damage_count);
+	if (ret) {
+		// Most drivers scan out continuously and do not implement it.
+		if (ret != -ENOSYS) {
+			errno = -ret;
+			err("cannot mark framebuffer dirty for connector %u (%d): %m", dev->conn, errno);
+		}
+		dev->no_dirty_fb = true;
+	}
+}
+
+// }}}
 
-			/* check that no other device already uses this CRTC */
-			crtc = res->crtcs[j];
-			for (iter = modeset_list; iter; iter = iter->next) {
-				if (iter->crtc == crtc) {
-					crtc = -1;
-					break;
-				}
-			}
+// {{{ Page flipping
 
-			/* we have found a CRTC, so save it and return */
-			if (crtc >= 0) {
-				drmModeFreeEncoder(enc);
-				dev->crtc = crtc;
-				return 0;
+static void modeset_page_flip_event(int fd, unsigned int frame, unsigned int sec, unsigned int usec, void *data)
+{
+	struct modeset_dev *dev = data;
+
+	// Page flip events carry the vblank at which the new buffer got scanned out.
+	dev->vblank_valid = true;
+	dev->vblank_sequence = frame;
+	dev->vblank_usec = (uint64_t)sec * 1000000 + usec;
+
+	modeset_flip_done(dev);
+}
+
+/**
+ * Marks the pending page flip as completed, or given up on.
+ * The former front buffer is not scanned out anymore: a zero copy flush is ready.
+ */
+static void modeset_flip_done(struct modeset_dev *dev)
+{
+	lv_disp_drv_t *disp_drv = dev->flush_drv;
+
+	dev->pflip_pending = false;
+
+	if (disp_drv) {
+		dev->flush_drv = NULL;
+		lv_disp_flush_ready(disp_drv);
+	}
+}
+
+/**
+ * Blocks until the previously queued page flip has completed.
+ * Until then, the back buffer may still be scanned out.
+ */
+static void modeset_wait_flip(struct modeset_dev *dev)
+{
+	uint32_t start = lv_tick_get();
+	int ret;
+
+	while (dev->pflip_pending) {
+		ret = modeset_poll_events(dev, DRM_FLIP_POLL_MS);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
 			}
+			err("poll on DRM fd failed (%d): %m", errno);
+			modeset_flip_done(dev);
+			break;
+		}
+		if (dev->pflip_pending && lv_tick_elaps(start) >= DRM_FLIP_TIMEOUT_MS) {
+			err("timed out waiting for page flip on connector %u", dev->conn);
+			modeset_flip_done(dev);
+			break;
 		}
+	}
+}
 
-		drmModeFreeEncoder(enc);
+/**
+ * Handles pending events of the DRM device, waiting at most `timeout` milliseconds for some.
+ * @return the result of poll(), 0 meaning no events came.
+ */
+static int modeset_poll_events(struct modeset_dev *dev, int timeout)
+{
+	int ret;
+	struct pollfd pfd;
+	drmEventContext ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.version = 2;
+	ev.page_flip_handler = modeset_page_flip_event;
+
+	pfd.fd = dev->fd;
+	pfd.events = POLLIN;
+
+	// Events are dispatched to the output they are for, whichever thread reads them.
+	pthread_mutex_lock(&modeset_event_lock);
+	ret = poll(&pfd, 1, timeout);
+	if (ret > 0) {
+		drmHandleEvent(dev->fd, &ev);
 	}
+	pthread_mutex_unlock(&modeset_event_lock);
 
-	err("cannot find suitable CRTC for connector %u", conn->connector_id);
-	return -ENOENT;
+	return ret;
 }
 
-static int modeset_create_fb(int fd, struct modeset_dev *dev)
+/**
+ * Refreshes the display once the last presented frame is on screen.
+ * Animations are advanced right before, so each frame shows them as they
+ * should be at that time, rather than as of the last animation task run.
+ */
+static void modeset_vblank_task(lv_task_t *task)
+{
+	lv_disp_t *disp = task->user_data;
+	struct modeset_dev *dev = disp->driver.user_data;
+
+	// Handled even while a flush thread is busy, so a readable file descriptor
+	// doesn't keep waking the main loop up.
+	if (dev->pflip_pending) {
+		modeset_poll_events(dev, 0);
+	}
+
+	// The flush thread owns the device until the frame is handed over.
+	if (async_flush_busy(&disp->driver)) {
+		return;
+	}
+
+	if (dev->pflip_pending) {
+		// A lost event would otherwise stop refreshing for good.
+		if (lv_tick_elaps(dev->pflip_time) < DRM_FLIP_TIMEOUT_MS) {
+			return;
+		}
+		err("timed out waiting for page flip on connector %u", dev->conn);
+		modeset_flip_done(dev);
+	}
+
+#if LV_USE_LATENCY
+	// The last frame is shown since the vblank its page flip completed at.
+	lv_latency_presented(disp, dev->vblank_valid ? dev->vblank_usec : 0);
+#endif
+
+	lv_anim_refr_now();
+
+	// Nothing changed, nothing to present.
+	if (disp->inv_p == 0) {
+		// Sleeps until an area is invalidated (see `lv_inv_area`). Animations which are
+		// delayed or don't change anything are stepped by their own task meanwhile.
+		lv_task_pause(task);
+		return;
+	}
+
+	lv_disp_refr_task(task);
+
+	// Animations step once per frame, at the next page flip completion.
+	// When nothing was presented there is none to wait for; their own task steps them.
+	if (lv_anim_count_running() && drm_is_waiting(disp)) {
+		lv_task_resume(task);
+	}
+}
+
+/**
+ * Prepares the back buffer to receive the areas of a new frame.
+ *
+ * The back buffer holds the frame presented before the current front buffer,
+ * so the areas changed in the last presented frame are copied over from the
+ * front buffer. Otherwise a partial refresh would show stale content.
+ */
+static void modeset_begin_frame(struct modeset_dev *dev)
+{
+	struct modeset_buf *front = &dev->bufs[dev->front_buf];
+	struct modeset_buf *back = &dev->bufs[dev->front_buf ^ 1];
+	uint32_t i;
+	lv_coord_t y;
+	uint32_t off;
+	uint32_t len;
+
+	modeset_wait_flip(dev);
+
+	for (i = 0; i < dev->prev_damage_count; i++) {
+		len = lv_area_get_width(&dev->prev_damage[i]) * (back->bpp / 8);
+		for (y = dev->prev_damage[i].y1; y <= dev->prev_damage[i].y2; y++) {
+			off = front->stride * y + dev->prev_damage[i].x1 * (front->bpp / 8);
+			memcpy(back->map + off, front->map + off, len);
+		}
+	}
+
+	dev->damage_count = 0;
+	dev->frame_started = true;
+}
+
+/**
+ * Records an area, in buffer coordinates, as changed in the current frame.
+ */
+static void modeset_add_damage(struct modeset_dev *dev, const lv_area_t *area)
+{
+	lv_area_t full;
+	uint32_t i;
+
+	full.x1 = 0;
+	full.y1 = 0;
+	full.x2 = dev->bufs[0].width - 1;
+	full.y2 = dev->bufs[0].height - 1;
+
+	// Skip areas already covered.
+	for (i = 0; i < dev->damage_count; i++) {
+		if (lv_area_is_in(area, &dev->damage[i])) {
+			return;
+		}
+	}
+
+	if (dev->damage_count < DRM_DAMAGE_MAX) {
+		lv_area_intersect(&dev->damage[dev->damage_count], area, &full);
+		dev->damage_count++;
+	}
+	else {
+		lv_area_join(&dev->damage[DRM_DAMAGE_MAX - 1], &dev->damage[DRM_DAMAGE_MAX - 1], area);
+		lv_area_intersect(&dev->damage[DRM_DAMAGE_MAX - 1], &dev->damage[DRM_DAMAGE_MAX - 1], &full);
+	}
+}
+
+/**
+ * Copies an area, as LVGL renders it, into the back buffer, rotating it as needed.
+ * @param stride distance between the lines of `color_p`, in pixels
+ */
+static void modeset_copy_area(struct modeset_dev *dev, const lv_area_t *area, const lv_color_t *color_p, lv_coord_t stride)
+{
+	struct modeset_buf *buf = &dev->bufs[dev->front_buf ^ 1];
+	lv_coord_t bw = dev->bufs[0].width;
+	lv_coord_t bh = dev->bufs[0].height;
+	bool scaled = dev->render_num != dev->render_den;
+	lv_area_t scaled_area = *area;
+	lv_area_t damage;
+	blit_rotation_t rotation = BLIT_ROTATE_0;
+
+	lv_coord_t w = (area->x2 - area->x1 + 1);
+	lv_coord_t h = (area->y2 - area->y1 + 1);
+
+	// Where the area lands once scaled up to the panel's resolution.
+	if (scaled) {
+		scaled_area.x1 = blit_scale_coord(area->x1, dev->render_den, dev->render_num);
+		scaled_area.y1 = blit_scale_coord(area->y1, dev->render_den, dev->render_num);
+		scaled_area.x2 = blit_scale_coord(area->x2 + 1, dev->render_den, dev->render_num) - 1;
+		scaled_area.y2 = blit_scale_coord(area->y2 + 1, dev->render_den, dev->render_num) - 1;
+	}
+	damage = scaled_area;
+
+	// Where the area lands in the buffer, which is in the panel's native orientation.
+	switch (dev->sw_orientation) {
+		case DRM_ORIENTATION_NORMAL:
+			rotation = BLIT_ROTATE_0;
+			break;
+		case DRM_ORIENTATION_UPSIDE_DOWN:
+			rotation = BLIT_ROTATE_180;
+			damage.x1 = bw - scaled_area.x2 - 1;
+			damage.x2 = bw - scaled_area.x1 - 1;
+			damage.y1 = bh - scaled_area.y2 - 1;
+			damage.y2 = bh - scaled_area.y1 - 1;
+			break;
+		case DRM_ORIENTATION_CLOCKWISE:
+			rotation = BLIT_ROTATE_CW;
+			damage.x1 = bw - scaled_area.y2 - 1;
+			damage.x2 = bw - scaled_area.y1 - 1;
+			damage.y1 = scaled_area.x1;
+			damage.y2 = scaled_area.x2;
+			break;
+		case DRM_ORIENTATION_COUNTER_CLOCKWISE:
+			rotation = BLIT_ROTATE_CCW;
+			damage.x1 = scaled_area.y1;
+			damage.x2 = scaled_area.y2;
+			damage.y1 = bh - scaled_area.x2 - 1;
+			damage.y2 = bh - scaled_area.x1 - 1;
+			break;
+	}
+
+	// Just in case, this is most likely a BUG in this driver.
+	if (damage.x1 < 0 || damage.y1 < 0 || damage.x2 >= dev->bufs[0].width || damage.y2 >= dev->bufs[0].height) {
+		err("drm_flush() too large to fit in buffer!!!! [BUG!!]");
+		return;
+	}
+
+#if LV_COLOR_DEPTH == 16
+	if (scaled) {
+		blit_scale_16(
+			rotation, dev->render_den, dev->render_num,
+			(const uint16_t *)color_p, stride * sizeof(lv_color_t), area->x1, area->y1,
+			(uint16_t *)(buf->map + buf->stride * damage.y1 + damage.x1 * sizeof(lv_color_t)), buf->stride,
+			w, h
+		);
+	}
+	else {
+		blit_rotate_16(
+			rotation,
+			(const uint16_t *)color_p, stride * sizeof(lv_color_t),
+			(uint16_t *)(buf->map + buf->stride * damage.y1 + damage.x1 * sizeof(lv_color_t)), buf->stride,
+			w, h
+		);
+	}
+#else
+	if (scaled) {
+		blit_scale_32(
+			rotation, dev->render_den, dev->render_num,
+			(const uint32_t *)color_p, stride * sizeof(lv_color_t), area->x1, area->y1,
+			(uint32_t *)(buf->map + buf->stride * damage.y1 + damage.x1 * sizeof(lv_color_t)), buf->stride,
+			w, h
+		);
+	}
+	else {
+		blit_rotate_32(
+			rotation,
+			(const uint32_t *)color_p, stride * sizeof(lv_color_t),
+			(uint32_t *)(buf->map + buf->stride * damage.y1 + damage.x1 * sizeof(lv_color_t)), buf->stride,
+			w, h
+		);
+	}
+#endif
+
+	modeset_add_damage(dev, &damage);
+}
+
+/**
+ * Presents the back buffer, and swaps the buffers roles.
+ */
+static void modeset_present(struct modeset_dev *dev)
 {
-	struct drm_mode_create_dumb creq;
-	struct drm_mode_destroy_dumb dreq;
-	struct drm_mode_map_dumb mreq;
 	int ret;
+	bool presented = false;
+	struct modeset_buf *back = &dev->bufs[dev->front_buf ^ 1];
 
-	/* create dumb buffer */
-	memset(&creq, 0, sizeof(creq));
-	creq.width = dev->width;
-	creq.height = dev->height;
-	creq.bpp = 32;
-	ret = drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &creq);
-	if (ret < 0) {
-		err("cannot create dumb buffer (%d): %m", errno);
-		return -errno;
+	// The main thread may handle the events while a flush thread presents:
+	// the page flip is marked pending before its event can be handled.
+	pthread_mutex_lock(&modeset_event_lock);
+
+	if (dev->mode_set && dev->atomic) {
+		ret = modeset_commit_atomic(dev, back);
+		if (ret) {
+			err("cannot commit plane update for connector %u (%d): %m", dev->conn, errno);
+			info("(falling back to legacy page flips...)");
+			dev->atomic = false;
+		}
+		else {
+			dev->pflip_pending = true;
+			dev->pflip_time = lv_tick_get();
+			presented = true;
+		}
 	}
-	dev->stride = creq.pitch;
-	dev->size = creq.size;
-	dev->handle = creq.handle;
 
-	/* create framebuffer object for the dumb-buffer */
-	ret = drmModeAddFB(fd, dev->width, dev->height, 24, 32, dev->stride,
-			   dev->handle, &dev->fb);
-	if (ret) {
-		err("cannot create framebuffer (%d): %m", errno);
-		ret = -errno;
-		goto err_destroy;
+	if (dev->mode_set && !presented && !dev->no_page_flip) {
+		ret = drmModePageFlip(dev->fd, dev->crtc, back->fb, DRM_MODE_PAGE_FLIP_EVENT, dev);
+		if (ret) {
+			err("cannot page flip CRTC for connector %u (%d): %m", dev->conn, errno);
+			info("(falling back to setting the CRTC on every frame...)");
+			dev->no_page_flip = true;
+		}
+		else {
+			dev->pflip_pending = true;
+			dev->pflip_time = lv_tick_get();
+			presented = true;
+		}
+	}
+
+	pthread_mutex_unlock(&modeset_event_lock);
+
+	// The first frame does the actual modesetting (see drm_init).
+	if (!presented) {
+		if (dev->hw_rotation) {
+			ret = modeset_commit_modeset(dev, back, 0);
+		}
+		else {
+			ret = drmModeSetCrtc(dev->fd, dev->crtc, back->fb, 0, 0,
+					&dev->conn, 1, &dev->mode);
+		}
+		if (ret) {
+			err("cannot set CRTC for connector %u (%d): %m", dev->conn, errno);
+		}
+		else {
+			dev->mode_set = true;
+			modeset_dirty_fb(dev, back);
+		}
+	}
+
+	dev->front_buf ^= 1;
+
+	memcpy(dev->prev_damage, dev->damage, sizeof(dev->damage[0]) * dev->damage_count);
+	dev->prev_damage_count = dev->damage_count;
+	dev->damage_count = 0;
+	dev->frame_started = false;
+}
+
+/**
+ * Presents a frame LVGL rendered directly into the back buffer.
+ *
+ * In true double buffered mode LVGL keeps both buffers in sync itself, by
+ * copying the refreshed areas into the other buffer once the flush is
+ * ready. That buffer is scanned out until the page flip completes, so the
+ * flush is only made ready then, by modeset_flip_done. Meanwhile LVGL goes
+ * on, and handles the events through drm_wait if it needs the buffer first.
+ */
+static void modeset_flush_zero_copy(struct modeset_dev *dev, lv_disp_drv_t *disp_drv, lv_color_t *color_p)
+{
+	lv_disp_t *disp = lv_refr_get_disp_refreshing();
+	uint16_t i;
+	bool ready;
+
+	// The buffers are swapped in lockstep with LVGL; this should not happen.
+	if ((uint8_t *)color_p != dev->bufs[dev->front_buf ^ 1].map) {
+		err("drm_flush() rendered into the front buffer!!!! [BUG!!]");
+		dev->front_buf ^= 1;
+	}
+
+	dev->damage_count = 0;
+	for (i = 0; i < disp->inv_p; i++) {
+		if (!disp->inv_area_joined[i]) {
+			modeset_add_damage(dev, &disp->inv_areas[i]);
+		}
+	}
+
+	// Set before the page flip is queued: another thread may handle its event right away.
+	dev->flush_drv = disp_drv;
+	modeset_present(dev);
+
+	// No page flip was queued, the frame is on screen already.
+	pthread_mutex_lock(&modeset_event_lock);
+	ready = dev->flush_drv && !dev->pflip_pending;
+	if (ready) {
+		dev->flush_drv = NULL;
+	}
+	pthread_mutex_unlock(&modeset_event_lock);
+
+	if (ready) {
+		lv_disp_flush_ready(disp_drv);
+	}
+}
+
+
+/**
+ * Computes where the cursor buffer goes on the CRTC, from the image position.
+ */
+static void modeset_cursor_place(struct modeset_dev *dev)
+{
+	// Position of the top left corner of the rotated sprite.
+	switch (dev->orientation) {
+		case DRM_ORIENTATION_NORMAL:
+			dev->cursor.crtc_x = dev->cursor.x;
+			dev->cursor.crtc_y = dev->cursor.y;
+			break;
+		case DRM_ORIENTATION_UPSIDE_DOWN:
+			dev->cursor.crtc_x = (int)dev->width - dev->cursor.x - dev->cursor.w;
+			dev->cursor.crtc_y = (int)dev->height - dev->cursor.y - dev->cursor.h;
+			break;
+		case DRM_ORIENTATION_CLOCKWISE:
+			dev->cursor.crtc_x = (int)dev->width - dev->cursor.y - dev->cursor.h;
+			dev->cursor.crtc_y = dev->cursor.x;
+			break;
+		case DRM_ORIENTATION_COUNTER_CLOCKWISE:
+			dev->cursor.crtc_x = dev->cursor.y;
+			dev->cursor.crtc_y = (int)dev->height - dev->cursor.x - dev->cursor.w;
+			break;
+	}
+}
+
+/**
+ * Shows the cursor buffer at its position, or hides it.
+ */
+static void modeset_cursor_update(struct modeset_dev *dev)
+{
+	struct modeset_buf *buf;
+	int ret;
+
+	if (dev->cursor.hidden) {
+		ret = drmModeSetCursor(dev->fd, dev->crtc, 0, 0, 0);
+	}
+	else {
+		buf = &dev->cursor.bufs[dev->cursor.front];
+		ret = drmModeSetCursor(dev->fd, dev->crtc, buf->handle, buf->width, buf->height);
+		if (!ret) {
+			ret = drmModeMoveCursor(dev->fd, dev->crtc, dev->cursor.crtc_x, dev->cursor.crtc_y);
+		}
 	}
 
-	/* prepare buffer for memory mapping */
-	memset(&mreq, 0, sizeof(mreq));
-	mreq.handle = dev->handle;
-	ret = drmIoctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &mreq);
 	if (ret) {
-		err("cannot map dumb buffer (%d): %m", errno);
-		ret = -errno;
-		goto err_fb;
+		dbg("cannot update cursor (%d): %m", errno);
 	}
+}
 
-	/* perform actual memory mapping */
-	dev->map = mmap(0, dev->size, PROT_READ | PROT_WRITE, MAP_SHARED,
-		        fd, mreq.offset);
-	if (dev->map == MAP_FAILED) {
-		err("cannot mmap dumb buffer (%d): %m", errno);
-		ret = -errno;
-		goto err_fb;
+/**
+ * Finds the "alpha" property of the cursor plane of the CRTC, so the sprite
+ * can be faded at scanout rather than by rewriting its pixels.
+ * Only planes exposed to clients supporting universal planes have it.
+ */
+static void modeset_cursor_setup_alpha(struct modeset_dev *dev)
+{
+	drmModePlaneRes *planes;
+	drmModePlane *plane;
+	uint32_t i;
+	uint32_t prop_id;
+	uint64_t type = 0;
+
+	dev->cursor.plane = 0;
+	dev->cursor.alpha_prop = 0;
+
+	if (drmSetClientCap(dev->fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1)) {
+		return;
 	}
 
-	return 0;
+	planes = drmModeGetPlaneResources(dev->fd);
+	if (!planes) {
+		return;
+	}
 
-err_fb:
-	drmModeRmFB(fd, dev->fb);
-err_destroy:
-	memset(&dreq, 0, sizeof(dreq));
-	dreq.handle = dev->handle;
-	drmIoctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq);
-	return ret;
+	for (i = 0; i < planes->count_planes && !dev->cursor.plane; i++) {
+		plane = drmModeGetPlane(dev->fd, planes->planes[i]);
+		if (!plane) {
+			continue;
+		}
+		if (
+			(plane->possible_crtcs & (1 << dev->crtc_index)) &&
+			!modeset_get_prop(dev->fd, plane->plane_id, DRM_MODE_OBJECT_PLANE, "type", &prop_id, &type) &&
+			type == DRM_PLANE_TYPE_CURSOR
+		) {
+			dev->cursor.plane = plane->plane_id;
+		}
+		drmModeFreePlane(plane);
+	}
+	drmModeFreePlaneResources(planes);
+
+	if (dev->cursor.plane && modeset_get_prop(dev->fd, dev->cursor.plane, DRM_MODE_OBJECT_PLANE, "alpha", &dev->cursor.alpha_prop, NULL)) {
+		dev->cursor.alpha_prop = 0;
+	}
 }
 
-// }}}
+/**
+ * Fades the sprite through the "alpha" property of the cursor plane, when it has one.
+ */
+static void modeset_cursor_set_alpha(struct modeset_dev *dev, lv_opa_t opa)
+{
+	if (!dev->cursor.alpha_prop || opa == dev->cursor.opa) {
+		return;
+	}
+
+	// The property goes from 0 to 0xFFFF.
+	if (drmModeObjectSetProperty(dev->fd, dev->cursor.plane, DRM_MODE_OBJECT_PLANE, dev->cursor.alpha_prop, (uint64_t)opa * 0xFFFF / LV_OPA_COVER)) {
+		err("cannot set the alpha of cursor plane %u (%d): %m, fading the pixels instead", dev->cursor.plane, errno);
+		dev->cursor.alpha_prop = 0;
+		// Redrawn faded on the next change.
+		dev->cursor.img = NULL;
+		return;
+	}
 
-static void dbg_fill_buffer(struct modeset_dev *dev, uint8_t r, uint8_t g, uint8_t b)
+	dev->cursor.opa = opa;
+}
+
+static void dbg_fill_buffer(struct modeset_buf *buf, uint8_t r, uint8_t g, uint8_t b)
 {
 	int j, k;
 	int off;
 
 	dbg("Filling framebuffer...");
-	for (j = 0; j < dev->height; ++j) {
-		for (k = 0; k < dev->width; ++k) {
-			off = dev->stride * j + k * 4;
-			*(uint32_t*)&dev->map[off] = (r << 16) | (g << 8) | b;
+	for (j = 0; j < buf->height; ++j) {
+		for (k = 0; k < buf->width; ++k) {
+			off = buf->stride * j + k * (buf->bpp / 8);
+			if (buf->bpp == 16) {
+				*(uint16_t*)&buf->map[off] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+			}
+			else {
+				*(uint32_t*)&buf->map[off] = (r << 16) | (g << 8) | b;
+			}
 		}
 	}
 }
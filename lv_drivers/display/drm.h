@@ -32,6 +32,30 @@ extern "C" {
 /*********************
  *      DEFINES
  *********************/
+#ifndef DRM_ZERO_COPY
+#define DRM_ZERO_COPY 0
+#endif
+#ifndef DRM_VBLANK_SYNC
+#define DRM_VBLANK_SYNC 0
+#endif
+#ifndef DRM_SKIP_UNCHANGED
+#define DRM_SKIP_UNCHANGED 0
+#endif
+#ifndef DRM_RENDER_SCALE_NUM
+#define DRM_RENDER_SCALE_NUM 1
+#endif
+#ifndef DRM_RENDER_SCALE_DEN
+#define DRM_RENDER_SCALE_DEN 1
+#endif
+#ifndef DRM_MULTI_OUTPUT
+#define DRM_MULTI_OUTPUT 0
+#endif
+#ifndef DRM_MAX_OUTPUTS
+#define DRM_MAX_OUTPUTS 4
+#endif
+
+// How long to wait on a page flip completion event before assuming it was lost.
+#define DRM_FLIP_TIMEOUT_MS 1000
 
 /**********************
  *      TYPEDEFS
@@ -40,10 +64,121 @@ extern "C" {
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
+/**
+ * Opens the first usable card, and sets the resolution of the driver.
+ *
+ * The resolution is the panel's, scaled by `DRM_RENDER_SCALE_NUM`/`DRM_RENDER_SCALE_DEN`,
+ * or by `LVGUI_RENDER_SCALE` (e.g. `2/3`) from the environment. LVGL then renders less
+ * pixels, which are scaled up to the panel's resolution when flushing. Scales which do
+ * not divide the resolution evenly are ignored.
+ */
 void drm_init(lv_disp_drv_t* drv);
 void drm_exit(void);
+
+/**
+ * Number of outputs `drm_init` found on the card.
+ * Only the first connected one is kept unless `DRM_MULTI_OUTPUT` is enabled.
+ */
+uint32_t drm_get_output_count(void);
+
+/**
+ * Sets up a display driver for an output, and sets its resolution.
+ * `drm_init` sets up the first output, the primary display, on its driver.
+ * Must be called after `drm_init`.
+ * @param index output, from 1 to `drm_get_output_count() - 1` for the other ones
+ * @return false if there is no such output.
+ */
+bool drm_init_output(lv_disp_drv_t * drv, uint32_t index);
 void drm_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_p);
 
+/**
+ * Handles the events of the output while LVGL waits for a flush to be ready,
+ * used as the `wait_cb` of the display drivers `drm_init` sets up.
+ */
+void drm_wait(lv_disp_drv_t * drv);
+
+/**
+ * Same as `drm_flush`, without signaling the end of the flush.
+ * Used to flush from another thread, see `async_flush.h`.
+ * @param last whether `area` is the last one of the refresh cycle
+ */
+void drm_flush_area(lv_disp_drv_t * drv, const lv_area_t * area, const lv_color_t * color_p, bool last);
+
+/**
+ * Points the draw buffer at the two scanout buffers, making LVGL render in
+ * true double buffered mode, and flushes mere page flips.
+ * Only possible when the buffers can be used as-is: unrotated panel,
+ * 32 bit colour and no padding at the end of lines.
+ * Must be called after `drm_init`.
+ * @param disp_buf draw buffer to initialize
+ * @return true if the draw buffer now uses the scanout buffers,
+ *         false if it was left untouched.
+ */
+bool drm_init_disp_buf(lv_disp_buf_t * disp_buf);
+
+/**
+ * Prepares showing a sprite, e.g. a mouse cursor, on the cursor plane.
+ * Moving it then does not need to redraw anything.
+ * Must be called after `drm_init`.
+ * @return true if a cursor plane is available.
+ */
+bool drm_cursor_init(void);
+
+/**
+ * Sets the sprite shown on the cursor plane.
+ * Changing only the opacity is cheap when the plane has an "alpha" property,
+ * the image is redrawn otherwise.
+ * @param img image in `LV_IMG_CF_TRUE_COLOR_ALPHA` format, no larger than the cursor plane
+ * @param opa opacity to apply to the image
+ * @return false if the image cannot be shown on the cursor plane.
+ */
+bool drm_cursor_set_image(const lv_img_dsc_t * img, lv_opa_t opa);
+
+/**
+ * Moves the sprite, in display coordinates.
+ * @param x position of the left side of the image
+ * @param y position of the top side of the image
+ */
+void drm_cursor_move(lv_coord_t x, lv_coord_t y);
+
+void drm_cursor_set_hidden(bool hidden);
+
+/**
+ * Drives the refresh of the display from the completion of page flips.
+ * A frame is rendered as soon as the previous one is on screen, so frames
+ * follow the panel refresh rate, and none are rendered that could not be shown.
+ * Must be called after registering the display.
+ * @param disp the display using `drm_flush`
+ * @return true if the refresh is now synchronized to the vertical blanking.
+ */
+bool drm_vblank_sync_init(lv_disp_t * disp);
+
+/**
+ * Gets the file descriptor of the card, readable when a page flip completes.
+ * The completion is handled by the refresh task of the display, so it only
+ * has to be run once the file descriptor is readable.
+ * @return the file descriptor, or -1 before `drm_init`.
+ */
+int drm_get_fd(void);
+
+/**
+ * Tells whether the refresh of a display waits on the device, for a page
+ * flip to complete or the flush thread to be done.
+ * Nothing is to be done until the file descriptor from `drm_get_fd`, or
+ * the one from `async_flush_get_fd`, becomes readable.
+ * @param disp the display using `drm_flush`
+ * @return true while waiting.
+ */
+bool drm_is_waiting(lv_disp_t * disp);
+
+/**
+ * Gets the vertical blanking at which the last presented frame reached the screen.
+ * @param sequence vblank counter, may be NULL
+ * @param usec time of the vblank in microseconds, on the CLOCK_MONOTONIC clock, may be NULL
+ * @return false if no frame was presented through a page flip yet.
+ */
+bool drm_get_last_vblank(uint32_t * sequence, uint64_t * usec);
+
 enum drm_orientation {
 	DRM_ORIENTATION_NORMAL,
 	DRM_ORIENTATION_UPSIDE_DOWN,
@@ -53,7 +188,28 @@ enum drm_orientation {
 typedef enum drm_orientation drm_orientation_t;
 
 /**
- * Input drivers should use this to determine how to rotate direct input devices.
+ * Where the pixels are rotated to match the panel orientation.
+ */
+enum drm_rotation_path {
+	DRM_ROTATION_NONE,
+	DRM_ROTATION_HARDWARE,
+	DRM_ROTATION_SOFTWARE,
+};
+typedef enum drm_rotation_path drm_rotation_path_t;
+
+drm_rotation_path_t drm_get_rotation_path(void);
+
+/**
+ * Gets the scale LVGL renders at, relative to the panel's resolution.
+ * @param num numerator, may be NULL
+ * @param den denominator, may be NULL
+ * @return false when rendering at the panel's resolution.
+ */
+bool drm_get_render_scale(uint32_t * num, uint32_t * den);
+
+/**
+ * Orientation of the primary display's panel. Direct input devices should be
+ * rotated alike, see `libinput_drv_set_orientation`.
  */
 extern drm_orientation_t drm_display_orientation;
 
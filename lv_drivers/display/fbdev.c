@@ -7,6 +7,8 @@
  *      INCLUDES
  *********************/
 #include "fbdev.h"
+#include "async_flush.h"
+#include "blit.h"
 #if USE_FBDEV || USE_DRM
 
 #include <errno.h>
@@ -14,6 +16,7 @@
 #include <unistd.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
@@ -27,6 +30,26 @@
 #define FBDEV_PATH  "/dev/fb0"
 #endif
 
+#ifndef FBDEV_DOUBLE_BUFFER
+#define FBDEV_DOUBLE_BUFFER 0
+#endif
+
+#ifndef FBDEV_WAIT_VSYNC
+#define FBDEV_WAIT_VSYNC 0
+#endif
+
+#ifndef FBDEV_DITHER
+#define FBDEV_DITHER 0
+#endif
+
+/*Rotation of the console, set (e.g. with `fbcon=rotate:`) for panels mounted rotated*/
+#define FBDEV_FBCON_ROTATE "/sys/class/graphics/fbcon/rotate"
+
+/*Missing from older kernel headers*/
+#ifndef FBIO_WAITFORVSYNC
+#define FBIO_WAITFORVSYNC _IOW('F', 0x20, uint32_t)
+#endif
+
 // #define DRV_DEBUG
 
 #define err(msg, ...)   fprintf(stderr, "[display/fbdev]: error: " msg "\n", ##__VA_ARGS__);
@@ -64,6 +87,11 @@ struct bsd_fb_fix_info{
  **********************/
 
 static void fbdev_set_resolution(lv_disp_drv_t* disp_drv);
+static void fbdev_setup_double_buffer(void);
+static void fbdev_setup_format(void);
+static void fbdev_setup_rotation(void);
+static void fbdev_begin_frame(void);
+static void fbdev_present(void);
 
 /**********************
  *  STATIC VARIABLES
@@ -74,6 +102,28 @@ static char *fbp = 0;
 static long int screensize = 0;
 static int fbfd = 0;
 
+/*Settings found on the device, restored on exit*/
+static struct fb_var_screeninfo orig_vinfo;
+
+/*With double buffering, the page (top or bottom half of the virtual screen) at `front_page` is
+ *being scanned out, the other one is drawn into*/
+static bool double_buffered = false;
+static uint32_t front_page = 0;
+/*Set once a refresh started drawing into the back page*/
+static bool frame_started = false;
+/*Bounding boxes of the areas drawn in the current and in the previously presented frame*/
+static lv_area_t damage;
+static lv_area_t prev_damage;
+static bool has_damage = false;
+static bool has_prev_damage = false;
+static bool wait_vsync = FBDEV_WAIT_VSYNC;
+
+/*How pixels are converted and rotated from LVGL to the framebuffer*/
+static blit_format_t format = BLIT_FORMAT_XRGB8888;
+static bool format_supported = false;
+static blit_rotation_t rotation = BLIT_ROTATE_0;
+static bool rotation_turns = false;
+
 /**********************
  *      MACROS
  **********************/
@@ -106,6 +156,14 @@ void fbdev_init(lv_disp_drv_t* disp_drv)
 
     print("%dx%d, %dbpp\n", vinfo.xres, vinfo.yres, vinfo.bits_per_pixel);
 
+    orig_vinfo = vinfo;
+    if(FBDEV_DOUBLE_BUFFER) {
+        fbdev_setup_double_buffer();
+    }
+
+    fbdev_setup_format();
+    fbdev_setup_rotation();
+
     // Figure out the size of the screen in bytes
     screensize =  finfo.smem_len; //finfo.line_length * vinfo.yres;    
 
@@ -133,8 +191,22 @@ void fbdev_init(lv_disp_drv_t* disp_drv)
     );
 }
 
+/**
+ * Get the rotation applied while flushing, which follows the console rotation.
+ * @return `BLIT_ROTATE_0` until `fbdev_init` found a rotated console
+ */
+blit_rotation_t fbdev_get_rotation(void)
+{
+    return rotation;
+}
+
 void fbdev_exit(void)
 {
+    // Leave the device as it was found, a console might be using it next.
+    if(double_buffered) {
+        ioctl(fbfd, FBIOPUT_VSCREENINFO, &orig_vinfo);
+    }
+
     close(fbfd);
 }
 
@@ -146,12 +218,28 @@ void fbdev_exit(void)
  */
 void fbdev_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_p)
 {
+    /*The flush thread takes it from there*/
+    if(async_flush_queue(drv, area, color_p)) {
+        return;
+    }
+
+    fbdev_flush_area(drv, area, color_p, lv_disp_flush_is_last(drv));
+    lv_disp_flush_ready(drv);
+}
+
+void fbdev_flush_area(lv_disp_drv_t * drv, const lv_area_t * area, const lv_color_t * color_p, bool last)
+{
+    (void)drv;
+
+    /*Size of the screen as LVGL sees it*/
+    int32_t hor_res = rotation_turns ? (int32_t)vinfo.yres : (int32_t)vinfo.xres;
+    int32_t ver_res = rotation_turns ? (int32_t)vinfo.xres : (int32_t)vinfo.yres;
+
     if(fbp == NULL ||
             area->x2 < 0 ||
             area->y2 < 0 ||
-            area->x1 > (int32_t)vinfo.xres - 1 ||
-            area->y1 > (int32_t)vinfo.yres - 1) {
-        lv_disp_flush_ready(drv);
+            area->x1 > hor_res - 1 ||
+            area->y1 > ver_res - 1) {
         return;
     }
 
@@ -165,40 +253,86 @@ void fbdev_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color
     /*Truncate the area to the screen*/
     int32_t act_x1 = area->x1 < 0 ? 0 : area->x1;
     int32_t act_y1 = area->y1 < 0 ? 0 : area->y1;
-    int32_t act_x2 = area->x2 > (int32_t)vinfo.xres - 1 ? (int32_t)vinfo.xres - 1 : area->x2;
-    int32_t act_y2 = area->y2 > (int32_t)vinfo.yres - 1 ? (int32_t)vinfo.yres - 1 : area->y2;
+    int32_t act_x2 = area->x2 > hor_res - 1 ? hor_res - 1 : area->x2;
+    int32_t act_y2 = area->y2 > ver_res - 1 ? ver_res - 1 : area->y2;
 
     long int location = 0;
     long int byte_location = 0;
     unsigned char bit_location = 0;
+    uint32_t yoffset = vinfo.yoffset;
+
+    // Where the area lands in the framebuffer, which is in the panel's native orientation.
+    lv_area_t act_area = { act_x1, act_y1, act_x2, act_y2 };
+    lv_area_t phys_area = act_area;
+    switch(rotation) {
+        case BLIT_ROTATE_0:
+            break;
+        case BLIT_ROTATE_180:
+            phys_area.x1 = vinfo.xres - act_x2 - 1;
+            phys_area.x2 = vinfo.xres - act_x1 - 1;
+            phys_area.y1 = vinfo.yres - act_y2 - 1;
+            phys_area.y2 = vinfo.yres - act_y1 - 1;
+            break;
+        case BLIT_ROTATE_CW:
+            phys_area.x1 = vinfo.xres - act_y2 - 1;
+            phys_area.x2 = vinfo.xres - act_y1 - 1;
+            phys_area.y1 = act_x1;
+            phys_area.y2 = act_x2;
+            break;
+        case BLIT_ROTATE_CCW:
+            phys_area.x1 = act_y1;
+            phys_area.x2 = act_y2;
+            phys_area.y1 = vinfo.yres - act_x2 - 1;
+            phys_area.y2 = vinfo.yres - act_x1 - 1;
+            break;
+    }
 
-    /*32 or 24 bit per pixel*/
-    if(vinfo.bits_per_pixel == 32 || vinfo.bits_per_pixel == 24) {
-        uint32_t * fbp32 = (uint32_t *)fbp;
-        int32_t y;
-        for(y = act_y1; y <= act_y2; y++) {
-            location = (act_x1 + vinfo.xoffset) + (y + vinfo.yoffset) * finfo.line_length / 4;
-            memcpy(&fbp32[location], (uint32_t *)color_p, (act_x2 - act_x1 + 1) * 4);
-            color_p += w;
+    if(double_buffered) {
+        // First flush of a refresh cycle; bring the back page up to date.
+        if(!frame_started) {
+            fbdev_begin_frame();
         }
-    }
-    /*16 bit per pixel*/
-    else if(vinfo.bits_per_pixel == 16) {
-        uint16_t * fbp16 = (uint16_t *)fbp;
-        int32_t y;
-        for(y = act_y1; y <= act_y2; y++) {
-            location = (act_x1 + vinfo.xoffset) + (y + vinfo.yoffset) * finfo.line_length / 2;
-            memcpy(&fbp16[location], (uint32_t *)color_p, (act_x2 - act_x1 + 1) * 2);
-            color_p += w;
+        yoffset = (front_page ^ 1) * vinfo.yres;
+
+        if(has_damage) {
+            lv_area_join(&damage, &damage, &phys_area);
+        } else {
+            damage = phys_area;
+            has_damage = true;
         }
     }
+
+    /*16 bit per pixel and more: converted and rotated on the way*/
+    if(vinfo.bits_per_pixel >= 16 && format_supported) {
+        const lv_color_t * src = color_p + (act_y1 - area->y1) * w + (act_x1 - area->x1);
+        uint8_t * dst = (uint8_t *)fbp
+            + (phys_area.y1 + yoffset) * finfo.line_length
+            + (phys_area.x1 + vinfo.xoffset) * (vinfo.bits_per_pixel / 8);
+
+#if LV_COLOR_DEPTH == 16
+        blit_rotate_16(
+            rotation,
+            (const uint16_t *)src, w * sizeof(lv_color_t),
+            (uint16_t *)dst, finfo.line_length,
+            act_x2 - act_x1 + 1, act_y2 - act_y1 + 1
+        );
+#else
+        blit_convert_32(
+            rotation, format, FBDEV_DITHER,
+            (const uint32_t *)src, w * sizeof(lv_color_t),
+            dst, finfo.line_length,
+            phys_area.x1, phys_area.y1,
+            act_x2 - act_x1 + 1, act_y2 - act_y1 + 1
+        );
+#endif
+    }
     /*8 bit per pixel*/
     else if(vinfo.bits_per_pixel == 8) {
         uint8_t * fbp8 = (uint8_t *)fbp;
         int32_t y;
         for(y = act_y1; y <= act_y2; y++) {
-            location = (act_x1 + vinfo.xoffset) + (y + vinfo.yoffset) * finfo.line_length;
-            memcpy(&fbp8[location], (uint32_t *)color_p, (act_x2 - act_x1 + 1));
+            location = (act_x1 + vinfo.xoffset) + (y + yoffset) * finfo.line_length;
+            memcpy(&fbp8[location], (const uint32_t *)color_p, (act_x2 - act_x1 + 1));
             color_p += w;
         }
     }
@@ -209,7 +343,7 @@ void fbdev_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color
         int32_t y;
         for(y = act_y1; y <= act_y2; y++) {
             for(x = act_x1; x <= act_x2; x++) {
-                location = (x + vinfo.xoffset) + (y + vinfo.yoffset) * vinfo.xres;
+                location = (x + vinfo.xoffset) + (y + yoffset) * vinfo.xres;
                 byte_location = location / 8; /* find the byte we need to change */
                 bit_location = location % 8; /* inside the byte found, find the bit we need to change */
                 fbp8[byte_location] &= ~(((uint8_t)(1)) << bit_location);
@@ -223,11 +357,18 @@ void fbdev_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color
         /*Not supported bit per pixel*/
     }
 
+    if(!last) {
+        return;
+    }
+
+    if(double_buffered) {
+        fbdev_present();
+        return;
+    }
+
     // "pan" the framebuffer, some gpu drivers only update when told to this way.
     // Don't check for errors, it's not important here.
     ioctl(fbfd, FBIOPAN_DISPLAY, &vinfo);
-
-    lv_disp_flush_ready(drv);
 }
 
 /**********************
@@ -244,6 +385,205 @@ static void fbdev_set_resolution(lv_disp_drv_t* disp_drv)
 
     disp_drv->hor_res = vinfo.xres;
     disp_drv->ver_res = vinfo.yres;
+    disp_drv->rotated = rotation_turns ? 1 : 0;
+}
+
+/**
+ * Finds the format LVGL pixels are converted to, from the position of the components.
+ */
+static void fbdev_setup_format(void)
+{
+    // Red in the low bits means the components are swapped.
+    bool bgr = vinfo.red.offset == 0;
+
+    switch(vinfo.bits_per_pixel) {
+        case 32:
+            format = bgr ? BLIT_FORMAT_XBGR8888 : BLIT_FORMAT_XRGB8888;
+            break;
+        case 24:
+            format = bgr ? BLIT_FORMAT_BGR888 : BLIT_FORMAT_RGB888;
+            break;
+        case 16:
+            format = bgr ? BLIT_FORMAT_BGR565 : BLIT_FORMAT_RGB565;
+            break;
+        default:
+            // Copied as is.
+            return;
+    }
+
+#if LV_COLOR_DEPTH == 16
+    if(format != BLIT_FORMAT_RGB565) {
+        err("%dbpp framebuffer (red at bit %d) not supported with RGB565 rendering", vinfo.bits_per_pixel, vinfo.red.offset);
+        return;
+    }
+#elif LV_COLOR_DEPTH != 32
+    err("%dbpp framebuffer not supported with %d bit rendering", vinfo.bits_per_pixel, LV_COLOR_DEPTH);
+    return;
+#endif
+
+    format_supported = true;
+    info("%dbpp framebuffer, red at bit %d, green at bit %d, blue at bit %d", vinfo.bits_per_pixel, vinfo.red.offset, vinfo.green.offset, vinfo.blue.offset);
+}
+
+/**
+ * Follows the rotation of the console, as fbdev has no other way to tell the panel orientation.
+ */
+static void fbdev_setup_rotation(void)
+{
+    FILE * file;
+    int rotate = FB_ROTATE_UR;
+
+    file = fopen(FBDEV_FBCON_ROTATE, "r");
+    if(file) {
+        if(fscanf(file, "%d", &rotate) != 1) {
+            rotate = FB_ROTATE_UR;
+        }
+        fclose(file);
+    }
+
+    // Rotating is done along with the conversion.
+    if(!format_supported && rotate != FB_ROTATE_UR) {
+        info("not rotating %dbpp framebuffer", vinfo.bits_per_pixel);
+        return;
+    }
+
+    switch(rotate) {
+        case FB_ROTATE_UD:
+            rotation = BLIT_ROTATE_180;
+            break;
+        case FB_ROTATE_CW:
+            rotation = BLIT_ROTATE_CW;
+            break;
+        case FB_ROTATE_CCW:
+            rotation = BLIT_ROTATE_CCW;
+            break;
+        default:
+            rotation = BLIT_ROTATE_0;
+            break;
+    }
+    rotation_turns = rotation == BLIT_ROTATE_CW || rotation == BLIT_ROTATE_CCW;
+
+    if(rotation != BLIT_ROTATE_0) {
+        info("rotating to follow the console (rotate = %d)", rotate);
+    }
+}
+
+/**
+ * Doubles the virtual height of the screen, when the device allows it, so that a frame can be
+ * drawn in the half not being scanned out and shown by panning to it.
+ */
+static void fbdev_setup_double_buffer(void)
+{
+    struct fb_var_screeninfo new_vinfo = vinfo;
+
+    // Updating the back page from the front one is done line by line.
+    if(vinfo.bits_per_pixel < 8) {
+        info("not double buffering: %dbpp", vinfo.bits_per_pixel);
+        return;
+    }
+
+    new_vinfo.yres_virtual = vinfo.yres * 2;
+    new_vinfo.xoffset = 0;
+    new_vinfo.yoffset = 0;
+
+    if(vinfo.yres_virtual < new_vinfo.yres_virtual &&
+            ioctl(fbfd, FBIOPUT_VSCREENINFO, &new_vinfo) == -1) {
+        info("not double buffering: cannot set virtual resolution (%s)", strerror(errno));
+        return;
+    }
+
+    // The driver may have adjusted the request, and the line length along with it.
+    if(ioctl(fbfd, FBIOGET_VSCREENINFO, &new_vinfo) == -1 ||
+            ioctl(fbfd, FBIOGET_FSCREENINFO, &finfo) == -1) {
+        err("cannot read back screen information: %s", strerror(errno));
+        return;
+    }
+
+    if(new_vinfo.yres_virtual < new_vinfo.yres * 2 ||
+            finfo.smem_len < finfo.line_length * new_vinfo.yres * 2) {
+        info("not double buffering: %d lines of %d bytes available", new_vinfo.yres_virtual, finfo.line_length);
+        ioctl(fbfd, FBIOPUT_VSCREENINFO, &orig_vinfo);
+        ioctl(fbfd, FBIOGET_FSCREENINFO, &finfo);
+        return;
+    }
+
+    // Scan out the top page, drawing starts in the bottom one.
+    new_vinfo.yoffset = 0;
+    ioctl(fbfd, FBIOPAN_DISPLAY, &new_vinfo);
+
+    vinfo = new_vinfo;
+    front_page = 0;
+    double_buffered = true;
+
+    info("double buffering, %dx%d virtual", vinfo.xres_virtual, vinfo.yres_virtual);
+}
+
+/**
+ * Prepares the back page to receive the areas of a new frame.
+ *
+ * The back page holds the frame presented before the current front page, so
+ * the area changed in the last presented frame is copied over from the front
+ * page. Otherwise a partial refresh would show stale content.
+ */
+static void fbdev_begin_frame(void)
+{
+    uint32_t bytes_per_pixel = vinfo.bits_per_pixel / 8;
+    char * front = fbp + front_page * vinfo.yres * finfo.line_length;
+    char * back = fbp + (front_page ^ 1) * vinfo.yres * finfo.line_length;
+    lv_coord_t y;
+
+    if(has_prev_damage) {
+        uint32_t len = lv_area_get_width(&prev_damage) * bytes_per_pixel;
+        for(y = prev_damage.y1; y <= prev_damage.y2; y++) {
+            long int off = y * finfo.line_length + (prev_damage.x1 + vinfo.xoffset) * bytes_per_pixel;
+            memcpy(back + off, front + off, len);
+        }
+    }
+
+    has_damage = false;
+    frame_started = true;
+}
+
+/**
+ * Shows the back page, once every area of the refresh cycle is in.
+ */
+static void fbdev_present(void)
+{
+    uint32_t bytes_per_pixel = vinfo.bits_per_pixel / 8;
+    uint32_t zero = 0;
+    char * front;
+    char * back;
+    lv_coord_t y;
+
+    vinfo.yoffset = (front_page ^ 1) * vinfo.yres;
+    if(ioctl(fbfd, FBIOPAN_DISPLAY, &vinfo) == -1) {
+        err("cannot pan display, not double buffering anymore: %s", strerror(errno));
+        // Show what was drawn by bringing it to the page being scanned out.
+        front = fbp + front_page * vinfo.yres * finfo.line_length;
+        back = fbp + (front_page ^ 1) * vinfo.yres * finfo.line_length;
+        if(has_damage) {
+            uint32_t len = lv_area_get_width(&damage) * bytes_per_pixel;
+            for(y = damage.y1; y <= damage.y2; y++) {
+                long int off = y * finfo.line_length + (damage.x1 + vinfo.xoffset) * bytes_per_pixel;
+                memcpy(front + off, back + off, len);
+            }
+        }
+        vinfo.yoffset = front_page * vinfo.yres;
+        double_buffered = false;
+        return;
+    }
+
+    // The old front page is drawn into next; it must not be scanned out anymore.
+    // Most drivers latch the offset at the next vertical blank without waiting for it.
+    if(wait_vsync && ioctl(fbfd, FBIO_WAITFORVSYNC, &zero) == -1) {
+        info("not waiting for vsync: %s", strerror(errno));
+        wait_vsync = false;
+    }
+
+    front_page ^= 1;
+    frame_started = false;
+    prev_damage = damage;
+    has_prev_damage = has_damage;
 }
 
 #endif
@@ -29,6 +29,8 @@ extern "C" {
 #include "lvgl/lvgl.h"
 #endif
 
+#include "blit.h"
+
 /*********************
  *      DEFINES
  *********************/
@@ -43,6 +45,10 @@ extern "C" {
 void fbdev_init(lv_disp_drv_t* disp_drv);
 void fbdev_exit(void);
 void fbdev_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_p);
+/*Same as `fbdev_flush` without signaling the end of the flush; `last` is the last area of the refresh*/
+void fbdev_flush_area(lv_disp_drv_t * drv, const lv_area_t * area, const lv_color_t * color_p, bool last);
+/*Rotation applied to LVGL's pixels to match the panel orientation; input devices should be rotated alike*/
+blit_rotation_t fbdev_get_rotation(void);
 
 /**********************
  *      MACROS
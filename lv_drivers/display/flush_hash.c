@@ -0,0 +1,200 @@
+/**
+ * @file flush_hash.c
+ *
+ */
+
+/* Implementation notes:
+ *
+ *  - Tiles are hashed in four independent lanes of 64 bit words, so the
+ *    multiplications pipeline, and can be vectorized by the compiler.
+ *
+ *  - A hash collision would leave a stale tile on the screen until it
+ *    changes again; 64 bit hashes make it unlikely enough.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "flush_hash.h"
+#if USE_FBDEV || USE_DRM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define FLUSH_HASH_PRIME 0x9E3779B185EBCA87ULL
+#define FLUSH_HASH_MIX   0xC2B2AE3D27D4EB4FULL
+
+#define err(msg, ...)   fprintf(stderr, "[display/flush_hash]: error: " msg "\n", ##__VA_ARGS__);
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool flush_hash_line(flush_hash_t * fh, lv_coord_t y, lv_coord_t x1, lv_coord_t x2, const lv_color_t * line, lv_coord_t * cx1, lv_coord_t * cx2);
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+bool flush_hash_init(flush_hash_t *fh, lv_coord_t width, lv_coord_t height)
+{
+	fh->cols = (width + FLUSH_HASH_TILE - 1) / FLUSH_HASH_TILE;
+	fh->width = width;
+	fh->height = height;
+	fh->hashes = calloc((size_t)fh->cols * height, sizeof(fh->hashes[0]));
+
+	if (!fh->hashes) {
+		err("cannot allocate hashes for %dx%d", width, height);
+		return false;
+	}
+
+	return true;
+}
+
+void flush_hash_reset(flush_hash_t *fh)
+{
+	if (fh->hashes) {
+		memset(fh->hashes, 0, (size_t)fh->cols * fh->height * sizeof(fh->hashes[0]));
+	}
+}
+
+uint32_t flush_hash_diff(flush_hash_t *fh, const lv_area_t *area, const lv_color_t *color_p, lv_area_t *bands, uint32_t max)
+{
+	lv_coord_t w = lv_area_get_width(area);
+	lv_area_t *band = NULL;
+	uint32_t count = 0;
+	lv_coord_t x1 = 0;
+	lv_coord_t x2 = 0;
+	lv_coord_t y;
+
+	for (y = area->y1; y <= area->y2; y++) {
+		if (!flush_hash_line(fh, y, area->x1, area->x2, color_p + (y - area->y1) * w, &x1, &x2)) {
+			// Ends the band.
+			band = NULL;
+			continue;
+		}
+
+		// Out of bands, grow the last one.
+		if (!band && count == max) {
+			band = &bands[count - 1];
+		}
+
+		if (band) {
+			band->x1 = LV_MATH_MIN(band->x1, x1);
+			band->x2 = LV_MATH_MAX(band->x2, x2);
+			band->y2 = y;
+			continue;
+		}
+
+		band = &bands[count++];
+		band->x1 = x1;
+		band->x2 = x2;
+		band->y1 = y;
+		band->y2 = y;
+	}
+
+	return count;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static inline uint64_t flush_hash_rotl(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * Hashes `len` pixels; never 0, which stands for unknown tiles.
+ */
+static inline uint64_t flush_hash_tile(const lv_color_t *p, lv_coord_t len)
+{
+	const uint8_t *bytes = (const uint8_t *)p;
+	size_t size = len * sizeof(lv_color_t);
+	uint64_t h[4] = {
+		0x243F6A8885A308D3ULL,
+		0x13198A2E03707344ULL,
+		0xA4093822299F31D0ULL,
+		0x082EFA98EC4E6C89ULL,
+	};
+	uint64_t word;
+	uint64_t x;
+	size_t i;
+
+	for (i = 0; i < size / sizeof(word); i++) {
+		memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+		h[i & 3] = (h[i & 3] ^ word) * FLUSH_HASH_PRIME;
+	}
+
+	// The tail of the last tile of a line.
+	if (size % sizeof(word)) {
+		word = 0;
+		memcpy(&word, bytes + i * sizeof(word), size % sizeof(word));
+		h[i & 3] = (h[i & 3] ^ word) * FLUSH_HASH_PRIME;
+	}
+
+	x = h[0] ^ flush_hash_rotl(h[1], 16) ^ flush_hash_rotl(h[2], 32) ^ flush_hash_rotl(h[3], 48);
+	x ^= x >> 33;
+	x *= FLUSH_HASH_MIX;
+	x ^= x >> 29;
+
+	return x | 1;
+}
+
+/**
+ * Finds the changed span, from `cx1` to `cx2`, of the line `y` of an area going from `x1` to `x2`.
+ * @return false when nothing changed
+ */
+static bool flush_hash_line(flush_hash_t *fh, lv_coord_t y, lv_coord_t x1, lv_coord_t x2, const lv_color_t *line, lv_coord_t *cx1, lv_coord_t *cx2)
+{
+	uint64_t *hashes;
+	lv_coord_t tx1, tx2;
+	lv_coord_t t;
+	uint64_t h;
+	bool changed = false;
+
+	// Not on the screen; cannot tell.
+	if (y < 0 || y >= fh->height || x1 < 0 || x2 >= fh->width) {
+		*cx1 = x1;
+		*cx2 = x2;
+		return true;
+	}
+
+	hashes = fh->hashes + (size_t)y * fh->cols;
+
+	for (t = x1 / FLUSH_HASH_TILE; t <= x2 / FLUSH_HASH_TILE; t++) {
+		// The last tile of a line is cut at the edge of the screen.
+		tx1 = t * FLUSH_HASH_TILE;
+		tx2 = LV_MATH_MIN(tx1 + FLUSH_HASH_TILE - 1, fh->width - 1);
+
+		// The pixels of partly covered tiles are always written, which changes their hashes.
+		if (tx1 < x1 || tx2 > x2) {
+			hashes[t] = 0;
+			tx1 = LV_MATH_MAX(tx1, x1);
+			tx2 = LV_MATH_MIN(tx2, x2);
+		}
+		else {
+			h = flush_hash_tile(line + tx1 - x1, tx2 - tx1 + 1);
+			if (h == hashes[t]) {
+				continue;
+			}
+			hashes[t] = h;
+		}
+
+		if (!changed) {
+			*cx1 = tx1;
+			changed = true;
+		}
+		*cx2 = tx2;
+	}
+
+	return changed;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file flush_hash.h
+ *
+ * Finds which parts of a flushed area actually changed, by hashing its
+ * lines in small tiles and comparing them to the last flushed content.
+ *
+ */
+
+#ifndef FLUSH_HASH_H
+#define FLUSH_HASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#ifndef LV_DRV_NO_CONF
+#ifdef LV_CONF_INCLUDE_SIMPLE
+#include "lv_drv_conf.h"
+#else
+#include "../../lv_drv_conf.h"
+#endif
+#endif
+
+#if USE_FBDEV || USE_DRM
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Width of the hashed tiles, in pixels */
+#define FLUSH_HASH_TILE 16
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct {
+	/* Hash of every tile of every line; 0 when unknown */
+	uint64_t * hashes;
+	/* Tiles in a line */
+	uint32_t cols;
+	/* Size of the screen, as LVGL sees it */
+	lv_coord_t width;
+	lv_coord_t height;
+} flush_hash_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Allocates the hashes for a `width`×`height` screen, all unknown.
+ */
+bool flush_hash_init(flush_hash_t * fh, lv_coord_t width, lv_coord_t height);
+
+/**
+ * Forgets the flushed content, e.g. when the screen was drawn over.
+ */
+void flush_hash_reset(flush_hash_t * fh);
+
+/**
+ * Finds the parts of an area which changed since they were last flushed, and
+ * remembers their new content.
+ * Consecutive changed lines are grouped in bands, spanning the changed tiles of
+ * all of their lines. The tiles the area only partly covers are always changed.
+ * @param area area being flushed
+ * @param color_p its pixels
+ * @param bands where to store the changed bands
+ * @param max size of `bands`; further bands are merged into the last one
+ * @return number of changed bands, 0 when nothing changed
+ */
+uint32_t flush_hash_diff(flush_hash_t * fh, const lv_area_t * area, const lv_color_t * color_p, lv_area_t * bands, uint32_t max);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif  /*USE_FBDEV || USE_DRM*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*FLUSH_HASH_H*/
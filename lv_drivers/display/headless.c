@@ -0,0 +1,421 @@
+/**
+ * @file headless.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "headless.h"
+#if USE_HEADLESS
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blit.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+// #define DRV_DEBUG
+
+#ifndef HEADLESS_GOLDEN_TOLERANCE
+#define HEADLESS_GOLDEN_TOLERANCE 0
+#endif
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+#define err(msg, ...)   fprintf(stderr, "[display/headless]: error: " msg "\n", ##__VA_ARGS__);
+#define print(msg, ...)	fprintf(stdout, "[display/headless]: " msg, ##__VA_ARGS__);
+#define info(msg, ...)    print(msg "\n", ##__VA_ARGS__)
+#ifdef DRV_DEBUG
+#define dbg(msg, ...)     print("(debug) " msg "\n", ##__VA_ARGS__)
+#else
+#define dbg(msg, ...) {}
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+struct headless {
+	lv_color_t *buf;
+	uint32_t width;
+	uint32_t height;
+	blit_rotation_t rotation;
+
+	uint32_t frame_count;
+	uint64_t frame_hash;
+
+	// From the environment, checking every frame.
+	const char *dump_dir;
+	const char *golden_dir;
+	uint32_t golden_failures;
+};
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void headless_present(void);
+static void headless_check_frame(void);
+static bool headless_read_ppm_header(FILE *file, uint32_t *width, uint32_t *height);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static struct headless headless;
+
+// Defaults, for the app to change before initialization.
+int headless_width = 720;
+int headless_height = 1280;
+int headless_rotation = 0;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void headless_init(lv_disp_drv_t *disp_drv)
+{
+	const char *env;
+	int width = headless_width;
+	int height = headless_height;
+	int rotation = headless_rotation;
+
+	env = getenv("LVGUI_HEADLESS_SIZE");
+	if (env && sscanf(env, "%dx%d", &width, &height) != 2) {
+		err("LVGUI_HEADLESS_SIZE should be <width>x<height>, not '%s'", env);
+		width = headless_width;
+		height = headless_height;
+	}
+
+	env = getenv("LVGUI_HEADLESS_ROTATION");
+	if (env) {
+		rotation = atoi(env);
+	}
+
+	if (width <= 0 || height <= 0 || width > LV_HOR_RES_MAX || height > LV_VER_RES_MAX) {
+		err("%dx%d does not fit in %dx%d", width, height, LV_HOR_RES_MAX, LV_VER_RES_MAX);
+		width = LV_MATH_MIN(LV_MATH_MAX(width, 1), LV_HOR_RES_MAX);
+		height = LV_MATH_MIN(LV_MATH_MAX(height, 1), LV_VER_RES_MAX);
+	}
+
+	switch (rotation) {
+		case 0:
+			headless.rotation = BLIT_ROTATE_0;
+			break;
+		case 90:
+			headless.rotation = BLIT_ROTATE_CW;
+			break;
+		case 180:
+			headless.rotation = BLIT_ROTATE_180;
+			break;
+		case 270:
+			headless.rotation = BLIT_ROTATE_CCW;
+			break;
+		default:
+			err("rotation should be 0, 90, 180 or 270, not %d", rotation);
+			rotation = 0;
+			headless.rotation = BLIT_ROTATE_0;
+			break;
+	}
+
+	headless.width = width;
+	headless.height = height;
+	headless.buf = calloc((size_t)width * height, sizeof(lv_color_t));
+	if (!headless.buf) {
+		err("cannot allocate %dx%d framebuffer", width, height);
+		abort();
+	}
+
+	headless.dump_dir = getenv("LVGUI_HEADLESS_DUMP");
+	headless.golden_dir = getenv("LVGUI_HEADLESS_GOLDEN");
+
+	// As for DRM, the resolution is the panel's, and LVGL swaps it for quarter turns.
+	disp_drv->hor_res = width;
+	disp_drv->ver_res = height;
+	disp_drv->rotated = (rotation == 90 || rotation == 270) ? 1 : 0;
+
+	info("%dx%d, rotated %d degrees", width, height, rotation);
+}
+
+void headless_exit(void)
+{
+	if (headless.golden_dir) {
+		info("%u of %u frames did not match the golden images", headless.golden_failures, headless.frame_count);
+	}
+
+	free(headless.buf);
+	headless.buf = NULL;
+}
+
+void headless_flush(lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p)
+{
+	lv_area_t damage = *area;
+	lv_coord_t w = lv_area_get_width(area);
+	lv_coord_t h = lv_area_get_height(area);
+
+	dbg("headless_flush() x %d:%d y %d:%d w %d h %d", area->x1, area->x2, area->y1, area->y2, w, h);
+
+	// Where the area lands in the buffer, which is in the panel's native orientation.
+	switch (headless.rotation) {
+		case BLIT_ROTATE_0:
+			break;
+		case BLIT_ROTATE_180:
+			damage.x1 = headless.width - area->x2 - 1;
+			damage.x2 = headless.width - area->x1 - 1;
+			damage.y1 = headless.height - area->y2 - 1;
+			damage.y2 = headless.height - area->y1 - 1;
+			break;
+		case BLIT_ROTATE_CW:
+			damage.x1 = headless.width - area->y2 - 1;
+			damage.x2 = headless.width - area->y1 - 1;
+			damage.y1 = area->x1;
+			damage.y2 = area->x2;
+			break;
+		case BLIT_ROTATE_CCW:
+			damage.x1 = area->y1;
+			damage.x2 = area->y2;
+			damage.y1 = headless.height - area->x2 - 1;
+			damage.y2 = headless.height - area->x1 - 1;
+			break;
+	}
+
+	if (headless.buf && damage.x1 >= 0 && damage.y1 >= 0 && damage.x2 < (lv_coord_t)headless.width && damage.y2 < (lv_coord_t)headless.height) {
+#if LV_COLOR_DEPTH == 16
+		blit_rotate_16(
+			headless.rotation,
+			(const uint16_t *)color_p, w * sizeof(lv_color_t),
+			(uint16_t *)(headless.buf + damage.y1 * headless.width + damage.x1), headless.width * sizeof(lv_color_t),
+			w, h
+		);
+#else
+		blit_rotate_32(
+			headless.rotation,
+			(const uint32_t *)color_p, w * sizeof(lv_color_t),
+			(uint32_t *)(headless.buf + damage.y1 * headless.width + damage.x1), headless.width * sizeof(lv_color_t),
+			w, h
+		);
+#endif
+	}
+	else {
+		err("area x %d:%d y %d:%d out of the screen", area->x1, area->x2, area->y1, area->y2);
+	}
+
+	if (lv_disp_flush_is_last(disp_drv)) {
+		headless_present();
+	}
+
+	lv_disp_flush_ready(disp_drv);
+}
+
+const lv_color_t * headless_get_buffer(uint32_t *width, uint32_t *height)
+{
+	if (width) {
+		*width = headless.width;
+	}
+	if (height) {
+		*height = headless.height;
+	}
+
+	return headless.buf;
+}
+
+uint32_t headless_get_frame_count(void)
+{
+	return headless.frame_count;
+}
+
+uint64_t headless_get_frame_hash(void)
+{
+	return headless.frame_hash;
+}
+
+bool headless_dump_ppm(const char *path)
+{
+	FILE *file;
+	lv_color32_t c;
+	uint8_t rgb[3];
+	uint32_t i;
+	bool ok;
+
+	file = fopen(path, "wb");
+	if (!file) {
+		err("cannot open '%s': %s", path, strerror(errno));
+		return false;
+	}
+
+	fprintf(file, "P6\n%u %u\n255\n", headless.width, headless.height);
+	for (i = 0; i < headless.width * headless.height; i++) {
+		c.full = lv_color_to32(headless.buf[i]);
+		rgb[0] = c.ch.red;
+		rgb[1] = c.ch.green;
+		rgb[2] = c.ch.blue;
+		fwrite(rgb, sizeof(rgb), 1, file);
+	}
+
+	ok = !ferror(file);
+	if (fclose(file) || !ok) {
+		err("cannot write '%s': %s", path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+int32_t headless_compare_ppm(const char *path, uint8_t tolerance)
+{
+	FILE *file;
+	lv_color32_t c;
+	uint8_t rgb[3];
+	uint32_t width, height;
+	uint32_t i;
+	int32_t diff = 0;
+
+	file = fopen(path, "rb");
+	if (!file) {
+		err("cannot open '%s': %s", path, strerror(errno));
+		return -1;
+	}
+
+	if (!headless_read_ppm_header(file, &width, &height)) {
+		err("'%s' is not a binary PPM image with 8 bit components", path);
+		fclose(file);
+		return -1;
+	}
+
+	if (width != headless.width || height != headless.height) {
+		err("'%s' is %ux%u, frames are %ux%u", path, width, height, headless.width, headless.height);
+		fclose(file);
+		return -1;
+	}
+
+	for (i = 0; i < width * height; i++) {
+		if (fread(rgb, sizeof(rgb), 1, file) != 1) {
+			err("'%s' is truncated", path);
+			fclose(file);
+			return -1;
+		}
+
+		c.full = lv_color_to32(headless.buf[i]);
+		if (
+			abs(rgb[0] - c.ch.red) > tolerance ||
+			abs(rgb[1] - c.ch.green) > tolerance ||
+			abs(rgb[2] - c.ch.blue) > tolerance
+		) {
+			diff++;
+		}
+	}
+
+	fclose(file);
+
+	return diff;
+}
+
+uint32_t headless_get_golden_failures(void)
+{
+	return headless.golden_failures;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Called once every area of a refresh cycle is in the buffer.
+ */
+static void headless_present(void)
+{
+	const uint8_t *p = (const uint8_t *)headless.buf;
+	size_t len = (size_t)headless.width * headless.height * sizeof(lv_color_t);
+	uint64_t hash = FNV_OFFSET_BASIS;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+
+	headless.frame_hash = hash;
+	headless.frame_count++;
+
+	dbg("frame %u: %016llx", headless.frame_count, (unsigned long long)hash);
+
+	headless_check_frame();
+}
+
+/**
+ * Dumps the frame, and compares it to its golden image, as asked by the environment.
+ */
+static void headless_check_frame(void)
+{
+	static char path[PATH_MAX];
+	int32_t diff;
+
+	if (headless.dump_dir) {
+		snprintf(path, sizeof(path), "%s/frame-%05u.ppm", headless.dump_dir, headless.frame_count);
+		if (headless_dump_ppm(path)) {
+			info("frame %u: %016llx -> %s", headless.frame_count, (unsigned long long)headless.frame_hash, path);
+		}
+	}
+
+	if (headless.golden_dir) {
+		snprintf(path, sizeof(path), "%s/frame-%05u.ppm", headless.golden_dir, headless.frame_count);
+		diff = headless_compare_ppm(path, HEADLESS_GOLDEN_TOLERANCE);
+		if (diff != 0) {
+			headless.golden_failures++;
+		}
+		if (diff > 0) {
+			err("frame %u: %d pixels differ from %s", headless.frame_count, diff, path);
+		}
+	}
+}
+
+/**
+ * Reads the header of a binary PPM image, leaving `file` at the first pixel.
+ */
+static bool headless_read_ppm_header(FILE *file, uint32_t *width, uint32_t *height)
+{
+	unsigned int values[3];
+	int i;
+	int c;
+
+	if (fgetc(file) != 'P' || fgetc(file) != '6') {
+		return false;
+	}
+
+	for (i = 0; i < 3; i++) {
+		// Whitespace and comments may come before any value.
+		for (;;) {
+			c = fgetc(file);
+			if (c == '#') {
+				while (c != '\n' && c != EOF) {
+					c = fgetc(file);
+				}
+			}
+			else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+				break;
+			}
+		}
+		if (c == EOF || ungetc(c, file) == EOF || fscanf(file, "%u", &values[i]) != 1) {
+			return false;
+		}
+	}
+
+	// A single whitespace character separates the header from the pixels.
+	c = fgetc(file);
+	if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+		return false;
+	}
+
+	*width = values[0];
+	*height = values[1];
+
+	return values[2] == 255;
+}
+
+#endif
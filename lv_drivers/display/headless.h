@@ -0,0 +1,113 @@
+/**
+ * @file headless.h
+ *
+ * Display driver rendering in memory, without any display.
+ * Frames can be hashed, dumped as PPM images and compared to golden images,
+ * to check the rendering on machines without a GPU or a windowing system.
+ *
+ */
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#ifndef LV_DRV_NO_CONF
+#ifdef LV_CONF_INCLUDE_SIMPLE
+#include "lv_drv_conf.h"
+#else
+#include "../../lv_drv_conf.h"
+#endif
+#endif
+
+#if USE_HEADLESS
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef LV_LVGL_H_INCLUDE_SIMPLE
+#include "lvgl.h"
+#else
+#include "lvgl/lvgl.h"
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Allocates the framebuffer and sets the resolution of the driver.
+ *
+ * The framebuffer is `headless_width`×`headless_height`, as a panel in its
+ * native orientation. `headless_rotation` (0, 90, 180 or 270 degrees,
+ * clockwise) rotates the content as for a panel mounted rotated.
+ *
+ * The environment can override those, and ask for every frame to be
+ * checked, for use in scripts:
+ *
+ *  - `LVGUI_HEADLESS_SIZE`: `<width>x<height>`
+ *  - `LVGUI_HEADLESS_ROTATION`: `0`, `90`, `180` or `270`
+ *  - `LVGUI_HEADLESS_DUMP`: directory where frames are written, as `frame-00001.ppm`...
+ *  - `LVGUI_HEADLESS_GOLDEN`: directory of the images frames are compared to, with the same names
+ */
+void headless_init(lv_disp_drv_t * disp_drv);
+void headless_exit(void);
+void headless_flush(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p);
+
+/**
+ * The framebuffer, in the panel's native orientation.
+ */
+const lv_color_t * headless_get_buffer(uint32_t * width, uint32_t * height);
+
+/**
+ * Number of frames presented since initialization.
+ */
+uint32_t headless_get_frame_count(void);
+
+/**
+ * 64 bit FNV-1a hash of the pixels of the last presented frame.
+ */
+uint64_t headless_get_frame_hash(void);
+
+/**
+ * Writes the last presented frame as a binary PPM image.
+ * @return whether the image was written
+ */
+bool headless_dump_ppm(const char * path);
+
+/**
+ * Compares the last presented frame to a binary PPM image.
+ * @param tolerance largest difference allowed on a component
+ * @return number of pixels differing, or -1 when the image cannot be read or is not the same size
+ */
+int32_t headless_compare_ppm(const char * path, uint8_t tolerance);
+
+/**
+ * Number of frames which did not match their golden image, with `LVGUI_HEADLESS_GOLDEN`.
+ */
+uint32_t headless_get_golden_failures(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif  /*USE_HEADLESS*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*HEADLESS_H*/
@@ -17,6 +17,11 @@
 #include <stdbool.h>
 #include <string.h>
 #include MONITOR_SDL_INCLUDE_PATH
+#if defined(__linux__)
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 #include "../indev/mouse.h"
 #include "../indev/keyboard.h"
 #include "../indev/mousewheel.h"
@@ -26,6 +31,9 @@
  *********************/
 #define SDL_REFR_PERIOD     50  /*ms*/
 
+/*Changed areas uploaded separately before being merged together*/
+#define MONITOR_DIRTY_MAX   LV_INV_BUF_SIZE
+
 #ifndef MONITOR_ZOOM
 #define MONITOR_ZOOM        1
 #endif
@@ -56,6 +64,11 @@ typedef struct {
     SDL_Renderer * renderer;
     SDL_Texture * texture;
     volatile bool sdl_refr_qry;
+    /*Protects the frame buffer and the dirty areas, shared with the SDL thread*/
+    SDL_mutex * lock;
+    /*Areas changed since the texture was last updated*/
+    SDL_Rect dirty[MONITOR_DIRTY_MAX];
+    int dirty_cnt;
 #if MONITOR_DOUBLE_BUFFERED
     uint32_t * tft_fb_act;
 #else
@@ -69,6 +82,8 @@ typedef struct {
 static int monitor_sdl_refr_thread(void * param);
 static void window_create(monitor_t * m);
 static void window_update(monitor_t * m);
+static void monitor_flush_area(monitor_t * m, lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p);
+static void monitor_add_dirty(monitor_t * m, const lv_area_t * area);
 
 /***********************
  *   GLOBAL PROTOTYPES
@@ -85,6 +100,10 @@ monitor_t monitor2;
 
 static volatile bool sdl_inited = false;
 static volatile bool sdl_quit_qry = false;
+/*Pushed by the flush to wake the SDL thread up when a frame is ready*/
+static Uint32 monitor_refr_event = (Uint32)-1;
+/*Signaled by the SDL thread when it handled input events (see `monitor_get_fd`)*/
+static int monitor_input_fd = -1;
 
 int quit_filter(void * userdata, SDL_Event * event);
 static void monitor_sdl_clean_up(void);
@@ -117,12 +136,26 @@ void monitor_init(void)
     monitor_sdl_init();
 #endif
 
+#if defined(__linux__)
+    monitor_input_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+
 #ifndef MONITOR_EMSCRIPTEN
     SDL_CreateThread(monitor_sdl_refr_thread, "sdl_refr", NULL);
     while(sdl_inited == false); /*Wait until 'sdl_refr' initializes the SDL*/
 #endif
 }
 
+/**
+ * Get a file descriptor readable once the SDL thread handled input events,
+ * so the input devices have something to read. Reading it clears it.
+ * @return the file descriptor, or -1 when not available
+ */
+int monitor_get_fd(void)
+{
+    return monitor_input_fd;
+}
+
 /**
  * Flush a buffer to the marked area
  * @param drv pointer to driver where this function belongs
@@ -131,50 +164,7 @@ void monitor_init(void)
  */
 void monitor_flush(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p)
 {
-    lv_coord_t hres = disp_drv->rotated == 0 ? disp_drv->hor_res : disp_drv->ver_res;
-    lv_coord_t vres = disp_drv->rotated == 0 ? disp_drv->ver_res : disp_drv->hor_res;
-
-//    printf("x1:%d,y1:%d,x2:%d,y2:%d\n", area->x1, area->y1, area->x2, area->y2);
-
-    /*Return if the area is out the screen*/
-    if(area->x2 < 0 || area->y2 < 0 || area->x1 > hres - 1 || area->y1 > vres - 1) {
-
-        lv_disp_flush_ready(disp_drv);
-        return;
-    }
-
-#if MONITOR_DOUBLE_BUFFERED
-    monitor.tft_fb_act = (uint32_t *)color_p;
-
-    monitor.sdl_refr_qry = true;
-
-    /*IMPORTANT! It must be called to tell the system the flush is ready*/
-    lv_disp_flush_ready(disp_drv);
-#else
-
-    int32_t y;
-#if LV_COLOR_DEPTH != 24 && LV_COLOR_DEPTH != 32    /*32 is valid but support 24 for backward compatibility too*/
-    int32_t x;
-    for(y = area->y1; y <= area->y2 && y < disp_drv->ver_res; y++) {
-        for(x = area->x1; x <= area->x2; x++) {
-            monitor.tft_fb[y * disp_drv->hor_res + x] = lv_color_to32(*color_p);
-            color_p++;
-        }
-
-    }
-#else
-    uint32_t w = lv_area_get_width(area);
-    for(y = area->y1; y <= area->y2 && y < disp_drv->ver_res; y++) {
-        memcpy(&monitor.tft_fb[y * MONITOR_HOR_RES + area->x1], color_p, w * sizeof(lv_color_t));
-        color_p += w;
-    }
-#endif
-
-    monitor.sdl_refr_qry = true;
-
-    /*IMPORTANT! It must be called to tell the system the flush is ready*/
-    lv_disp_flush_ready(disp_drv);
-#endif
+    monitor_flush_area(&monitor, disp_drv, area, color_p);
 }
 
 
@@ -187,31 +177,45 @@ void monitor_flush(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t
  * @param color_p an array of pixel to copy to the `area` part of the screen
  */
 void monitor_flush2(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p)
+{
+    monitor_flush_area(&monitor2, disp_drv, area, color_p);
+}
+#endif
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Copy a flushed area to the frame buffer of a window, and have the SDL thread
+ * show it once the whole frame is there.
+ */
+static void monitor_flush_area(monitor_t * m, lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p)
 {
     lv_coord_t hres = disp_drv->rotated == 0 ? disp_drv->hor_res : disp_drv->ver_res;
     lv_coord_t vres = disp_drv->rotated == 0 ? disp_drv->ver_res : disp_drv->hor_res;
+    bool last = lv_disp_flush_is_last(disp_drv);
+
+//    printf("x1:%d,y1:%d,x2:%d,y2:%d\n", area->x1, area->y1, area->x2, area->y2);
 
     /*Return if the area is out the screen*/
     if(area->x2 < 0 || area->y2 < 0 || area->x1 > hres - 1 || area->y1 > vres - 1) {
+
         lv_disp_flush_ready(disp_drv);
         return;
     }
 
-#if MONITOR_DOUBLE_BUFFERED
-    monitor2.tft_fb_act = (uint32_t *)color_p;
-
-    monitor2.sdl_refr_qry = true;
+    SDL_LockMutex(m->lock);
 
-    /*IMPORTANT! It must be called to tell the system the flush is ready*/
-    lv_disp_flush_ready(disp_drv);
+#if MONITOR_DOUBLE_BUFFERED
+    m->tft_fb_act = (uint32_t *)color_p;
 #else
-
     int32_t y;
 #if LV_COLOR_DEPTH != 24 && LV_COLOR_DEPTH != 32    /*32 is valid but support 24 for backward compatibility too*/
     int32_t x;
     for(y = area->y1; y <= area->y2 && y < disp_drv->ver_res; y++) {
         for(x = area->x1; x <= area->x2; x++) {
-            monitor2.tft_fb[y * disp_drv->hor_res + x] = lv_color_to32(*color_p);
+            m->tft_fb[y * disp_drv->hor_res + x] = lv_color_to32(*color_p);
             color_p++;
         }
 
@@ -219,22 +223,53 @@ void monitor_flush2(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t
 #else
     uint32_t w = lv_area_get_width(area);
     for(y = area->y1; y <= area->y2 && y < disp_drv->ver_res; y++) {
-        memcpy(&monitor2.tft_fb[y * disp_drv->hor_res + area->x1], color_p, w * sizeof(lv_color_t));
+        memcpy(&m->tft_fb[y * MONITOR_HOR_RES + area->x1], color_p, w * sizeof(lv_color_t));
         color_p += w;
     }
 #endif
+#endif
+
+    monitor_add_dirty(m, area);
+
+    /*Present once per refresh, not once per area*/
+    if(last) m->sdl_refr_qry = true;
 
-    monitor2.sdl_refr_qry = true;
+    SDL_UnlockMutex(m->lock);
+
+#if !defined(MONITOR_APPLE) && !defined(MONITOR_EMSCRIPTEN)
+    if(last) {
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = monitor_refr_event;
+        SDL_PushEvent(&event);
+    }
+#endif
 
     /*IMPORTANT! It must be called to tell the system the flush is ready*/
     lv_disp_flush_ready(disp_drv);
-#endif
 }
-#endif
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
+/**
+ * Remember an area to upload to the texture. Called with the lock held.
+ */
+static void monitor_add_dirty(monitor_t * m, const lv_area_t * area)
+{
+    SDL_Rect screen = {0, 0, MONITOR_HOR_RES, MONITOR_VER_RES};
+    SDL_Rect r;
+
+    r.x = area->x1;
+    r.y = area->y1;
+    r.w = lv_area_get_width(area);
+    r.h = lv_area_get_height(area);
+    if(!SDL_IntersectRect(&r, &screen, &r)) return;
+
+    if(m->dirty_cnt < MONITOR_DIRTY_MAX) {
+        m->dirty[m->dirty_cnt] = r;
+        m->dirty_cnt++;
+    } else {
+        SDL_UnionRect(&m->dirty[MONITOR_DIRTY_MAX - 1], &r, &m->dirty[MONITOR_DIRTY_MAX - 1]);
+    }
+}
 
 /**
  * SDL main thread. All SDL related task have to be handled here!
@@ -284,11 +319,13 @@ static void monitor_sdl_clean_up(void)
     SDL_DestroyTexture(monitor.texture);
     SDL_DestroyRenderer(monitor.renderer);
     SDL_DestroyWindow(monitor.window);
+    SDL_DestroyMutex(monitor.lock);
 
 #if MONITOR_DUAL
     SDL_DestroyTexture(monitor2.texture);
     SDL_DestroyRenderer(monitor2.renderer);
     SDL_DestroyWindow(monitor2.window);
+    SDL_DestroyMutex(monitor2.lock);
 
 #endif
 
@@ -302,6 +339,8 @@ static void monitor_sdl_init(void)
 
     SDL_SetEventFilter(quit_filter, NULL);
 
+    monitor_refr_event = SDL_RegisterEvents(1);
+
     window_create(&monitor);
 #if MONITOR_DUAL
     window_create(&monitor2);
@@ -320,22 +359,16 @@ void monitor_sdl_refr_core(void)
 static void monitor_sdl_refr_core(void)
 #endif
 {
+#if !defined(MONITOR_APPLE) && !defined(MONITOR_EMSCRIPTEN)
+    SDL_Event event;
+    bool input = false;
 
-    if(monitor.sdl_refr_qry != false) {
-        monitor.sdl_refr_qry = false;
-        window_update(&monitor);
-    }
+    /*Sleep until there is input, or a frame to show (see `monitor_flush_area`)*/
+    if(SDL_WaitEvent(&event) == 0) return;
 
-#if MONITOR_DUAL
-    if(monitor2.sdl_refr_qry != false) {
-        monitor2.sdl_refr_qry = false;
-        window_update(&monitor2);
-    }
-#endif
+    do {
+        if(event.type != monitor_refr_event) input = true;
 
-#if !defined(MONITOR_APPLE) && !defined(MONITOR_EMSCRIPTEN)
-    SDL_Event event;
-    while(SDL_PollEvent(&event)) {
 #if USE_MOUSE != 0
         mouse_handler(&event);
 #endif
@@ -362,12 +395,37 @@ static void monitor_sdl_refr_core(void)
                     break;
             }
         }
+    } while(SDL_PollEvent(&event));
+
+#if defined(__linux__)
+    /*Wake up a main loop waiting for input*/
+    if(input && monitor_input_fd >= 0) {
+        uint64_t one = 1;
+        if(write(monitor_input_fd, &one, sizeof(one)) < 0) {
+            /*Only fails when the counter would overflow: it's readable anyway*/
+        }
     }
+#else
+    (void)input;
+#endif
 #endif /*MONITOR_APPLE*/
 
+    if(monitor.sdl_refr_qry != false) {
+        monitor.sdl_refr_qry = false;
+        window_update(&monitor);
+    }
+
+#if MONITOR_DUAL
+    if(monitor2.sdl_refr_qry != false) {
+        monitor2.sdl_refr_qry = false;
+        window_update(&monitor2);
+    }
+#endif
+
+#if defined(MONITOR_APPLE) || defined(MONITOR_EMSCRIPTEN)
     /*Sleep some time*/
     SDL_Delay(SDL_REFR_PERIOD);
-
+#endif
 }
 
 static void window_create(monitor_t * m)
@@ -391,6 +449,7 @@ static void window_create(monitor_t * m)
 #else
     m->renderer = SDL_CreateRenderer(m->window, -1, 0);
 #endif
+    m->lock = SDL_CreateMutex();
     m->texture = SDL_CreateTexture(m->renderer,
                                 SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, MONITOR_HOR_RES, MONITOR_VER_RES);
     SDL_SetTextureBlendMode(m->texture, SDL_BLENDMODE_BLEND);
@@ -402,18 +461,35 @@ static void window_create(monitor_t * m)
     memset(m->tft_fb, 0x44, MONITOR_HOR_RES * MONITOR_VER_RES * sizeof(uint32_t));
 #endif
 
+    m->dirty[0].x = 0;
+    m->dirty[0].y = 0;
+    m->dirty[0].w = MONITOR_HOR_RES;
+    m->dirty[0].h = MONITOR_VER_RES;
+    m->dirty_cnt = 1;
     m->sdl_refr_qry = true;
 
 }
 
 static void window_update(monitor_t * m)
 {
+    uint32_t * fb;
+    int i;
+
+    /*Only upload what changed; the texture keeps the rest*/
+    SDL_LockMutex(m->lock);
 #if MONITOR_DOUBLE_BUFFERED == 0
-    SDL_UpdateTexture(m->texture, NULL, m->tft_fb, MONITOR_HOR_RES * sizeof(uint32_t));
+    fb = m->tft_fb;
 #else
-    if(m->tft_fb_act == NULL) return;
-    SDL_UpdateTexture(m->texture, NULL, m->tft_fb_act, MONITOR_HOR_RES * sizeof(uint32_t));
+    fb = m->tft_fb_act;
 #endif
+    if(fb != NULL) {
+        for(i = 0; i < m->dirty_cnt; i++) {
+            SDL_UpdateTexture(m->texture, &m->dirty[i], &fb[m->dirty[i].y * MONITOR_HOR_RES + m->dirty[i].x], MONITOR_HOR_RES * sizeof(uint32_t));
+        }
+        m->dirty_cnt = 0;
+    }
+    SDL_UnlockMutex(m->lock);
+
     SDL_RenderClear(m->renderer);
 #if LV_COLOR_SCREEN_TRANSP
     SDL_SetRenderDrawColor(m->renderer, 0xff, 0, 0, 0xff);
@@ -45,6 +45,13 @@ void monitor_flush(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t
 void monitor_flush2(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p);
 void monitor_set_resolution(lv_disp_drv_t* disp_drv);
 
+/**
+ * Get a file descriptor readable once the SDL thread handled input events,
+ * so the input devices have something to read. Reading it clears it.
+ * @return the file descriptor, or -1 when not available
+ */
+int monitor_get_fd(void);
+
 /**********************
  *      MACROS
  **********************/
@@ -6,12 +6,18 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include <string.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/inotify.h>
 #include <linux/limits.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <linux/input.h>
-#include "../display/drm.h"
 
 #include <xkbcommon/xkbcommon.h>
 #include <xkbcommon/xkbcommon-compose.h>
@@ -45,16 +51,66 @@
  *      DEFINES
  *********************/
 
+// Events handed over from the reader to the read tasks; a power of two.
+#define LIBINPUT_DRV_RING_SIZE 256
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+struct libinput_drv_ring_entry {
+	libinput_drv_kind_t kind;
+	libinput_drv_event_t event;
+};
+
+// A device added to the context.
+struct libinput_drv_device {
+	char *path;
+	struct libinput_device *device;
+	// Instances its events go to, as a mask of `1 << libinput_drv_kind_t`.
+	uint8_t kinds;
+};
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 static int open_restricted(const char *path, int flags, void *user_data);
 static void close_restricted(int fd, void *user_data);
 
+/**
+ * Creates the libinput context shared by all devices, once.
+ */
+static bool libinput_drv_context_init(void);
+static void libinput_drv_lock(void);
+static void libinput_drv_unlock(void);
+/**
+ * Finds a device by the path it was added with; call with the lock held.
+ * @return its index in `devices`, or -1
+ */
+static int libinput_drv_find_device(const char* dev_name);
+/**
+ * Drops a device from `devices`, once libinput removed it; call with the lock held.
+ * @return the number of events queued to release its instances
+ */
+static uint32_t libinput_drv_forget_device(int index);
+
+/**
+ * Reads the events of all devices, and queues them for their instance.
+ * @return the number of events queued
+ */
+static uint32_t libinput_drv_read_events(void);
+static void libinput_drv_push_pointer(libinput_drv_instance* instance, uint64_t time_usec);
+static void libinput_drv_push(libinput_drv_instance* instance, const lv_indev_data_t * data, uint64_t time_usec);
+/**
+ * Hands the events queued by the reader to their instance.
+ */
+static void libinput_drv_drain(void);
+static void libinput_drv_queue(libinput_drv_instance* instance, const libinput_drv_event_t * event);
+#if LIBINPUT_DRV_READER_THREAD
+static bool libinput_drv_reader_start(void);
+static void * libinput_drv_reader(void * data);
+#endif
+
 /**
  * Handles keyboard inputs
  */
@@ -62,11 +118,7 @@ static void libinput_drv_handle_keyboard_input(libinput_drv_instance* instance,
 /**
  * Manages memory allocation for libinput_drv_instance
  */
-static libinput_drv_instance* libinput_drv_instance_new();
-/**
- * Manages memory deallocation for libinput_drv_instance
- */
-static void libinput_drv_instance_destroy(libinput_drv_instance* instance);
+static libinput_drv_instance* libinput_drv_instance_new(libinput_drv_kind_t kind);
 
 static int xkbcommon_init();
 
@@ -80,6 +132,43 @@ static const struct libinput_interface drv_libinput_interface = {
   .close_restricted = close_restricted,
 };
 
+// One context for all devices, so there is a single file descriptor to poll
+// and a single queue of events.
+static struct libinput *libinput_context = NULL;
+
+static libinput_drv_instance *instances[LIBINPUT_DRV_KIND_COUNT];
+
+static struct libinput_drv_device devices[LIBINPUT_DRV_DEVICES_MAX];
+static int device_count = 0;
+
+// inotify watching `LIBINPUT_DRV_HOTPLUG_DIR`.
+static int hotplug_fd = -1;
+
+// Orientation of the panel, from the display driver; see `libinput_drv_set_orientation`.
+static libinput_drv_orientation_t orientation = LIBINPUT_DRV_ORIENTATION_NORMAL;
+
+// Events read from the devices, not handed to their instance yet. There is
+// a single producer, reading the devices, and a single consumer, the thread
+// running LVGL; `ring_tail` is only written by the former, `ring_head` by the latter.
+static struct libinput_drv_ring_entry ring[LIBINPUT_DRV_RING_SIZE];
+static uint32_t ring_head = 0;
+static uint32_t ring_tail = 0;
+
+#if LIBINPUT_DRV_READER_THREAD
+// libinput is not thread safe; held by the reader thread while it reads the
+// devices, and while adding or removing devices.
+static pthread_mutex_t libinput_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t reader_thread;
+// Signaled by the reader thread once it queued events.
+static int reader_fd = -1;
+#endif
+
+static const char *instance_names[LIBINPUT_DRV_KIND_COUNT] = {
+	[LIBINPUT_DRV_TOUCHSCREEN] = "touchscreen",
+	[LIBINPUT_DRV_POINTER] = "pointer",
+	[LIBINPUT_DRV_KEYBOARD] = "keyboard",
+};
+
 static struct xkb_keymap *our_xkb_keymap = NULL;
 static struct xkb_state  *our_xkb_state = NULL;
 static struct xkb_compose_state *our_xkb_compose_state = NULL;
@@ -93,96 +182,231 @@ static int handle_xkbcommon_input(int keycode, int direction, char *key_characte
  *   GLOBAL FUNCTIONS
  **********************/
 
-/**
- * reconfigure the device file for libinput
- * @param dev_name set the libinput device filename
- * @return true: the device file set complete
- *         false: the device file doesn't exist current system
- */
-bool libinput_set_file(libinput_drv_instance* instance, char* dev_name)
+bool libinput_drv_add_device(char* dev_name)
 {
-	// This check *should* not be necessary, yet applications crashes even on NULL handles.
-	// citing libinput.h:libinput_path_remove_device:
-	// > If no matching device exists, this function does nothing.
-	if (instance->libinput_device) {
-		instance->libinput_device = libinput_device_unref(instance->libinput_device);
-		libinput_path_remove_device(instance->libinput_device);
+	struct libinput_device *device;
+	bool is_pointer;
+	bool is_touchscreen;
+	bool is_keyboard;
+	uint8_t kinds = 0;
+
+	LVGUI_LOG_INFO("[indev/libinput]: Adding '%s'...", dev_name);
+
+	if (!libinput_drv_context_init()) {
+		return false;
 	}
 
-	instance->libinput_device = libinput_path_add_device(instance->libinput_context, dev_name);
-	if(!instance->libinput_device) {
+	libinput_drv_lock();
+
+	if (libinput_drv_find_device(dev_name) >= 0) {
+		libinput_drv_unlock();
+		LVGUI_LOG_INFO("[indev/libinput]: '%s' was already added.", dev_name);
+		return true;
+	}
+	if (device_count == LIBINPUT_DRV_DEVICES_MAX) {
+		libinput_drv_unlock();
+		LVGUI_LOG_ERROR("[indev/libinput]: Unable to add '%s', %d devices already added.", dev_name, LIBINPUT_DRV_DEVICES_MAX);
+		return false;
+	}
+
+	device = libinput_path_add_device(libinput_context, dev_name);
+	if (!device) {
 		perror("unable to add device to libinput context:");
+		libinput_drv_unlock();
+		return false;
+	}
+
+	// Add some metadata
+	is_pointer = libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_POINTER);
+	is_touchscreen = libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_TOUCH);
+	is_keyboard = libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_KEYBOARD);
+
+#if LV_LOG_LEVEL <= LV_LOG_LEVEL_INFO
+	LVGUI_LOG_INFO("");
+	LVGUI_LOG_INFO(
+		"> Device *%s* (`%s`):",
+		libinput_device_get_name(device),
+		libinput_device_get_sysname(device)
+	);
+	if (is_pointer)     { LVGUI_LOG_INFO(">  - is a pointer"); }
+	if (is_touchscreen) { LVGUI_LOG_INFO(">  - is a touchscreen"); }
+	if (is_keyboard)    { LVGUI_LOG_INFO(">  - is a keyboard"); }
+	LVGUI_LOG_INFO("");
+#endif
+
+	// Events are demultiplexed by their type, devices only tell which instances are needed.
+	if (is_touchscreen) {
+		kinds |= 1 << LIBINPUT_DRV_TOUCHSCREEN;
+		if (!instances[LIBINPUT_DRV_TOUCHSCREEN]) {
+			instances[LIBINPUT_DRV_TOUCHSCREEN] = libinput_drv_instance_new(LIBINPUT_DRV_TOUCHSCREEN);
+		}
+	}
+	if (is_pointer) {
+		kinds |= 1 << LIBINPUT_DRV_POINTER;
+		if (!instances[LIBINPUT_DRV_POINTER]) {
+			instances[LIBINPUT_DRV_POINTER] = libinput_drv_instance_new(LIBINPUT_DRV_POINTER);
+		}
+	}
+	if (is_keyboard) {
+		kinds |= 1 << LIBINPUT_DRV_KEYBOARD;
+		if (!instances[LIBINPUT_DRV_KEYBOARD]) {
+			instances[LIBINPUT_DRV_KEYBOARD] = libinput_drv_instance_new(LIBINPUT_DRV_KEYBOARD);
+
+			// Initialize xkbcommon, once for all keyboards.
+			xkbcommon_init();
+		}
+	}
+
+	// The context keeps its own reference until the device is removed, this
+	// one keeps it valid until it's forgotten.
+	devices[device_count].path = strdup(dev_name);
+	devices[device_count].device = libinput_device_ref(device);
+	devices[device_count].kinds = kinds;
+	device_count++;
+
+	libinput_drv_unlock();
+
+	LVGUI_LOG_INFO("[indev/libinput]: done with '%s'...", dev_name);
+
+	return true;
+}
+
+bool libinput_drv_remove_device(const char* dev_name)
+{
+	int index;
+
+	if (!libinput_context) {
 		return false;
 	}
-	instance->libinput_device = libinput_device_ref(instance->libinput_device);
-	if(!instance->libinput_device) {
-		perror("unable to reference device within libinput context:");
+
+	libinput_drv_lock();
+
+	index = libinput_drv_find_device(dev_name);
+	if (index < 0) {
+		libinput_drv_unlock();
 		return false;
 	}
 
-	// Resets some props
-	instance->state = LV_INDEV_STATE_REL;
-	instance->key = 0;
-	instance->root_y = 0;
-	instance->root_x = 0;
+	LVGUI_LOG_INFO("[indev/libinput]: Removing '%s'...", dev_name);
+
+	libinput_path_remove_device(devices[index].device);
+	libinput_drv_forget_device(index);
+
+	libinput_drv_unlock();
 
 	return true;
 }
 
-libinput_drv_instance* libinput_init_drv(char* dev_name)
+uint32_t libinput_drv_get_device_count(libinput_drv_kind_t kind)
 {
-	LVGUI_LOG_INFO("[indev/libinput]: Initializing for '%s'...", dev_name);
+	uint32_t count = 0;
+	int i;
 
-	// Allocate the instance in memory
-	libinput_drv_instance* instance = libinput_drv_instance_new();
+	libinput_drv_lock();
+	for (i = 0; i < device_count; i++) {
+		if (devices[i].kinds & (1 << kind)) {
+			count++;
+		}
+	}
+	libinput_drv_unlock();
 
-	// Assign a fresh context
-	instance->libinput_context = libinput_path_create_context(&drv_libinput_interface, NULL);
+	return count;
+}
 
-	if(!libinput_set_file(instance, dev_name)) {
-		perror("Unable to add device to libinput context:");
-		libinput_drv_instance_destroy(instance);
-		return NULL;
+int libinput_drv_hotplug_init(void)
+{
+	if (hotplug_fd >= 0) {
+		return hotplug_fd;
 	}
 
-	// Add some metadata
-	instance->is_pointer = libinput_device_has_capability(instance->libinput_device, LIBINPUT_DEVICE_CAP_POINTER);
-	instance->is_touchscreen = libinput_device_has_capability(instance->libinput_device, LIBINPUT_DEVICE_CAP_TOUCH);
-	instance->is_keyboard = libinput_device_has_capability(instance->libinput_device, LIBINPUT_DEVICE_CAP_KEYBOARD);
+	// Created now, so its file descriptor can be polled before any device is plugged.
+	if (!libinput_drv_context_init()) {
+		return -1;
+	}
 
-	if (instance->is_keyboard) {
-		instance->lv_indev_drv_type |= LV_INDEV_TYPE_KEYBOARD;
+	hotplug_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if (hotplug_fd < 0) {
+		LVGUI_LOG_ERROR("[indev/libinput]: Unable to watch for new devices: %s", strerror(errno));
+		return -1;
 	}
-	if (instance->is_touchscreen || instance->is_pointer) {
-		instance->lv_indev_drv_type |= LV_INDEV_TYPE_POINTER;
+
+	if (inotify_add_watch(hotplug_fd, LIBINPUT_DRV_HOTPLUG_DIR, IN_CREATE | IN_ATTRIB | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) < 0) {
+		LVGUI_LOG_ERROR("[indev/libinput]: Unable to watch '%s': %s", LIBINPUT_DRV_HOTPLUG_DIR, strerror(errno));
+		close(hotplug_fd);
+		hotplug_fd = -1;
+		return -1;
 	}
 
-#if LV_LOG_LEVEL <= LV_LOG_LEVEL_INFO
-	LVGUI_LOG_INFO("");
-	LVGUI_LOG_INFO(
-		"> Device *%s* (`%s`):",
-		libinput_device_get_name(instance->libinput_device),
-		libinput_device_get_sysname(instance->libinput_device)
-	);
-	if (instance->is_pointer)     { LVGUI_LOG_INFO(">  - is a pointer"); }
-	if (instance->is_touchscreen) { LVGUI_LOG_INFO(">  - is a touchscreen"); }
-	if (instance->is_keyboard)    { LVGUI_LOG_INFO(">  - is a keyboard"); }
-	LVGUI_LOG_INFO("");
-#endif
+	return hotplug_fd;
+}
 
-	// Prepare file descriptors for polling
-	instance->fds[0].fd = libinput_get_fd(instance->libinput_context);
-	instance->fds[0].events = POLLIN;
-	instance->fds[0].revents = 0;
+int libinput_drv_get_hotplug_fd(void)
+{
+	return hotplug_fd;
+}
 
-	fcntl(instance->fds[0].fd, F_SETFL, O_ASYNC | O_NONBLOCK);
+bool libinput_drv_hotplug_dispatch(void)
+{
+	char buf[1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+	char path[sizeof(LIBINPUT_DRV_HOTPLUG_DIR) + NAME_MAX + 1];
+	const struct inotify_event *event;
+	bool changed = false;
+	bool added;
+	ssize_t len;
+	char *p;
 
-	LVGUI_LOG_INFO("[indev/libinput]: done with '%s'...", dev_name);
+	if (hotplug_fd < 0) {
+		return false;
+	}
 
-	// Initialize xkbcommon
-	xkbcommon_init();
+	while ((len = read(hotplug_fd, buf, sizeof(buf))) > 0) {
+		for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *) p;
 
-	return instance;
+			// libinput only handles the event devices.
+			if (!event->len || strncmp(event->name, "event", strlen("event"))) {
+				continue;
+			}
+			snprintf(path, sizeof(path), "%s/%s", LIBINPUT_DRV_HOTPLUG_DIR, event->name);
+
+			if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+				changed |= libinput_drv_remove_device(path);
+				continue;
+			}
+
+			libinput_drv_lock();
+			added = libinput_drv_find_device(path) >= 0;
+			libinput_drv_unlock();
+
+			// Nodes are created before their permissions are set, so this
+			// is retried once their attributes change.
+			if (!added) {
+				changed |= libinput_drv_add_device(path);
+			}
+		}
+	}
+
+	return changed;
+}
+
+libinput_drv_instance* libinput_drv_get_instance(libinput_drv_kind_t kind)
+{
+	return instances[kind];
+}
+
+int libinput_drv_get_fd(void)
+{
+	if (!libinput_context) {
+		return -1;
+	}
+
+#if LIBINPUT_DRV_READER_THREAD
+	if (reader_fd >= 0) {
+		return reader_fd;
+	}
+#endif
+
+	return libinput_get_fd(libinput_context);
 }
 
 /**
@@ -191,93 +415,186 @@ libinput_drv_instance* libinput_init_drv(char* dev_name)
  * @param data store the libinput data here
  */
 bool libinput_read(lv_indev_drv_t * drv, lv_indev_data_t * data)
+{
+	libinput_drv_instance* instance = drv->user_data;
+
+	// (maybe) empty the event queue, for every instance.
+	libinput_drv_dispatch();
+
+	// Events are read one at a time, so none are lost.
+	if (instance->events_count) {
+		instance->last = instance->events[instance->events_head];
+		instance->events_head = (instance->events_head + 1) % LIBINPUT_DRV_EVENT_QUEUE;
+		instance->events_count--;
+		*data = instance->last.data;
+		data->time_usec = instance->last.time_usec;
+
+		LVGUI_LOG_INFO(
+			"[indev/libinput]: (instance: 0x%p) lvgl input data: x = %4d; y = %4d; state = %4d; key = %3d; // %s",
+			instance,
+			data->point.x,
+			data->point.y,
+			data->state,
+			data->key,
+			instance_names[instance->kind]
+		);
+
+		return instance->events_count > 0;
+	}
+
+	// A key is only pressed or released once.
+	if (instance->kind == LIBINPUT_DRV_KEYBOARD) {
+		return false;
+	}
+
+	// Pointers stay where they are, so long presses are noticed.
+	*data = instance->last.data;
+
+	// False because there are no events to handle anymore
+	return false;
+}
+
+/**
+ * Sets the orientation of the panel, so direct input devices are rotated along the display.
+ */
+void libinput_drv_set_orientation(libinput_drv_orientation_t new_orientation)
+{
+	orientation = new_orientation;
+}
+
+/**
+ * Hands the pending events of all the devices to the instances.
+ */
+void libinput_drv_dispatch(void)
+{
+#if LIBINPUT_DRV_READER_THREAD
+	uint64_t count;
+
+	if (reader_fd >= 0) {
+		// Cleared first, events queued meanwhile signal it again.
+		if (read(reader_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+			LVGUI_LOG_ERROR("[indev/libinput]: Unable to read the reader thread eventfd: %s", strerror(errno));
+		}
+		libinput_drv_drain();
+		return;
+	}
+#endif
+
+	libinput_drv_read_events();
+	libinput_drv_drain();
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static uint32_t libinput_drv_read_events(void)
 {
 	struct libinput_event *event = NULL;
 
 	struct libinput_event_pointer *pointer_event = NULL;
 	struct libinput_event_touch *touch_event = NULL;
 	uint32_t in_button = 0;
+	lv_indev_data_t key_data;
+	uint32_t count = 0;
+	int i;
 
-	bool changed = false;
+	libinput_drv_instance* instance;
+	libinput_drv_instance* touchscreen = instances[LIBINPUT_DRV_TOUCHSCREEN];
+	libinput_drv_instance* pointer = instances[LIBINPUT_DRV_POINTER];
+	libinput_drv_instance* keyboard = instances[LIBINPUT_DRV_KEYBOARD];
 
-	libinput_drv_instance* instance = drv->user_data;
+	if (!libinput_context) {
+		return 0;
+	}
 
-	libinput_dispatch(instance->libinput_context);
-	// (maybe) empty the event queue
-	// Keyboard events will cause the function to exit.
-	while((event = libinput_get_event(instance->libinput_context)) != NULL) {
+	libinput_dispatch(libinput_context);
+	while((event = libinput_get_event(libinput_context)) != NULL) {
 		enum libinput_event_type type = libinput_event_get_type(event);
-		changed = true;
-		data->event_type = LV_INDEV_TYPE_POINTER;
 
 		// -> https://github.com/wayland-project/libinput/blob/f2baea50c01f9e10fb2076f5dd64311347ac5c3e/src/libinput.h#L716-L904
 		switch (type) {
 			case LIBINPUT_EVENT_TOUCH_MOTION:
 			case LIBINPUT_EVENT_TOUCH_DOWN:
+				if (!touchscreen) break;
 				touch_event = libinput_event_get_touch_event(event);
-				switch (drm_display_orientation) {
-					case DRM_ORIENTATION_NORMAL:
-						instance->root_x = libinput_event_touch_get_x_transformed(touch_event, LV_HOR_RES);
-						instance->root_y = libinput_event_touch_get_y_transformed(touch_event, LV_VER_RES);
+				switch (orientation) {
+					case LIBINPUT_DRV_ORIENTATION_NORMAL:
+						touchscreen->root_x = libinput_event_touch_get_x_transformed(touch_event, LV_HOR_RES);
+						touchscreen->root_y = libinput_event_touch_get_y_transformed(touch_event, LV_VER_RES);
 						break;
-					case DRM_ORIENTATION_UPSIDE_DOWN:
-						instance->root_x = LV_HOR_RES - libinput_event_touch_get_x_transformed(touch_event, LV_HOR_RES);
-						instance->root_y = LV_VER_RES - libinput_event_touch_get_y_transformed(touch_event, LV_VER_RES);
+					case LIBINPUT_DRV_ORIENTATION_UPSIDE_DOWN:
+						touchscreen->root_x = LV_HOR_RES - libinput_event_touch_get_x_transformed(touch_event, LV_HOR_RES);
+						touchscreen->root_y = LV_VER_RES - libinput_event_touch_get_y_transformed(touch_event, LV_VER_RES);
 						break;
-					case DRM_ORIENTATION_CLOCKWISE:
-						instance->root_y = LV_VER_RES - libinput_event_touch_get_x_transformed(touch_event, LV_VER_RES);
-						instance->root_x = libinput_event_touch_get_y_transformed(touch_event, LV_HOR_RES);
+					case LIBINPUT_DRV_ORIENTATION_CLOCKWISE:
+						touchscreen->root_y = LV_VER_RES - libinput_event_touch_get_x_transformed(touch_event, LV_VER_RES);
+						touchscreen->root_x = libinput_event_touch_get_y_transformed(touch_event, LV_HOR_RES);
 						break;
-					case DRM_ORIENTATION_COUNTER_CLOCKWISE:
-						instance->root_y = libinput_event_touch_get_x_transformed(touch_event, LV_VER_RES);
-						instance->root_x = LV_HOR_RES - libinput_event_touch_get_y_transformed(touch_event, LV_HOR_RES);
+					case LIBINPUT_DRV_ORIENTATION_COUNTER_CLOCKWISE:
+						touchscreen->root_y = libinput_event_touch_get_x_transformed(touch_event, LV_VER_RES);
+						touchscreen->root_x = LV_HOR_RES - libinput_event_touch_get_y_transformed(touch_event, LV_HOR_RES);
 						break;
 				}
-				instance->state = LV_INDEV_STATE_PR;
+				touchscreen->state = LV_INDEV_STATE_PR;
+				libinput_drv_push_pointer(touchscreen, libinput_event_touch_get_time_usec(touch_event));
+				count++;
 				break;
 
 			case LIBINPUT_EVENT_TOUCH_UP:
-				instance->state = LV_INDEV_STATE_REL;
+				if (!touchscreen) break;
+				touch_event = libinput_event_get_touch_event(event);
+				touchscreen->state = LV_INDEV_STATE_REL;
+				libinput_drv_push_pointer(touchscreen, libinput_event_touch_get_time_usec(touch_event));
+				count++;
 				break;
 
 			// Stylus hovering, or "drawing tablet", like QEMU
 			case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+				if (!pointer) break;
 				pointer_event = libinput_event_get_pointer_event(event);
-				switch (drm_display_orientation) {
-					case DRM_ORIENTATION_NORMAL:
-						instance->root_x = libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_HOR_RES);
-						instance->root_y = libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_VER_RES);
+				switch (orientation) {
+					case LIBINPUT_DRV_ORIENTATION_NORMAL:
+						pointer->root_x = libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_HOR_RES);
+						pointer->root_y = libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_VER_RES);
 						break;
-					case DRM_ORIENTATION_UPSIDE_DOWN:
-						instance->root_x = LV_HOR_RES - libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_HOR_RES);
-						instance->root_y = LV_VER_RES - libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_VER_RES);
+					case LIBINPUT_DRV_ORIENTATION_UPSIDE_DOWN:
+						pointer->root_x = LV_HOR_RES - libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_HOR_RES);
+						pointer->root_y = LV_VER_RES - libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_VER_RES);
 						break;
-					case DRM_ORIENTATION_CLOCKWISE:
-						instance->root_y = LV_VER_RES - libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_VER_RES);
-						instance->root_x = libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_HOR_RES);
+					case LIBINPUT_DRV_ORIENTATION_CLOCKWISE:
+						pointer->root_y = LV_VER_RES - libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_VER_RES);
+						pointer->root_x = libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_HOR_RES);
 						break;
-					case DRM_ORIENTATION_COUNTER_CLOCKWISE:
-						instance->root_y = libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_VER_RES);
-						instance->root_x = LV_HOR_RES - libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_HOR_RES);
+					case LIBINPUT_DRV_ORIENTATION_COUNTER_CLOCKWISE:
+						pointer->root_y = libinput_event_pointer_get_absolute_x_transformed(pointer_event, LV_VER_RES);
+						pointer->root_x = LV_HOR_RES - libinput_event_pointer_get_absolute_y_transformed(pointer_event, LV_HOR_RES);
 						break;
 				}
+				libinput_drv_push_pointer(pointer, libinput_event_pointer_get_time_usec(pointer_event));
+				count++;
 				break;
 
 			case LIBINPUT_EVENT_POINTER_MOTION:
+				if (!pointer) break;
 				pointer_event = libinput_event_get_pointer_event(event);
-				instance->root_x += libinput_event_pointer_get_dx(pointer_event);
-				instance->root_y += libinput_event_pointer_get_dy(pointer_event);
+				pointer->root_x += libinput_event_pointer_get_dx(pointer_event);
+				pointer->root_y += libinput_event_pointer_get_dy(pointer_event);
+				libinput_drv_push_pointer(pointer, libinput_event_pointer_get_time_usec(pointer_event));
+				count++;
 
 				LVGUI_LOG_INFO(
 					"[indev/libinput]: Relative move: dx = %f, dy = %f, x = %f, y = %f;",
 					libinput_event_pointer_get_dx(pointer_event),
 					libinput_event_pointer_get_dy(pointer_event),
-					instance->root_x,
-					instance->root_y
+					pointer->root_x,
+					pointer->root_y
 				);
 				break;
 
 			case LIBINPUT_EVENT_POINTER_BUTTON:
+				if (!pointer) break;
 				pointer_event = libinput_event_get_pointer_event(event);
 				in_button = libinput_event_pointer_get_button(pointer_event);
 				LVGUI_LOG_INFO(
@@ -286,26 +603,40 @@ bool libinput_read(lv_indev_drv_t * drv, lv_indev_data_t * data)
 				);
 				if (in_button == BTN_LEFT) {
 					if (libinput_event_pointer_get_button_state(pointer_event) == LIBINPUT_BUTTON_STATE_PRESSED) {
-						instance->state = LV_INDEV_STATE_PR;
+						pointer->state = LV_INDEV_STATE_PR;
 					}
 					else {
-						instance->state = LV_INDEV_STATE_REL;
+						pointer->state = LV_INDEV_STATE_REL;
 					}
 				}
+				libinput_drv_push_pointer(pointer, libinput_event_pointer_get_time_usec(pointer_event));
+				count++;
 				break;
 
 			case LIBINPUT_EVENT_KEYBOARD_KEY:
-				if (instance->lv_indev_drv_type & LV_INDEV_TYPE_KEYBOARD) {
-					libinput_drv_handle_keyboard_input(instance, event, data);
+				instance = keyboard;
+				if (!instance) break;
+				// Keys go through xkb in order, as its state depends on the previous ones.
+				libinput_drv_handle_keyboard_input(instance, event, &key_data);
+				libinput_drv_push(
+					instance,
+					&key_data,
+					libinput_event_keyboard_get_time_usec(libinput_event_get_keyboard_event(event))
+				);
+				count++;
+				break;
 
-					// Whatever happens, we have to send the current key event.
-					// Otherwise multiple events in the queue will be lost.
-					return true;
+			case LIBINPUT_EVENT_DEVICE_REMOVED:
+				// Unplugged before its node was seen removed, libinput dropped it already.
+				for (i = 0; i < device_count; i++) {
+					if (devices[i].device == libinput_event_get_device(event)) {
+						count += libinput_drv_forget_device(i);
+						break;
+					}
 				}
 				break;
 
 			case LIBINPUT_EVENT_DEVICE_ADDED:
-			case LIBINPUT_EVENT_DEVICE_REMOVED:
 			case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
 			case LIBINPUT_EVENT_GESTURE_PINCH_END:
 			case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
@@ -348,50 +679,256 @@ bool libinput_read(lv_indev_drv_t * drv, lv_indev_data_t * data)
 		libinput_event_destroy(event);
 	}
 
-	if (changed) {
-		data->state = instance->state;
-		data->key = instance->key;
-		data->point.x = instance->root_x;
-		data->point.y = instance->root_y;
+	return count;
+}
+
+/**
+ * Queues the current state of a pointer.
+ */
+static void libinput_drv_push_pointer(libinput_drv_instance* instance, uint64_t time_usec)
+{
+	lv_indev_data_t data;
 
-		// Clamp values, mostly useful for relative moves.
-		if(data->point.x < 0) {
-			data->point.x = 0;
-			instance->root_x = 0;
-		}
-		if(data->point.y < 0) {
-			data->point.y = 0;
-			instance->root_y = 0;
+	// Clamp values, mostly useful for relative moves.
+	if (instance->root_x < 0) {
+		instance->root_x = 0;
+	}
+	if (instance->root_y < 0) {
+		instance->root_y = 0;
+	}
+	if (instance->root_x >= LV_HOR_RES) {
+		instance->root_x = LV_HOR_RES - 1;
+	}
+	if (instance->root_y >= LV_VER_RES) {
+		instance->root_y = LV_VER_RES - 1;
+	}
+
+	memset(&data, 0, sizeof(data));
+	data.event_type = LV_INDEV_TYPE_POINTER;
+	data.state = instance->state;
+	data.key = instance->key;
+	data.point.x = instance->root_x;
+	data.point.y = instance->root_y;
+
+	libinput_drv_push(instance, &data, time_usec);
+}
+
+/**
+ * Queues an event for the read task of the instance.
+ * Only called by whoever reads the devices: the reader thread, or the read tasks.
+ */
+static void libinput_drv_push(libinput_drv_instance* instance, const lv_indev_data_t * data, uint64_t time_usec)
+{
+	struct libinput_drv_ring_entry *entry;
+	uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+	uint32_t tail = ring_tail;
+
+	if (tail - head == LIBINPUT_DRV_RING_SIZE) {
+		LVGUI_LOG_WARN("[indev/libinput]: Event dropped, %d not read yet.", LIBINPUT_DRV_RING_SIZE);
+		return;
+	}
+
+	entry = &ring[tail % LIBINPUT_DRV_RING_SIZE];
+	entry->kind = instance->kind;
+	entry->event.data = *data;
+	entry->event.time_usec = time_usec;
+
+	// Pairs with the acquire in `libinput_drv_drain`.
+	__atomic_store_n(&ring_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void libinput_drv_drain(void)
+{
+	uint32_t head = ring_head;
+	uint32_t tail = __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++) {
+		struct libinput_drv_ring_entry *entry = &ring[head % LIBINPUT_DRV_RING_SIZE];
+		libinput_drv_queue(instances[entry->kind], &entry->event);
+	}
+
+	// Pairs with the acquire in `libinput_drv_push`; the entries can be reused.
+	__atomic_store_n(&ring_head, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * Queues an event until the read task of the instance reads it.
+ */
+static void libinput_drv_queue(libinput_drv_instance* instance, const libinput_drv_event_t * event)
+{
+	libinput_drv_event_t *tail;
+	lv_indev_state_t before;
+
+	if (instance->events_count && instance->kind != LIBINPUT_DRV_KEYBOARD) {
+		tail = &instance->events[(instance->events_head + instance->events_count - 1) % LIBINPUT_DRV_EVENT_QUEUE];
+		before = instance->events_count > 1 ?
+			instance->events[(instance->events_head + instance->events_count - 2) % LIBINPUT_DRV_EVENT_QUEUE].data.state :
+			instance->last.data.state;
+
+		// Only the latest position of a move matters, presses and releases are all kept.
+		if (tail->data.state == event->data.state && before == tail->data.state) {
+			*tail = *event;
+			return;
 		}
+	}
+
+	if (instance->events_count == LIBINPUT_DRV_EVENT_QUEUE) {
+		LVGUI_LOG_WARN("[indev/libinput]: %s event dropped, %d not read yet.", instance_names[instance->kind], LIBINPUT_DRV_EVENT_QUEUE);
+		return;
+	}
+
+	instance->events[(instance->events_head + instance->events_count) % LIBINPUT_DRV_EVENT_QUEUE] = *event;
+	instance->events_count++;
+}
+
+#if LIBINPUT_DRV_READER_THREAD
+static bool libinput_drv_reader_start(void)
+{
+	int ret;
+
+	reader_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (reader_fd < 0) {
+		LVGUI_LOG_ERROR("[indev/libinput]: Unable to create the eventfd of the reader thread: %s", strerror(errno));
+		return false;
+	}
+
+	ret = pthread_create(&reader_thread, NULL, libinput_drv_reader, NULL);
+	if (ret) {
+		LVGUI_LOG_ERROR("[indev/libinput]: Unable to start the reader thread: %s", strerror(ret));
+		close(reader_fd);
+		reader_fd = -1;
+		return false;
+	}
+
+	LVGUI_LOG_INFO("[indev/libinput]: Reading the devices from a separate thread.");
 
-		if(data->point.x >= lv_disp_get_hor_res(drv->disp)) {
-			data->point.x = lv_disp_get_hor_res(drv->disp) - 1;
-			instance->root_x = lv_disp_get_hor_res(drv->disp) - 1;
+	return true;
+}
+
+/**
+ * Reads the devices as soon as they have events, whatever LVGL is busy with.
+ */
+static void * libinput_drv_reader(void * data)
+{
+	struct pollfd pfd = {
+		.fd = libinput_get_fd(libinput_context),
+		.events = POLLIN,
+	};
+	uint64_t one = 1;
+	uint32_t count;
+
+	(void) data;
+
+	for (;;) {
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			LVGUI_LOG_ERROR("[indev/libinput]: Unable to wait for events: %s", strerror(errno));
+			return NULL;
 		}
-		if(data->point.y >= lv_disp_get_ver_res(drv->disp)) {
-			data->point.y = lv_disp_get_ver_res(drv->disp) - 1;
-			instance->root_y = lv_disp_get_ver_res(drv->disp) - 1;
+
+		pthread_mutex_lock(&libinput_lock);
+		count = libinput_drv_read_events();
+		pthread_mutex_unlock(&libinput_lock);
+
+		// Wakes up a main loop waiting for input.
+		if (count && write(reader_fd, &one, sizeof(one)) < 0) {
+			LVGUI_LOG_ERROR("[indev/libinput]: Unable to signal events: %s", strerror(errno));
 		}
+	}
 
-		LVGUI_LOG_INFO(
-			"[indev/libinput]: (instance: 0x%p) lvgl input data: x = %4d; y = %4d; state = %4d; key = %3d; // %s",
-			instance,
-			data->point.x,
-			data->point.y,
-			data->state,
-			data->key,
-			libinput_device_get_name(instance->libinput_device)
-		);
+	return NULL;
+}
+#endif
+
+static bool libinput_drv_context_init(void)
+{
+	if (libinput_context) {
+		return true;
 	}
 
-	// False because there are no events to handle anymore
-	return false;
+	libinput_context = libinput_path_create_context(&drv_libinput_interface, NULL);
+	if (!libinput_context) {
+		LVGUI_LOG_ERROR("[indev/libinput]: Unable to create the libinput context.");
+		return false;
+	}
+	fcntl(libinput_get_fd(libinput_context), F_SETFL, O_ASYNC | O_NONBLOCK);
+
+#if LIBINPUT_DRV_READER_THREAD
+	if (!libinput_drv_reader_start()) {
+		LVGUI_LOG_WARN("[indev/libinput]: Reading the devices from the read tasks instead.");
+	}
+#endif
+
+	return true;
 }
 
+static void libinput_drv_lock(void)
+{
+#if LIBINPUT_DRV_READER_THREAD
+	pthread_mutex_lock(&libinput_lock);
+#endif
+}
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
+static void libinput_drv_unlock(void)
+{
+#if LIBINPUT_DRV_READER_THREAD
+	pthread_mutex_unlock(&libinput_lock);
+#endif
+}
+
+static int libinput_drv_find_device(const char* dev_name)
+{
+	int i;
+
+	for (i = 0; i < device_count; i++) {
+		if (!strcmp(devices[i].path, dev_name)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static uint32_t libinput_drv_forget_device(int index)
+{
+	libinput_drv_instance* instance;
+	libinput_drv_kind_t kind;
+	struct timespec now;
+	uint8_t kinds = devices[index].kinds;
+	uint32_t count = 0;
+	int i;
+
+	LVGUI_LOG_INFO("[indev/libinput]: '%s' removed.", devices[index].path);
+
+	libinput_device_unref(devices[index].device);
+	free(devices[index].path);
+	devices[index] = devices[--device_count];
+
+	// Kinds no other device sends events to.
+	for (i = 0; i < device_count; i++) {
+		kinds &= ~devices[i].kinds;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	for (kind = 0; kind < LIBINPUT_DRV_KIND_COUNT; kind++) {
+		instance = instances[kind];
+		if (!(kinds & (1 << kind)) || !instance || instance->state == LV_INDEV_STATE_REL) {
+			continue;
+		}
+
+		// Nothing will release what it was pressing anymore.
+		instance->state = LV_INDEV_STATE_REL;
+		if (kind != LIBINPUT_DRV_KEYBOARD) {
+			libinput_drv_push_pointer(instance, (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+			count++;
+		}
+	}
+
+	return count;
+}
 
 static int open_restricted(const char *path, int flags, void *user_data)
 {
@@ -404,17 +941,35 @@ static void close_restricted(int fd, void *user_data)
 	close(fd);
 }
 
-static libinput_drv_instance* libinput_drv_instance_new()
+static libinput_drv_instance* libinput_drv_instance_new(libinput_drv_kind_t kind)
 {
 	libinput_drv_instance* instance = (libinput_drv_instance*) malloc(sizeof (libinput_drv_instance));
 	memset(instance, 0, sizeof(libinput_drv_instance));
 
-	return instance;
-}
+	instance->kind = kind;
+	instance->state = LV_INDEV_STATE_REL;
+	instance->last.data.state = LV_INDEV_STATE_REL;
 
-static void libinput_drv_instance_destroy(libinput_drv_instance* instance)
-{
-	free(instance);
+	switch (kind) {
+		case LIBINPUT_DRV_TOUCHSCREEN:
+			instance->is_touchscreen = true;
+			instance->lv_indev_drv_type = LV_INDEV_TYPE_POINTER;
+			instance->last.data.event_type = LV_INDEV_TYPE_POINTER;
+			break;
+		case LIBINPUT_DRV_POINTER:
+			instance->is_pointer = true;
+			instance->lv_indev_drv_type = LV_INDEV_TYPE_POINTER;
+			instance->last.data.event_type = LV_INDEV_TYPE_POINTER;
+			break;
+		case LIBINPUT_DRV_KEYBOARD:
+			instance->is_keyboard = true;
+			instance->lv_indev_drv_type = LV_INDEV_TYPE_KEYBOARD;
+			break;
+		case LIBINPUT_DRV_KIND_COUNT:
+			break;
+	}
+
+	return instance;
 }
 
 static void libinput_drv_handle_keyboard_input(libinput_drv_instance* instance, struct libinput_event* event, lv_indev_data_t * data)
@@ -423,6 +978,7 @@ static void libinput_drv_handle_keyboard_input(libinput_drv_instance* instance,
 	instance->key = libinput_event_keyboard_get_key(keyboard_event);
 	instance->state = libinput_event_keyboard_get_key_state(keyboard_event) == LIBINPUT_KEY_STATE_PRESSED;
 
+	memset(data, 0, sizeof(lv_indev_data_t));
 	data->event_type = LV_INDEV_TYPE_KEYBOARD;
 
 	// Ensure special keys handling don't shadow following events
@@ -509,11 +1065,8 @@ static void libinput_drv_handle_keyboard_input(libinput_drv_instance* instance,
 		"[indev/libinput]: lvgl input data (keyboard): state = %4d; key = %3d; // %s",
 		data->state,
 		data->key,
-		libinput_device_get_name(instance->libinput_device)
+		libinput_device_get_name(libinput_event_get_device(event))
 	);
-
-	// Don't forget to cleanup!
-	libinput_event_destroy(event);
 }
 
 static int xkbcommon_init() {
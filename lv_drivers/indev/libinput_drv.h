@@ -31,20 +31,56 @@ extern "C" {
  *      DEFINES
  *********************/
 
+// Events kept per input device between two reads by LVGL.
+#ifndef LIBINPUT_DRV_EVENT_QUEUE
+#define LIBINPUT_DRV_EVENT_QUEUE 32
+#endif
+
+// Devices followed at once, across all kinds.
+#ifndef LIBINPUT_DRV_DEVICES_MAX
+#define LIBINPUT_DRV_DEVICES_MAX 32
+#endif
+
+// Directory watched for devices being plugged and unplugged.
+#ifndef LIBINPUT_DRV_HOTPLUG_DIR
+#define LIBINPUT_DRV_HOTPLUG_DIR "/dev/input"
+#endif
+
+// Read the devices from a thread of their own, as soon as events arrive,
+// rather than from the read tasks of LVGL.
+#ifndef LIBINPUT_DRV_READER_THREAD
+#define LIBINPUT_DRV_READER_THREAD 0
+#endif
+
+// Logical input devices the events of all devices are demultiplexed to.
+typedef enum {
+	LIBINPUT_DRV_TOUCHSCREEN,
+	LIBINPUT_DRV_POINTER,
+	LIBINPUT_DRV_KEYBOARD,
+	LIBINPUT_DRV_KIND_COUNT,
+} libinput_drv_kind_t;
+
+// How the panel direct input devices (touchscreens, tablets) cover is mounted,
+// as told by the display driver.
+typedef enum {
+	LIBINPUT_DRV_ORIENTATION_NORMAL,
+	LIBINPUT_DRV_ORIENTATION_UPSIDE_DOWN,
+	LIBINPUT_DRV_ORIENTATION_CLOCKWISE,
+	LIBINPUT_DRV_ORIENTATION_COUNTER_CLOCKWISE,
+} libinput_drv_orientation_t;
+
+typedef struct {
+	lv_indev_data_t data;
+	// When the event happened, in microseconds on the CLOCK_MONOTONIC clock.
+	uint64_t time_usec;
+} libinput_drv_event_t;
+
 typedef struct {
 	// Configure this input driver to be a specific LVGL input type.
 	int lv_indev_drv_type;
 
-	// One context per input device.
-	// This is because LVGL's input handling wants to *own* one loop per
-	// device; sharing context means sharing input FDs.
-	struct libinput *libinput_context;
-
-	// The "tangible" libinput opaque type.
-	struct libinput_device *libinput_device;
-
-	// The file descriptors to poll() on
-	struct pollfd fds[1];
+	// Which events this instance gets.
+	libinput_drv_kind_t kind;
 
 	// Properties of the input, shouldn't change.
 	bool is_pointer;
@@ -52,7 +88,7 @@ typedef struct {
 	bool is_keyboard;
 
 	// Starting from here, properties used to keep track of the state between
-	// calls.
+	// events; only used by whoever reads the devices.
 
 	// Pressed or released
 	int state;
@@ -61,6 +97,15 @@ typedef struct {
 	// Coordinates for a pointer
 	double root_x;
 	double root_y;
+
+	// Starting from here, properties used by the read task of LVGL.
+
+	// Events not read yet, as a ring. Moves between two presses or releases are merged.
+	libinput_drv_event_t events[LIBINPUT_DRV_EVENT_QUEUE];
+	uint32_t events_head;
+	uint32_t events_count;
+	// The event read last. Pointers keep reporting it until the next one.
+	libinput_drv_event_t last;
 } libinput_drv_instance;
 
 /**********************
@@ -72,13 +117,78 @@ typedef struct {
  **********************/
 
 /**
- * Initialize a new libinput device instance
+ * Adds a device to the libinput context shared by all devices.
+ * The first device of a kind creates the instance its events go to; the
+ * xkb keymap is compiled along the first keyboard.
+ * @param dev_name path of the device node, e.g. `/dev/input/event0`
+ * @return false if the device cannot be used
+ */
+bool libinput_drv_add_device(char* dev_name);
+
+/**
+ * Removes a device added with `libinput_drv_add_device`.
+ * Once the last device of a kind is gone, a pressed pointer is released.
+ * @param dev_name path the device was added with
+ * @return false if no such device was added
+ */
+bool libinput_drv_remove_device(const char* dev_name);
+
+/**
+ * Gets how many devices send their events to the instance of a kind.
+ */
+uint32_t libinput_drv_get_device_count(libinput_drv_kind_t kind);
+
+/**
+ * Watches `LIBINPUT_DRV_HOTPLUG_DIR` for devices being plugged and unplugged.
+ * Call it before adding the devices already there, so none is missed.
+ * @return the file descriptor to poll, or -1 on failure
+ */
+int libinput_drv_hotplug_init(void);
+
+/**
+ * Gets the file descriptor from `libinput_drv_hotplug_init`.
+ * @return the file descriptor, or -1 if devices are not watched
+ */
+int libinput_drv_get_hotplug_fd(void);
+
+/**
+ * Adds and removes the devices plugged and unplugged since the last call.
+ * Cheap when nothing changed; a main loop may call it whenever it wakes up.
+ * New kinds of devices get an instance, see `libinput_drv_get_instance`.
+ * @return true if devices were added or removed
+ */
+bool libinput_drv_hotplug_dispatch(void);
+
+/**
+ * Gets the instance the events of a kind of devices go to.
+ * @return NULL if no device of that kind was added
+ */
+libinput_drv_instance* libinput_drv_get_instance(libinput_drv_kind_t kind);
+
+/**
+ * Gets the file descriptor of the libinput context shared by all devices,
+ * or with `LIBINPUT_DRV_READER_THREAD`, an eventfd signaled by the reader thread.
+ * Once it's readable, the read tasks of the input devices have events to read.
+ * @return the file descriptor, or -1 if no device was added and devices are not watched
+ */
+int libinput_drv_get_fd(void);
+
+/**
+ * Hands the pending events of all the devices to the instances.
+ * Done by `libinput_read`; a main loop may also call it once the file
+ * descriptor is readable, so it's emptied even when no input device reads.
+ */
+void libinput_drv_dispatch(void);
+
+/**
+ * Sets the orientation of the panel, so direct input devices are rotated along the display.
+ * Call it before adding devices, once the display driver knows the orientation.
  */
-libinput_drv_instance* libinput_init_drv(char* dev_name);
+void libinput_drv_set_orientation(libinput_drv_orientation_t orientation);
 
 /**
  * Get the current position and state of the libinput
- * @param indev_drv driver object itself
+ * @param indev_drv driver object itself, with the instance as `user_data`
  * @param data store the libinput data here
  */
 bool libinput_read(lv_indev_drv_t * indev_drv, lv_indev_data_t * data);
@@ -9,7 +9,15 @@
 
 #if 1 /*Set it to "1" to enable the content*/
 
-#if LVGL_ENV_SIMULATOR
+#if defined(LVGL_ENV_HEADLESS) && LVGL_ENV_HEADLESS
+
+#define USE_HEADLESS 1
+
+#define USE_DRM 0
+#define USE_FBDEV 0
+#define USE_LIBINPUT 0
+
+#elif LVGL_ENV_SIMULATOR
 
 #define USE_MONITOR 1
 #define USE_MOUSE 1
@@ -40,6 +48,26 @@
 #define LV_DRV_DELAY_US(us)  /*delay_us(us)*/       /*Delay the given number of microseconds*/
 #define LV_DRV_DELAY_MS(ms)  /*delay_ms(ms)*/       /*Delay the given number of milliseconds*/
 
+/*********************
+ * DRAW BUFFER
+ *********************/
+
+/* How much of the screen the draw buffer holds (allocated for the actual resolution):
+ *  - DISP_BUF_POLICY_FULL: the whole screen
+ *  - DISP_BUF_POLICY_LINES: `DISP_BUF_LINES` lines
+ *  - DISP_BUF_POLICY_FRACTION: 1/`DISP_BUF_FRACTION` of the screen
+ * Smaller buffers are redrawn in more parts. */
+#define DISP_BUF_POLICY_FULL     0
+#define DISP_BUF_POLICY_LINES    1
+#define DISP_BUF_POLICY_FRACTION 2
+
+#define DISP_BUF_POLICY     DISP_BUF_POLICY_FULL
+#define DISP_BUF_LINES      128
+#define DISP_BUF_FRACTION   4
+
+/* Back the draw buffer with huge pages (reserved or transparent) when available */
+#define DISP_BUF_HUGEPAGES  1
+
 /*********************
  * DISPLAY INTERFACE
  *********************/
@@ -209,6 +237,32 @@ extern int monitor_height;
 
 #if USE_FBDEV || USE_DRM
 #  define FBDEV_PATH          "/dev/fb0"
+/* Flush from a separate thread while the next part is rendered.
+ * (The draw buffer is then split in two.) */
+#  define DISP_ASYNC_FLUSH    1
+/* Draw into the hidden half of a virtual screen twice as high, and pan to it (fbdev only) */
+#  define FBDEV_DOUBLE_BUFFER 1
+/* Wait for the vertical blank after panning, to not draw into the page being scanned out */
+#  define FBDEV_WAIT_VSYNC    1
+/* Dither when the framebuffer has fewer bits per component than LVGL renders with (fbdev only) */
+#  define FBDEV_DITHER        0
+#endif
+
+/*-----------------------------------------
+ *  In memory, without a display (for CI)
+ *-----------------------------------------*/
+#ifndef USE_HEADLESS
+#  define USE_HEADLESS        0
+#endif
+
+#if USE_HEADLESS
+/* Size and rotation (in degrees) of the emulated panel; see headless.h for the environment */
+extern int headless_width;
+extern int headless_height;
+extern int headless_rotation;
+
+/* Largest difference allowed on a component when comparing frames to golden images */
+#  define HEADLESS_GOLDEN_TOLERANCE 0
 #endif
 
 /*-----------------------------------------
@@ -219,7 +273,21 @@ extern int monitor_height;
 #endif
 
 #if USE_DRM
-/* Nothing to configure */
+/* Let LVGL render straight into the scanout buffers when the panel is not rotated */
+#  define DRM_ZERO_COPY       1
+/* Refresh the display when the previous frame reached the screen, instead of on a fixed period */
+#  define DRM_VBLANK_SYNC     1
+/* Only copy the parts of flushed areas which differ from the last frame, found by hashing them */
+#  define DRM_SKIP_UNCHANGED  1
+/* Render at a fraction of the panel's resolution, scaled up when flushing (e.g. 1 and 2 for half).
+ * Less pixels to render on slow CPUs driving large panels; `LVGUI_RENDER_SCALE` overrides it.
+ * The fraction of both dimensions must be whole, or the panel's resolution is used. */
+#  define DRM_RENDER_SCALE_NUM 1
+#  define DRM_RENDER_SCALE_DEN 1
+/* Drive every connected output as its own display, up to `DRM_MAX_OUTPUTS`; only the first one otherwise.
+ * Each output is flushed and waits on its page flips from its own thread with `DISP_ASYNC_FLUSH`. */
+#  define DRM_MULTI_OUTPUT 0
+#  define DRM_MAX_OUTPUTS 4
 #endif
 
 /*********************
@@ -303,6 +371,12 @@ extern int monitor_height;
 #  define USE_LIBINPUT           0
 #endif
 
+#if USE_LIBINPUT
+/* Read the devices from a thread of their own, so input is picked up and
+ * queued while LVGL is busy drawing. 0: read them from the read tasks.*/
+#  define LIBINPUT_DRV_READER_THREAD 1
+#endif
+
 /*-------------------------------
  *   Keyboard of a PC (using SDL)
  *------------------------------*/
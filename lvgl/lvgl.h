@@ -29,6 +29,7 @@ extern "C" {
 
 #include "src/lv_core/lv_refr.h"
 #include "src/lv_core/lv_disp.h"
+#include "src/lv_core/lv_latency.h"
 #include "src/lv_core/lv_debug.h"
 
 #include "src/lv_themes/lv_theme.h"
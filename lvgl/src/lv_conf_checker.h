@@ -38,6 +38,11 @@
 #define LV_COLOR_16_SWAP   0
 #endif
 
+/* 1: Apply an ordered dither to gradients with `LV_COLOR_DEPTH 16`. */
+#ifndef LV_DITHER_GRADIENT
+#define LV_DITHER_GRADIENT 0
+#endif
+
 /* 1: Enable screen transparency.
  * Useful for OSD or other overlapping GUIs.
  * Requires `LV_COLOR_DEPTH = 32` colors and the screen's style should be modified: `style.body.opa = ...`*/
@@ -170,6 +175,25 @@
 #define LV_INDEV_DEF_LONG_PRESS_REP_TIME  100
 #endif
 
+/* 1: Show the result of an input right away: the refresh doesn't wait
+ * for its period and runs before the other tasks. The input devices
+ * are also read again just before drawing.*/
+#ifndef LV_INDEV_FAST_REFR
+#define LV_INDEV_FAST_REFR                1
+#endif
+
+/* 1: Measure how long the result of inputs takes to be shown, from the
+ * timestamps of input drivers (see `lv_latency.h`). Uses `CLOCK_MONOTONIC`.*/
+#ifndef LV_USE_LATENCY
+#define LV_USE_LATENCY                    0
+#endif
+#if LV_USE_LATENCY
+/* Log a summary every this many inputs shown, at the info level. 0: never*/
+#ifndef LV_LATENCY_LOG_PERIOD
+#define LV_LATENCY_LOG_PERIOD             0
+#endif
+#endif /*LV_USE_LATENCY*/
+
 /*==================
  * Feature usage
  *==================*/
@@ -231,6 +255,22 @@
 #define LV_IMG_CACHE_DEF_SIZE       1
 #endif
 
+/*1: Keep the pixels of the last shown screens so loading them again
+ * only copies them back instead of drawing all of their objects.*/
+#ifndef LV_USE_SCR_CACHE
+#define LV_USE_SCR_CACHE            0
+#endif
+#if LV_USE_SCR_CACHE
+/*Number of screens to keep, including the active one of every display*/
+#ifndef LV_SCR_CACHE_MAX
+#define LV_SCR_CACHE_MAX            4
+#endif
+/*Memory used by the kept screens at most, in bytes; each takes a whole display of pixels*/
+#ifndef LV_SCR_CACHE_SIZE
+#define LV_SCR_CACHE_SIZE           (16 * 1024 * 1024)
+#endif
+#endif /*LV_USE_SCR_CACHE*/
+
 /*Declare the type of the user data of image decoder (can be e.g. `void *`, `int`, `struct`)*/
 
 /*=====================
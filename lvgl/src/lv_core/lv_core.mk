@@ -3,6 +3,8 @@ CSRCS += lv_indev.c
 CSRCS += lv_disp.c
 CSRCS += lv_obj.c
 CSRCS += lv_refr.c
+CSRCS += lv_scr_cache.c
+CSRCS += lv_latency.c
 CSRCS += lv_style.c
 CSRCS += lv_debug.c
 
@@ -7,6 +7,7 @@
  *      INCLUDES
  *********************/
 #include "lv_disp.h"
+#include "lv_scr_cache.h"
 #include "../lv_misc/lv_math.h"
 
 /*********************
@@ -57,9 +58,17 @@ lv_obj_t * lv_disp_get_scr_act(lv_disp_t * disp)
 void lv_disp_load_scr(lv_obj_t * scr)
 {
     lv_disp_t * d = lv_obj_get_disp(scr);
+    lv_obj_t * old_scr = d->act_scr;
 
     d->act_scr = scr;
 
+#if LV_USE_SCR_CACHE
+    /*Copy the screen back if it's cached instead of drawing it*/
+    if(lv_scr_cache_load(d, old_scr, scr)) return;
+#else
+    (void)old_scr; /*Unused*/
+#endif
+
     lv_obj_invalidate(scr);
 }
 
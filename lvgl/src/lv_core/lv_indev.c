@@ -13,6 +13,7 @@
 #include "../lv_hal/lv_hal_tick.h"
 #include "../lv_core/lv_group.h"
 #include "../lv_core/lv_refr.h"
+#include "../lv_core/lv_latency.h"
 #include "../lv_misc/lv_task.h"
 #include "../lv_misc/lv_math.h"
 
@@ -86,6 +87,9 @@ void lv_indev_read_task(lv_task_t * task)
 
     if(indev_act->proc.disabled) return;
     bool more_to_read;
+#if LV_INDEV_FAST_REFR
+    bool input = false;
+#endif
     do {
         /*Read the data*/
         more_to_read = lv_indev_read(indev_act, &data);
@@ -94,6 +98,19 @@ void lv_indev_read_task(lv_task_t * task)
         indev_proc_reset_query_handler(indev_act);
         indev_obj_act = NULL;
 
+#if LV_INDEV_FAST_REFR
+        /*Note whether anything happened, to show its result right away*/
+        if(data.state != indev_act->proc.state) {
+            input = true;
+        } else if(data.event_type == LV_INDEV_TYPE_POINTER &&
+                  (data.point.x != indev_act->proc.pointer.act_point.x ||
+                   data.point.y != indev_act->proc.pointer.act_point.y)) {
+            input = true;
+        } else if(data.event_type == LV_INDEV_TYPE_ENCODER && data.enc_diff) {
+            input = true;
+        }
+#endif
+
         indev_act->proc.state = data.state;
 
         /*Save the last activity time*/
@@ -115,10 +132,22 @@ void lv_indev_read_task(lv_task_t * task)
 		if(data.event_type == LV_INDEV_TYPE_BUTTON) {
             indev_button_proc(indev_act, &data);
         }
+
+#if LV_USE_LATENCY
+        /*Something is to be drawn, possibly because of this input*/
+        if(data.time_usec && indev_act->driver.disp->inv_p) {
+            lv_latency_input(indev_act->driver.disp, data.time_usec);
+        }
+#endif
         /*Handle reset query if it happened in during processing*/
         indev_proc_reset_query_handler(indev_act);
     } while(more_to_read);
 
+#if LV_INDEV_FAST_REFR
+    /*Once for all the data read, so the refresh is not repeated for every move*/
+    if(input) lv_refr_input(indev_act->driver.disp);
+#endif
+
     /*End of indev processing, so no act indev*/
     indev_act     = NULL;
     indev_obj_act = NULL;
@@ -126,6 +155,27 @@ void lv_indev_read_task(lv_task_t * task)
     LV_LOG_TRACE("indev read task finished");
 }
 
+/**
+ * Read the input devices of a display right away, out of their read task.
+ * Used before drawing the display, so it shows the latest input.
+ * @param disp pointer to a display
+ */
+void lv_indev_read_now(lv_disp_t * disp)
+{
+    /*Called while an input device is processed (e.g. `lv_refr_now` in an event)*/
+    if(indev_act) return;
+
+    lv_indev_t * indev = lv_indev_get_next(NULL);
+    while(indev) {
+        lv_task_t * task = indev->driver.read_task;
+        if(indev->driver.disp == disp && task && task->prio != LV_TASK_PRIO_OFF && !task->paused) {
+            lv_indev_read_task(task);
+            lv_task_reset(task); /*Just read, no need to read it again before its period*/
+        }
+        indev = lv_indev_get_next(indev);
+    }
+}
+
 /**
  * Get the currently processed input device. Can be used in action functions too.
  * @return pointer to the currently processed input device or NULL if no input device processing
@@ -40,6 +40,13 @@ void lv_indev_init(void);
  */
 void lv_indev_read_task(lv_task_t * task);
 
+/**
+ * Read the input devices of a display right away, out of their read task.
+ * Used before drawing the display, so it shows the latest input.
+ * @param disp pointer to a display
+ */
+void lv_indev_read_now(lv_disp_t * disp);
+
 /**
  * Get the currently processed input device. Can be used in action functions too.
  * @return pointer to the currently processed input device or NULL if no input device processing
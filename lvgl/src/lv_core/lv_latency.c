@@ -0,0 +1,202 @@
+/**
+ * @file lv_latency.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_latency.h"
+#if LV_USE_LATENCY
+
+#include <string.h>
+#include <time.h>
+#include "../lv_misc/lv_log.h"
+#include "../lv_misc/lv_printf.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void lv_latency_record(uint64_t event_time, uint64_t read_time, uint64_t drawn_time, uint64_t shown_time);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static lv_latency_stats_t stats;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Get the current time on the clock of input event timestamps (`CLOCK_MONOTONIC`).
+ * @return time in microseconds
+ */
+uint64_t lv_latency_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Note an input whose result is waiting to be drawn.
+ * Called by the input device read task for the data having a `time_usec`.
+ * @param disp pointer to the display of the input device
+ * @param event_time when the event happened [us]
+ */
+void lv_latency_input(lv_disp_t * disp, uint64_t event_time)
+{
+    if(disp == NULL || event_time == 0) return;
+
+    /*Of the inputs drawn by the same frame, the oldest one waited the longest*/
+    if(disp->lat_input_time != 0) return;
+
+    disp->lat_input_time = event_time;
+    disp->lat_input_read = lv_latency_now();
+}
+
+/**
+ * Note a frame was drawn and flushed.
+ * Called by the refresher.
+ * @param disp pointer to the display being refreshed
+ */
+void lv_latency_drawn(lv_disp_t * disp)
+{
+    if(disp->lat_input_time == 0) return;
+
+    uint64_t now = lv_latency_now();
+
+    if(disp->driver.present_report) {
+        /*Wait for the driver to tell when it's shown*/
+        disp->lat_frame_time  = disp->lat_input_time;
+        disp->lat_frame_read  = disp->lat_input_read;
+        disp->lat_frame_drawn = now;
+    } else {
+        /*Nothing better to go with than the end of the flush*/
+        lv_latency_record(disp->lat_input_time, disp->lat_input_read, now, now);
+    }
+
+    disp->lat_input_time = 0;
+}
+
+/**
+ * Note the last frame flushed reached the screen.
+ * Called by display drivers setting `present_report`, e.g. on page flip completion.
+ * @param disp pointer to a display
+ * @param time when the frame was shown [us]. 0: now
+ */
+void lv_latency_presented(lv_disp_t * disp, uint64_t time)
+{
+    if(disp == NULL || disp->lat_frame_time == 0) return;
+
+    if(time == 0) time = lv_latency_now();
+
+    lv_latency_record(disp->lat_frame_time, disp->lat_frame_read, disp->lat_frame_drawn, time);
+
+    disp->lat_frame_time = 0;
+}
+
+/**
+ * Get the latencies measured so far, on all the displays.
+ * @return pointer to the statistics
+ */
+const lv_latency_stats_t * lv_latency_get_stats(void)
+{
+    return &stats;
+}
+
+/**
+ * Get a percentile of the latencies measured so far.
+ * @param percent e.g. 50 for the median
+ * @return upper bound of the range of the histogram holding it [us], 0 if nothing was measured
+ */
+uint32_t lv_latency_get_percentile(uint32_t percent)
+{
+    if(stats.count == 0) return 0;
+
+    uint64_t sum = 0;
+    uint32_t i;
+    for(i = 0; i < LV_LATENCY_HIST_SIZE - 1; i++) {
+        sum += stats.hist[i];
+        if(sum * 100 >= (uint64_t)stats.count * percent) break;
+    }
+
+    /*The last range has no upper bound*/
+    if(i == LV_LATENCY_HIST_SIZE - 1) return stats.max;
+
+    return (i + 1) * LV_LATENCY_HIST_STEP;
+}
+
+/**
+ * Forget the latencies measured so far.
+ */
+void lv_latency_reset(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Add the latency of an input to the statistics.
+ * @param event_time when the event happened [us]
+ * @param read_time when it was read [us]
+ * @param drawn_time when the frame showing its result was drawn [us]
+ * @param shown_time when that frame was shown [us]
+ */
+static void lv_latency_record(uint64_t event_time, uint64_t read_time, uint64_t drawn_time, uint64_t shown_time)
+{
+    /*Timestamped on another clock by the input driver*/
+    if(event_time > read_time) {
+        LV_LOG_WARN("lv_latency: input events are not timestamped with CLOCK_MONOTONIC");
+        return;
+    }
+
+    /*Timestamps of the display driver can be a bit early (e.g. the start of the vblank)*/
+    if(shown_time < drawn_time) shown_time = drawn_time;
+
+    uint64_t total = shown_time - event_time;
+    uint64_t bucket = total / LV_LATENCY_HIST_STEP;
+    if(bucket >= LV_LATENCY_HIST_SIZE) bucket = LV_LATENCY_HIST_SIZE - 1;
+
+    stats.hist[bucket]++;
+    stats.count++;
+    if(total > stats.max) stats.max = total > UINT32_MAX ? UINT32_MAX : (uint32_t)total;
+
+    stats.read_sum += read_time - event_time;
+    stats.draw_sum += drawn_time - read_time;
+    stats.show_sum += shown_time - drawn_time;
+
+#if LV_LATENCY_LOG_PERIOD
+    if(stats.count % LV_LATENCY_LOG_PERIOD == 0) {
+        char buf[160];
+        lv_snprintf(buf, sizeof(buf),
+                    "input latency of %u inputs: median %u us, 95%% %u us, max %u us; "
+                    "average read %u us, draw %u us, show %u us",
+                    (unsigned)stats.count, (unsigned)lv_latency_get_percentile(50),
+                    (unsigned)lv_latency_get_percentile(95), (unsigned)stats.max,
+                    (unsigned)(stats.read_sum / stats.count), (unsigned)(stats.draw_sum / stats.count),
+                    (unsigned)(stats.show_sum / stats.count));
+        LV_LOG_INFO(buf);
+    }
+#endif
+}
+
+#endif /*LV_USE_LATENCY*/
@@ -0,0 +1,109 @@
+/**
+ * @file lv_latency.h
+ * Measure how long the result of inputs takes to be shown: from the event
+ * (as timestamped by the input driver) to its read, the frame drawing it,
+ * and that frame reaching the screen.
+ */
+
+#ifndef LV_LATENCY_H
+#define LV_LATENCY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_obj.h"
+#include <stdint.h>
+
+#if LV_USE_LATENCY
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/*Ranges of the latency histogram*/
+#define LV_LATENCY_HIST_SIZE 32
+/*Width of a range of the histogram [us]*/
+#define LV_LATENCY_HIST_STEP 4000
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct
+{
+    uint32_t hist[LV_LATENCY_HIST_SIZE]; /**< Inputs shown per range of latency, the last one for all longer ones*/
+    uint32_t count; /**< Inputs shown*/
+    uint32_t max;   /**< Longest latency [us]*/
+
+    /*Time spent in each stage, summed up for all the inputs [us]*/
+    uint64_t read_sum; /**< From the event to its read*/
+    uint64_t draw_sum; /**< From its read to the frame drawn*/
+    uint64_t show_sum; /**< From the frame drawn to the frame shown*/
+} lv_latency_stats_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Get the current time on the clock of input event timestamps (`CLOCK_MONOTONIC`).
+ * @return time in microseconds
+ */
+uint64_t lv_latency_now(void);
+
+/**
+ * Note an input whose result is waiting to be drawn.
+ * Called by the input device read task for the data having a `time_usec`.
+ * @param disp pointer to the display of the input device
+ * @param event_time when the event happened [us]
+ */
+void lv_latency_input(lv_disp_t * disp, uint64_t event_time);
+
+/**
+ * Note a frame was drawn and flushed.
+ * Called by the refresher.
+ * @param disp pointer to the display being refreshed
+ */
+void lv_latency_drawn(lv_disp_t * disp);
+
+/**
+ * Note the last frame flushed reached the screen.
+ * Called by display drivers setting `present_report`, e.g. on page flip completion.
+ * @param disp pointer to a display
+ * @param time when the frame was shown [us]. 0: now
+ */
+void lv_latency_presented(lv_disp_t * disp, uint64_t time);
+
+/**
+ * Get the latencies measured so far, on all the displays.
+ * @return pointer to the statistics
+ */
+const lv_latency_stats_t * lv_latency_get_stats(void);
+
+/**
+ * Get a percentile of the latencies measured so far.
+ * @param percent e.g. 50 for the median
+ * @return upper bound of the range of the histogram holding it [us], 0 if nothing was measured
+ */
+uint32_t lv_latency_get_percentile(uint32_t percent);
+
+/**
+ * Forget the latencies measured so far.
+ */
+void lv_latency_reset(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /*LV_USE_LATENCY*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*LV_LATENCY_H*/
@@ -11,6 +11,7 @@
 #include "lv_refr.h"
 #include "lv_group.h"
 #include "lv_disp.h"
+#include "lv_scr_cache.h"
 #include "../lv_core/lv_debug.h"
 #include "../lv_themes/lv_theme.h"
 #include "../lv_draw/lv_draw.h"
@@ -461,6 +462,9 @@ lv_res_t lv_obj_del(lv_obj_t * obj)
     lv_obj_t * par = lv_obj_get_parent(obj);
     if(par == NULL) { /*It is a screen*/
         lv_disp_t * d = lv_obj_get_disp(obj);
+#if LV_USE_SCR_CACHE
+        lv_scr_cache_remove(d, obj);
+#endif
         lv_ll_rem(&d->scr_ll, obj);
     } else {
         lv_ll_rem(&(par->child_ll), obj);
@@ -523,8 +527,15 @@ void lv_obj_invalidate_area(const lv_obj_t * obj, const lv_area_t * area)
     /*Invalidate the object only if it belongs to the 'LV_GC_ROOT(_lv_act_scr)'*/
     lv_obj_t * obj_scr = lv_obj_get_screen(obj);
     lv_disp_t * disp   = lv_obj_get_disp(obj_scr);
-    if(obj_scr == lv_disp_get_scr_act(disp) || obj_scr == lv_disp_get_layer_top(disp) ||
-       obj_scr == lv_disp_get_layer_sys(disp)) {
+    bool on_layer = obj_scr == lv_disp_get_layer_top(disp) || obj_scr == lv_disp_get_layer_sys(disp);
+    bool shown    = obj_scr == lv_disp_get_scr_act(disp) || on_layer;
+#if LV_USE_SCR_CACHE
+    /*Cached screens remember where they changed to redraw it when loaded*/
+    bool cached = shown == false && lv_scr_cache_is_cached(disp, obj_scr);
+#else
+    bool cached = false;
+#endif
+    if(shown || cached) {
 
         /*Truncate the area to the object*/
         lv_area_t obj_coords;
@@ -551,7 +562,13 @@ void lv_obj_invalidate_area(const lv_obj_t * obj, const lv_area_t * area)
             par = lv_obj_get_parent(par);
         }
 
-        if(is_common) lv_inv_area(disp, &area_trunc);
+        if(is_common == false) return;
+
+#if LV_USE_SCR_CACHE
+        /*The layers are on every cached screen too*/
+        if(on_layer || cached) lv_scr_cache_inv_area(disp, cached ? obj_scr : NULL, &area_trunc);
+#endif
+        if(shown) lv_inv_area(disp, &area_trunc);
     }
 }
 
@@ -9,6 +9,9 @@
 #include <stddef.h>
 #include "lv_refr.h"
 #include "lv_disp.h"
+#include "lv_indev.h"
+#include "lv_scr_cache.h"
+#include "lv_latency.h"
 #include "../lv_hal/lv_hal_tick.h"
 #include "../lv_hal/lv_hal_disp.h"
 #include "../lv_misc/lv_task.h"
@@ -37,16 +40,22 @@ static void lv_refr_join_area(void);
 static void lv_refr_areas(void);
 static void lv_refr_area(const lv_area_t * area_p);
 static void lv_refr_area_part(const lv_area_t * area_p);
+static void lv_refr_mask(const lv_area_t * mask_p);
 static lv_obj_t * lv_refr_get_top_obj(const lv_area_t * area_p, lv_obj_t * obj);
 static void lv_refr_obj_and_children(lv_obj_t * top_p, const lv_area_t * mask_p);
 static void lv_refr_obj(lv_obj_t * obj, const lv_area_t * mask_ori_p);
 static void lv_refr_vdb_flush(void);
+static void lv_refr_wait_flush(void);
+static void lv_refr_sync_areas(void);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static uint32_t px_num;
 static lv_disp_t * disp_refr; /*Display being refreshed*/
+#if LV_INDEV_FAST_REFR
+static bool indev_reading; /*The input devices are read by the refresh of `disp_refr`*/
+#endif
 
 /**********************
  *      MACROS
@@ -131,6 +140,38 @@ void lv_inv_area(lv_disp_t * disp, const lv_area_t * area_p)
             lv_area_copy(&disp->inv_areas[disp->inv_p], &scr_area);
         }
         disp->inv_p++;
+
+        /*Wake up the refresh task (see `lv_disp_refr_task`)*/
+        if(disp->refr_task) lv_task_resume(disp->refr_task);
+    }
+}
+
+/**
+ * Refresh a display as soon as possible because an input device changed it.
+ * The refresh task doesn't wait for its period and runs before the other tasks
+ * with the same priority. Calling it several times before the refresh leads to one refresh.
+ * @param disp pointer to the display an input device is assigned to
+ */
+void lv_refr_input(lv_disp_t * disp)
+{
+    if(disp == NULL || disp->refr_task == NULL) return;
+
+#if LV_INDEV_FAST_REFR
+    /*Read by the refresh itself (`lv_indev_read_now`): it's drawn right away*/
+    if(indev_reading && disp_refr == disp) return;
+#endif
+
+    /*Nothing to show*/
+    if(disp->inv_p == 0) return;
+
+    lv_task_ready(disp->refr_task);
+
+    /*Raise the priority of the refresh task until it runs*/
+    lv_task_prio_t prio = disp->refr_task->prio;
+    if(disp->refr_input == 0 && prio != LV_TASK_PRIO_OFF && prio < LV_TASK_PRIO_HIGHEST) {
+        disp->refr_input = 1;
+        disp->refr_prio  = prio;
+        lv_task_set_prio(disp->refr_task, prio + 1);
     }
 }
 
@@ -166,46 +207,57 @@ void lv_disp_refr_task(lv_task_t * task)
 
     disp_refr = task->user_data;
 
+#if LV_INDEV_FAST_REFR
+    /*Draw where the pointers are now, not where they were at their last read*/
+    indev_reading = true;
+    lv_indev_read_now(disp_refr);
+    indev_reading = false;
+
+    if(disp_refr->refr_input) {
+        disp_refr->refr_input = 0;
+        lv_task_set_prio(disp_refr->refr_task, disp_refr->refr_prio);
+    }
+#endif
+
     lv_refr_join_area();
 
+    /*In true double buffered mode bring the buffer to draw in up to date first*/
+    if(disp_refr->inv_p != 0 && lv_disp_is_true_double_buf(disp_refr) && disp_refr->driver.set_px_cb == NULL) {
+        lv_refr_sync_areas();
+    }
+
     lv_refr_areas();
 
     /*If refresh happened ...*/
     if(disp_refr->inv_p != 0) {
-        /* In true double buffered mode copy the refreshed areas to the new VDB to keep it up to date.
+        /* In true double buffered mode the refreshed areas are copied to the new VDB to keep it up to date.
          * With set_px_cb we don't know anything about the buffer (even it's size) so skip copying.*/
         if(lv_disp_is_true_double_buf(disp_refr) && disp_refr->driver.set_px_cb == NULL) {
-            lv_disp_buf_t * vdb = lv_disp_get_buf(disp_refr);
-
             /*Flush the content of the VDB*/
             lv_refr_vdb_flush();
 
             /* With true double buffering the flushing should be only the address change of the
-             * current frame buffer. Wait until the address change is ready and copy the changed
-             * content to the other frame buffer (new active VDB) to keep the buffers synchronized*/
-            while(vdb->flushing)
-                ;
-
-            uint8_t * buf_act = (uint8_t *)vdb->buf_act;
-            uint8_t * buf_ina = (uint8_t *)vdb->buf_act == vdb->buf1 ? vdb->buf2 : vdb->buf1;
-
-            lv_coord_t hres = lv_disp_get_hor_res(disp_refr);
+             * current frame buffer, which may complete as late as the next vertical blank.
+             * Instead of waiting for it, copy the changed content to the other frame buffer
+             * (new active VDB) before the next refresh draws in it (see `lv_refr_sync_areas`)*/
             uint16_t a;
+            disp_refr->sync_p = 0;
             for(a = 0; a < disp_refr->inv_p; a++) {
                 if(disp_refr->inv_area_joined[a] == 0) {
-                    lv_coord_t y;
-                    uint32_t start_offs =
-                        (hres * disp_refr->inv_areas[a].y1 + disp_refr->inv_areas[a].x1) * sizeof(lv_color_t);
-                    uint32_t line_length = lv_area_get_width(&disp_refr->inv_areas[a]) * sizeof(lv_color_t);
-
-                    for(y = disp_refr->inv_areas[a].y1; y <= disp_refr->inv_areas[a].y2; y++) {
-                        memcpy(buf_act + start_offs, buf_ina + start_offs, line_length);
-                        start_offs += hres * sizeof(lv_color_t);
-                    }
+                    disp_refr->sync_areas[disp_refr->sync_p] = disp_refr->inv_areas[a];
+                    disp_refr->sync_p++;
                 }
             }
         } /*End of true double buffer handling*/
 
+#if LV_USE_SCR_CACHE
+        lv_scr_cache_refr_ready(disp_refr);
+#endif
+
+#if LV_USE_LATENCY
+        lv_latency_drawn(disp_refr);
+#endif
+
         /*Clean up*/
         memset(disp_refr->inv_areas, 0, sizeof(disp_refr->inv_areas));
         memset(disp_refr->inv_area_joined, 0, sizeof(disp_refr->inv_area_joined));
@@ -219,6 +271,9 @@ void lv_disp_refr_task(lv_task_t * task)
 
     lv_draw_free_buf();
 
+    /*Nothing left to draw: don't wake up until an area is invalidated*/
+    if(disp_refr->inv_p == 0 && disp_refr->refr_task) lv_task_pause(disp_refr->refr_task);
+
     LV_LOG_TRACE("lv_refr_task: ready");
 }
 
@@ -269,12 +324,28 @@ static void lv_refr_join_area(void)
 static void lv_refr_areas(void)
 {
     px_num = 0;
-    uint32_t i;
+
+    if(disp_refr->inv_p == 0) return;
+
+    /*Find the last area which will be drawn*/
+    int32_t i;
+    int32_t last_i = 0;
+    for(i = disp_refr->inv_p - 1; i >= 0; i--) {
+        if(disp_refr->inv_area_joined[i] == 0) {
+            last_i = i;
+            break;
+        }
+    }
+
+    disp_refr->driver.buffer->last_area = 0;
+    disp_refr->driver.buffer->last_part = 0;
 
     for(i = 0; i < disp_refr->inv_p; i++) {
         /*Refresh the unjoined areas*/
         if(disp_refr->inv_area_joined[i] == 0) {
 
+            if(i == last_i) disp_refr->driver.buffer->last_area = 1;
+            disp_refr->driver.buffer->last_part = 0;
             lv_refr_area(&disp_refr->inv_areas[i]);
 
             if(disp_refr->driver.monitor_cb) px_num += lv_area_get_size(&disp_refr->inv_areas[i]);
@@ -296,6 +367,7 @@ static void lv_refr_area(const lv_area_t * area_p)
         vdb->area.x2        = lv_disp_get_hor_res(disp_refr) - 1;
         vdb->area.y1        = 0;
         vdb->area.y2        = lv_disp_get_ver_res(disp_refr) - 1;
+        vdb->last_part      = 1;
         lv_refr_area_part(area_p);
     }
     /*The buffer is smaller: refresh the area in parts*/
@@ -350,6 +422,7 @@ static void lv_refr_area(const lv_area_t * area_p)
             vdb->area.y2 = row + max_row - 1;
             if(vdb->area.y2 > y2) vdb->area.y2 = y2;
             row_last = vdb->area.y2;
+            if(y2 == row_last) vdb->last_part = 1;
             lv_refr_area_part(area_p);
         }
 
@@ -360,6 +433,7 @@ static void lv_refr_area(const lv_area_t * area_p)
             vdb->area.x2 = area_p->x2;
             vdb->area.y1 = row;
             vdb->area.y2 = y2;
+            vdb->last_part = 1;
 
             /*Refresh this part too*/
             lv_refr_area_part(area_p);
@@ -379,26 +453,32 @@ static void lv_refr_area_part(const lv_area_t * area_p)
     /*In non double buffered mode, before rendering the next part wait until the previous image is
      * flushed*/
     if(lv_disp_is_double_buf(disp_refr) == false) {
-        while(vdb->flushing)
-            ;
+        lv_refr_wait_flush();
     }
 
-    lv_obj_t * top_p;
-
     /*Get the new mask from the original area and the act. VDB
      It will be a part of 'area_p'*/
     lv_area_t start_mask;
     lv_area_intersect(&start_mask, area_p, &vdb->area);
 
-    /*Get the most top object which is not covered by others*/
-    top_p = lv_refr_get_top_obj(&start_mask, lv_disp_get_scr_act(disp_refr));
-
-    /*Do the refreshing from the top object*/
-    lv_refr_obj_and_children(top_p, &start_mask);
+#if LV_USE_SCR_CACHE
+    /*A cached screen is copied back and only its changed areas are redrawn*/
+    if(lv_scr_cache_restore(disp_refr, &start_mask, vdb->buf_act, &vdb->area)) {
+        const lv_area_t * inv_areas;
+        uint16_t inv_cnt = lv_scr_cache_get_inv_areas(disp_refr, &inv_areas);
+        lv_area_t inv_mask;
+        uint16_t i;
+        for(i = 0; i < inv_cnt; i++) {
+            if(lv_area_intersect(&inv_mask, &start_mask, &inv_areas[i])) lv_refr_mask(&inv_mask);
+        }
+    } else {
+        lv_refr_mask(&start_mask);
+    }
 
-    /*Also refresh top and sys layer unconditionally*/
-    lv_refr_obj_and_children(lv_disp_get_layer_top(disp_refr), &start_mask);
-    lv_refr_obj_and_children(lv_disp_get_layer_sys(disp_refr), &start_mask);
+    lv_scr_cache_capture(disp_refr, &start_mask, vdb->buf_act, &vdb->area);
+#else
+    lv_refr_mask(&start_mask);
+#endif
 
     /* In true double buffered mode flush only once when all areas were rendered.
      * In normal mode flush after every area */
@@ -407,6 +487,25 @@ static void lv_refr_area_part(const lv_area_t * area_p)
     }
 }
 
+/**
+ * Draw the objects of the active screen and the layers on an area of the actual Virtual Display Buffer
+ * @param mask_p pointer to an area, the objects will be drawn only here
+ */
+static void lv_refr_mask(const lv_area_t * mask_p)
+{
+    lv_obj_t * top_p;
+
+    /*Get the most top object which is not covered by others*/
+    top_p = lv_refr_get_top_obj(mask_p, lv_disp_get_scr_act(disp_refr));
+
+    /*Do the refreshing from the top object*/
+    lv_refr_obj_and_children(top_p, mask_p);
+
+    /*Also refresh top and sys layer unconditionally*/
+    lv_refr_obj_and_children(lv_disp_get_layer_top(disp_refr), mask_p);
+    lv_refr_obj_and_children(lv_disp_get_layer_sys(disp_refr), mask_p);
+}
+
 /**
  * Search the most top object which fully covers an area
  * @param area_p pointer to an area
@@ -564,8 +663,7 @@ static void lv_refr_vdb_flush(void)
     /*In double buffered mode wait until the other buffer is flushed before flushing the current
      * one*/
     if(lv_disp_is_double_buf(disp_refr)) {
-        while(vdb->flushing)
-            ;
+        lv_refr_wait_flush();
     }
 
     vdb->flushing = 1;
@@ -581,3 +679,48 @@ static void lv_refr_vdb_flush(void)
             vdb->buf_act = vdb->buf1;
     }
 }
+
+/**
+ * Wait until the last flush of the display being refreshed is ready
+ */
+static void lv_refr_wait_flush(void)
+{
+    lv_disp_buf_t * vdb = lv_disp_get_buf(disp_refr);
+
+    while(vdb->flushing) {
+        if(disp_refr->driver.wait_cb) disp_refr->driver.wait_cb(&disp_refr->driver);
+    }
+}
+
+/**
+ * In true double buffered mode, copy the areas refreshed in the last frame to the active VDB,
+ * once the other buffer holding them is flushed
+ */
+static void lv_refr_sync_areas(void)
+{
+    lv_disp_buf_t * vdb = lv_disp_get_buf(disp_refr);
+
+    /*Until the flush is ready the active VDB may still be shown*/
+    lv_refr_wait_flush();
+
+    if(disp_refr->sync_p == 0) return;
+
+    uint8_t * buf_act = (uint8_t *)vdb->buf_act;
+    uint8_t * buf_ina = (uint8_t *)vdb->buf_act == vdb->buf1 ? vdb->buf2 : vdb->buf1;
+
+    lv_coord_t hres = lv_disp_get_hor_res(disp_refr);
+    uint16_t a;
+    for(a = 0; a < disp_refr->sync_p; a++) {
+        lv_coord_t y;
+        uint32_t start_offs =
+            (hres * disp_refr->sync_areas[a].y1 + disp_refr->sync_areas[a].x1) * sizeof(lv_color_t);
+        uint32_t line_length = lv_area_get_width(&disp_refr->sync_areas[a]) * sizeof(lv_color_t);
+
+        for(y = disp_refr->sync_areas[a].y1; y <= disp_refr->sync_areas[a].y2; y++) {
+            memcpy(buf_act + start_offs, buf_ina + start_offs, line_length);
+            start_offs += hres * sizeof(lv_color_t);
+        }
+    }
+
+    disp_refr->sync_p = 0;
+}
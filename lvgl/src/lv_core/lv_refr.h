@@ -62,6 +62,14 @@ void lv_refr_now(lv_disp_t * disp);
  */
 void lv_inv_area(lv_disp_t * disp, const lv_area_t * area_p);
 
+/**
+ * Refresh a display as soon as possible because an input device changed it.
+ * The refresh task doesn't wait for its period and runs before the other tasks
+ * with the same priority. Calling it several times before the refresh leads to one refresh.
+ * @param disp pointer to the display an input device is assigned to
+ */
+void lv_refr_input(lv_disp_t * disp);
+
 /**
  * Get the display which is being refreshed
  * @return the display being refreshed
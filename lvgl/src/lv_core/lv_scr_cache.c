@@ -0,0 +1,402 @@
+/**
+ * @file lv_scr_cache.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_scr_cache.h"
+#if LV_USE_SCR_CACHE
+
+#include <string.h>
+#include "lv_disp.h"
+#include "lv_refr.h"
+#include "../lv_misc/lv_mem.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#if LV_SCR_CACHE_MAX < 1
+#error "LV_SCR_CACHE_MAX must be >= 1. See lv_conf.h"
+#endif
+
+/*Changed areas kept per cached screen; further ones are joined into the last one*/
+#define LV_SCR_CACHE_INV_MAX 8
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef struct
+{
+    lv_disp_t * disp;
+    const lv_obj_t * scr;
+    lv_color_t * buf;   /**< Pixels of the whole display. NULL if the entry is free*/
+    uint32_t size;      /**< Size of `buf` in bytes*/
+    uint32_t last_use;  /**< When the screen was last shown, to drop the least recently used one*/
+
+    /**< Areas changed since they were drawn*/
+    lv_area_t inv_areas[LV_SCR_CACHE_INV_MAX];
+    uint8_t inv_p;
+
+    uint8_t complete : 1;  /**< 1: every pixel of `buf` was drawn*/
+    uint8_t restoring : 1; /**< 1: the next refresh copies `buf` back*/
+} lv_scr_cache_entry_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static lv_scr_cache_entry_t * get_entry(lv_disp_t * disp, const lv_obj_t * scr);
+static lv_scr_cache_entry_t * new_entry(lv_disp_t * disp, const lv_obj_t * scr);
+static void free_entry(lv_scr_cache_entry_t * entry);
+static void entry_inv_area(lv_scr_cache_entry_t * entry, const lv_area_t * area_p);
+static void copy_area(const lv_area_t * area_p, lv_color_t * dest, const lv_area_t * dest_area,
+                      const lv_color_t * src, const lv_area_t * src_area);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static lv_scr_cache_entry_t entries[LV_SCR_CACHE_MAX];
+static uint32_t used_size;
+static uint32_t use_cnt;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Handle loading a screen: keep the rendered pixels of the screen being left
+ * and copy back the ones of `scr` if it's cached.
+ * Called by `lv_disp_load_scr` once `scr` is the active screen.
+ * @param disp pointer to the display of the screens
+ * @param old_scr pointer to the screen being left
+ * @param scr pointer to the loaded screen
+ * @return true: the display was invalidated for the cache; false: `scr` has to be invalidated as usual
+ */
+bool lv_scr_cache_load(lv_disp_t * disp, lv_obj_t * old_scr, lv_obj_t * scr)
+{
+    /*Reloading the same screen just redraws it*/
+    if(old_scr == scr) return false;
+
+    /*The pixels are only known when they are drawn in a plain buffer*/
+    if(disp->driver.set_px_cb) return false;
+
+    uint16_t i;
+    lv_scr_cache_entry_t * old_entry = get_entry(disp, old_scr);
+    if(old_entry) {
+        /*Keep it only if it was drawn or copied back since it was loaded*/
+        if(old_entry->complete && old_entry->restoring == 0) {
+            /*The invalidated areas were not drawn yet*/
+            for(i = 0; i < disp->inv_p; i++) {
+                if(disp->inv_area_joined[i] == 0) entry_inv_area(old_entry, &disp->inv_areas[i]);
+            }
+            old_entry->last_use = ++use_cnt;
+        } else {
+            free_entry(old_entry);
+        }
+    }
+
+    lv_scr_cache_entry_t * entry = get_entry(disp, scr);
+    if(entry) {
+        /*Whatever was about to be redrawn might have changed on this screen too*/
+        for(i = 0; i < disp->inv_p; i++) {
+            if(disp->inv_area_joined[i] == 0) entry_inv_area(entry, &disp->inv_areas[i]);
+        }
+        entry->restoring = 1;
+    } else {
+        /*Start keeping the pixels of the screen as it's drawn*/
+        entry = new_entry(disp, scr);
+        if(entry == NULL) return false;
+    }
+
+    /*Either copy back or draw the whole display; it covers every other invalidated area*/
+    lv_area_t scr_area;
+    scr_area.x1 = 0;
+    scr_area.y1 = 0;
+    scr_area.x2 = lv_disp_get_hor_res(disp) - 1;
+    scr_area.y2 = lv_disp_get_ver_res(disp) - 1;
+
+    lv_inv_area(disp, NULL);
+    lv_inv_area(disp, &scr_area);
+
+    return true;
+}
+
+/**
+ * Tell whether a screen which is not shown is in the cache.
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen
+ * @return true: changes of `scr` should be reported with `lv_scr_cache_inv_area`
+ */
+bool lv_scr_cache_is_cached(lv_disp_t * disp, const lv_obj_t * scr)
+{
+    return get_entry(disp, scr) != NULL;
+}
+
+/**
+ * Mark an area of a cached screen changed. It's redrawn over the cached pixels
+ * when the screen is loaded again.
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen. NULL for every cached screen of the display
+ *            (e.g. when the top or system layer changes)
+ * @param area_p the changed area
+ */
+void lv_scr_cache_inv_area(lv_disp_t * disp, const lv_obj_t * scr, const lv_area_t * area_p)
+{
+    lv_area_t scr_area;
+    lv_area_t com_area;
+    scr_area.x1 = 0;
+    scr_area.y1 = 0;
+    scr_area.x2 = lv_disp_get_hor_res(disp) - 1;
+    scr_area.y2 = lv_disp_get_ver_res(disp) - 1;
+
+    if(lv_area_intersect(&com_area, area_p, &scr_area) == false) return;
+
+    uint16_t i;
+    for(i = 0; i < LV_SCR_CACHE_MAX; i++) {
+        lv_scr_cache_entry_t * entry = &entries[i];
+        if(entry->buf == NULL || entry->disp != disp) continue;
+
+        /*The active screen is kept up to date by drawing it*/
+        if(entry->scr == lv_disp_get_scr_act(disp)) continue;
+
+        if(scr == NULL || entry->scr == scr) entry_inv_area(entry, &com_area);
+    }
+}
+
+/**
+ * Drop a screen from the cache, e.g. when it's deleted.
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen. NULL to drop every screen of the display.
+ */
+void lv_scr_cache_remove(lv_disp_t * disp, const lv_obj_t * scr)
+{
+    uint16_t i;
+    for(i = 0; i < LV_SCR_CACHE_MAX; i++) {
+        lv_scr_cache_entry_t * entry = &entries[i];
+        if(entry->buf == NULL || entry->disp != disp) continue;
+
+        if(scr == NULL || entry->scr == scr) free_entry(entry);
+    }
+}
+
+/**
+ * Copy the cached pixels of an area of the screen being loaded.
+ * Called by the refresher before drawing an area.
+ * @param disp pointer to the display being refreshed
+ * @param area_p area to copy
+ * @param buf buffer to copy to
+ * @param buf_area area of the display covered by `buf`
+ * @return true: the pixels were copied, only the areas from `lv_scr_cache_get_inv_areas` have to be drawn;
+ *         false: the screen is not being loaded from the cache
+ */
+bool lv_scr_cache_restore(lv_disp_t * disp, const lv_area_t * area_p, lv_color_t * buf, const lv_area_t * buf_area)
+{
+    lv_scr_cache_entry_t * entry = get_entry(disp, lv_disp_get_scr_act(disp));
+    if(entry == NULL || entry->restoring == 0) return false;
+
+    lv_area_t scr_area;
+    scr_area.x1 = 0;
+    scr_area.y1 = 0;
+    scr_area.x2 = lv_disp_get_hor_res(disp) - 1;
+    scr_area.y2 = lv_disp_get_ver_res(disp) - 1;
+
+    copy_area(area_p, buf, buf_area, entry->buf, &scr_area);
+
+    return true;
+}
+
+/**
+ * Get the areas of the screen being loaded which changed since they were cached.
+ * @param disp pointer to the display being refreshed
+ * @param areas pointer to store the array of areas
+ * @return number of areas
+ */
+uint16_t lv_scr_cache_get_inv_areas(lv_disp_t * disp, const lv_area_t ** areas)
+{
+    lv_scr_cache_entry_t * entry = get_entry(disp, lv_disp_get_scr_act(disp));
+    if(entry == NULL) {
+        *areas = NULL;
+        return 0;
+    }
+
+    *areas = entry->inv_areas;
+    return entry->inv_p;
+}
+
+/**
+ * Keep the pixels of a drawn area of the active screen.
+ * Called by the refresher once an area is drawn.
+ * @param disp pointer to the display being refreshed
+ * @param area_p the drawn area
+ * @param buf buffer the area is drawn in
+ * @param buf_area area of the display covered by `buf`
+ */
+void lv_scr_cache_capture(lv_disp_t * disp, const lv_area_t * area_p, const lv_color_t * buf,
+                          const lv_area_t * buf_area)
+{
+    lv_scr_cache_entry_t * entry = get_entry(disp, lv_disp_get_scr_act(disp));
+    if(entry == NULL) return;
+
+    lv_area_t scr_area;
+    scr_area.x1 = 0;
+    scr_area.y1 = 0;
+    scr_area.x2 = lv_disp_get_hor_res(disp) - 1;
+    scr_area.y2 = lv_disp_get_ver_res(disp) - 1;
+
+    copy_area(area_p, entry->buf, &scr_area, buf, buf_area);
+}
+
+/**
+ * Called by the refresher once every invalidated area of the display is drawn.
+ * @param disp pointer to the display being refreshed
+ */
+void lv_scr_cache_refr_ready(lv_disp_t * disp)
+{
+    lv_scr_cache_entry_t * entry = get_entry(disp, lv_disp_get_scr_act(disp));
+    if(entry == NULL) return;
+
+    /*The screen was loaded, so the whole display was drawn or copied back*/
+    entry->complete  = 1;
+    entry->restoring = 0;
+    entry->inv_p     = 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Find the entry of a screen
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen
+ * @return pointer to the entry or NULL if the screen is not cached
+ */
+static lv_scr_cache_entry_t * get_entry(lv_disp_t * disp, const lv_obj_t * scr)
+{
+    uint16_t i;
+    for(i = 0; i < LV_SCR_CACHE_MAX; i++) {
+        if(entries[i].buf && entries[i].disp == disp && entries[i].scr == scr) return &entries[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Allocate an entry for a screen, dropping the least recently shown screens to fit in `LV_SCR_CACHE_SIZE`.
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen
+ * @return pointer to the new entry or NULL if it doesn't fit
+ */
+static lv_scr_cache_entry_t * new_entry(lv_disp_t * disp, const lv_obj_t * scr)
+{
+    uint32_t size = (uint32_t)lv_disp_get_hor_res(disp) * lv_disp_get_ver_res(disp) * sizeof(lv_color_t);
+    if(size > LV_SCR_CACHE_SIZE) return NULL;
+
+    lv_scr_cache_entry_t * entry;
+    uint16_t i;
+    while(1) {
+        lv_scr_cache_entry_t * free_p = NULL;
+        lv_scr_cache_entry_t * oldest = NULL;
+        for(i = 0; i < LV_SCR_CACHE_MAX; i++) {
+            entry = &entries[i];
+            if(entry->buf == NULL) {
+                if(free_p == NULL) free_p = entry;
+            }
+            /*Active screens are being drawn in their entries*/
+            else if(entry->scr != lv_disp_get_scr_act(entry->disp)) {
+                if(oldest == NULL || entry->last_use < oldest->last_use) oldest = entry;
+            }
+        }
+
+        if(free_p && used_size + size <= LV_SCR_CACHE_SIZE) {
+            entry = free_p;
+            break;
+        }
+
+        if(oldest == NULL) return NULL;
+        free_entry(oldest);
+    }
+
+    entry->buf = lv_mem_alloc(size);
+    if(entry->buf == NULL) {
+        LV_LOG_WARN("lv_scr_cache: couldn't allocate the pixels of a screen");
+        return NULL;
+    }
+
+    entry->disp      = disp;
+    entry->scr       = scr;
+    entry->size      = size;
+    entry->last_use  = ++use_cnt;
+    entry->inv_p     = 0;
+    entry->complete  = 0;
+    entry->restoring = 0;
+    used_size += size;
+
+    return entry;
+}
+
+/**
+ * Free the pixels of an entry
+ * @param entry pointer to an entry
+ */
+static void free_entry(lv_scr_cache_entry_t * entry)
+{
+    lv_mem_free(entry->buf);
+    used_size -= entry->size;
+    memset(entry, 0, sizeof(lv_scr_cache_entry_t));
+}
+
+/**
+ * Add a changed area to an entry
+ * @param entry pointer to an entry
+ * @param area_p the changed area
+ */
+static void entry_inv_area(lv_scr_cache_entry_t * entry, const lv_area_t * area_p)
+{
+    /*Save only if this area is not in one of the saved areas*/
+    uint16_t i;
+    for(i = 0; i < entry->inv_p; i++) {
+        if(lv_area_is_in(area_p, &entry->inv_areas[i]) != false) return;
+    }
+
+    if(entry->inv_p < LV_SCR_CACHE_INV_MAX) {
+        lv_area_copy(&entry->inv_areas[entry->inv_p], area_p);
+        entry->inv_p++;
+    } else {
+        lv_area_join(&entry->inv_areas[entry->inv_p - 1], &entry->inv_areas[entry->inv_p - 1], area_p);
+    }
+}
+
+/**
+ * Copy the pixels of an area between two buffers
+ * @param area_p the area to copy, in both buffers
+ * @param dest buffer to copy to
+ * @param dest_area area of the display covered by `dest`
+ * @param src buffer to copy from
+ * @param src_area area of the display covered by `src`
+ */
+static void copy_area(const lv_area_t * area_p, lv_color_t * dest, const lv_area_t * dest_area,
+                      const lv_color_t * src, const lv_area_t * src_area)
+{
+    lv_coord_t dest_w = lv_area_get_width(dest_area);
+    lv_coord_t src_w  = lv_area_get_width(src_area);
+    uint32_t line_length = lv_area_get_width(area_p) * sizeof(lv_color_t);
+
+    dest += (area_p->y1 - dest_area->y1) * dest_w + (area_p->x1 - dest_area->x1);
+    src += (area_p->y1 - src_area->y1) * src_w + (area_p->x1 - src_area->x1);
+
+    lv_coord_t y;
+    for(y = area_p->y1; y <= area_p->y2; y++) {
+        memcpy(dest, src, line_length);
+        dest += dest_w;
+        src += src_w;
+    }
+}
+
+#endif /*LV_USE_SCR_CACHE*/
@@ -0,0 +1,117 @@
+/**
+ * @file lv_scr_cache.h
+ * Keep the pixels of the last rendered screens, so loading one of them again
+ * only copies it back instead of drawing all of its objects.
+ */
+
+#ifndef LV_SCR_CACHE_H
+#define LV_SCR_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_obj.h"
+#include <stdbool.h>
+
+#if LV_USE_SCR_CACHE
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Handle loading a screen: keep the rendered pixels of the screen being left
+ * and copy back the ones of `scr` if it's cached.
+ * Called by `lv_disp_load_scr` once `scr` is the active screen.
+ * @param disp pointer to the display of the screens
+ * @param old_scr pointer to the screen being left
+ * @param scr pointer to the loaded screen
+ * @return true: the display was invalidated for the cache; false: `scr` has to be invalidated as usual
+ */
+bool lv_scr_cache_load(lv_disp_t * disp, lv_obj_t * old_scr, lv_obj_t * scr);
+
+/**
+ * Tell whether a screen which is not shown is in the cache.
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen
+ * @return true: changes of `scr` should be reported with `lv_scr_cache_inv_area`
+ */
+bool lv_scr_cache_is_cached(lv_disp_t * disp, const lv_obj_t * scr);
+
+/**
+ * Mark an area of a cached screen changed. It's redrawn over the cached pixels
+ * when the screen is loaded again.
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen. NULL for every cached screen of the display
+ *            (e.g. when the top or system layer changes)
+ * @param area_p the changed area
+ */
+void lv_scr_cache_inv_area(lv_disp_t * disp, const lv_obj_t * scr, const lv_area_t * area_p);
+
+/**
+ * Drop a screen from the cache, e.g. when it's deleted.
+ * @param disp pointer to the display of the screen
+ * @param scr pointer to a screen. NULL to drop every screen of the display.
+ */
+void lv_scr_cache_remove(lv_disp_t * disp, const lv_obj_t * scr);
+
+/**
+ * Copy the cached pixels of an area of the screen being loaded.
+ * Called by the refresher before drawing an area.
+ * @param disp pointer to the display being refreshed
+ * @param area_p area to copy
+ * @param buf buffer to copy to
+ * @param buf_area area of the display covered by `buf`
+ * @return true: the pixels were copied, only the areas from `lv_scr_cache_get_inv_areas` have to be drawn;
+ *         false: the screen is not being loaded from the cache
+ */
+bool lv_scr_cache_restore(lv_disp_t * disp, const lv_area_t * area_p, lv_color_t * buf, const lv_area_t * buf_area);
+
+/**
+ * Get the areas of the screen being loaded which changed since they were cached.
+ * @param disp pointer to the display being refreshed
+ * @param areas pointer to store the array of areas
+ * @return number of areas
+ */
+uint16_t lv_scr_cache_get_inv_areas(lv_disp_t * disp, const lv_area_t ** areas);
+
+/**
+ * Keep the pixels of a drawn area of the active screen.
+ * Called by the refresher once an area is drawn.
+ * @param disp pointer to the display being refreshed
+ * @param area_p the drawn area
+ * @param buf buffer the area is drawn in
+ * @param buf_area area of the display covered by `buf`
+ */
+void lv_scr_cache_capture(lv_disp_t * disp, const lv_area_t * area_p, const lv_color_t * buf,
+                          const lv_area_t * buf_area);
+
+/**
+ * Called by the refresher once every invalidated area of the display is drawn.
+ * @param disp pointer to the display being refreshed
+ */
+void lv_scr_cache_refr_ready(lv_disp_t * disp);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /*LV_USE_SCR_CACHE*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*LV_SCR_CACHE_H*/
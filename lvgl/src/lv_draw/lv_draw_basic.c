@@ -15,6 +15,7 @@
 #include "../lv_misc/lv_area.h"
 #include "../lv_misc/lv_color.h"
 #include "../lv_misc/lv_log.h"
+#include "../lv_misc/lv_math.h"
 
 #include <stddef.h>
 #include "lv_draw.h"
@@ -629,6 +630,69 @@ void lv_draw_map(const lv_area_t * cords_p, const lv_area_t * mask_p, const uint
     }
 }
 
+#if LV_COLOR_DEPTH == 16 && LV_DITHER_GRADIENT
+/**
+ * Fill an area in the Virtual Display Buffer with a color more precise than `lv_color_t`,
+ * approximating it with an ordered dither.
+ * @param cords_p coordinates of the area to fill
+ * @param mask_p fill only o this mask
+ * @param color fill color as 0xRRGGBB (like `lv_color_to32`)
+ * @param opa opacity of the area (0..255)
+ */
+void lv_draw_fill_dither(const lv_area_t * cords_p, const lv_area_t * mask_p, uint32_t color, lv_opa_t opa)
+{
+    /*4x4 Bayer matrix*/
+    static const uint8_t threshold[4][4] = {
+        {0, 8, 2, 10},
+        {12, 4, 14, 6},
+        {3, 11, 1, 9},
+        {15, 7, 13, 5},
+    };
+
+    if(opa < LV_OPA_MIN) return;
+    if(opa > LV_OPA_MAX) opa = LV_OPA_COVER;
+
+    uint16_t r = (color >> 16) & 0xFF;
+    uint16_t g = (color >> 8) & 0xFF;
+    uint16_t b = color & 0xFF;
+
+    lv_area_t res_a;
+    if(lv_area_intersect(&res_a, cords_p, mask_p) == false) return;
+
+    lv_disp_t * disp    = lv_refr_get_disp_refreshing();
+    lv_disp_buf_t * vdb = lv_disp_get_buf(disp);
+
+    /*Without direct access to the VDB just round the color*/
+    if(disp->driver.set_px_cb) {
+        lv_draw_fill(&res_a, mask_p, LV_COLOR_MAKE(r, g, b), opa);
+        return;
+    }
+
+    uint32_t vdb_width = lv_area_get_width(&vdb->area);
+    lv_coord_t row;
+    lv_coord_t col;
+    lv_color_t * px;
+    lv_color_t c;
+    uint8_t t;
+
+    for(row = res_a.y1; row <= res_a.y2; row++) {
+        px = &((lv_color_t *)vdb->buf_act)[vdb_width * (row - vdb->area.y1) + res_a.x1 - vdb->area.x1];
+        for(col = res_a.x1; col <= res_a.x2; col++, px++) {
+            /*Red and blue lose 3 bits, green 2: offset by up to a step before truncating.
+             *The threshold follows the screen coordinates so the pattern stays in place.*/
+            t = threshold[row & 0x3][col & 0x3];
+            c = LV_COLOR_MAKE(LV_MATH_MIN(r + (t >> 1), 0xFF), LV_MATH_MIN(g + (t >> 2), 0xFF),
+                              LV_MATH_MIN(b + (t >> 1), 0xFF));
+
+            if(opa == LV_OPA_COVER)
+                *px = c;
+            else
+                *px = lv_color_mix(c, *px, opa);
+        }
+    }
+}
+#endif
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -45,6 +45,18 @@ void lv_draw_px(lv_coord_t x, lv_coord_t y, const lv_area_t * mask_p, lv_color_t
  */
 void lv_draw_fill(const lv_area_t * cords_p, const lv_area_t * mask_p, lv_color_t color, lv_opa_t opa);
 
+#if LV_COLOR_DEPTH == 16 && LV_DITHER_GRADIENT
+/**
+ * Fill an area in the Virtual Display Buffer with a color more precise than `lv_color_t`,
+ * approximating it with an ordered dither.
+ * @param cords_p coordinates of the area to fill
+ * @param mask_p fill only o this mask
+ * @param color fill color as 0xRRGGBB (like `lv_color_to32`)
+ * @param opa opacity of the area (0..255)
+ */
+void lv_draw_fill_dither(const lv_area_t * cords_p, const lv_area_t * mask_p, uint32_t color, lv_opa_t opa);
+#endif
+
 /**
  * Draw a letter in the Virtual Display Buffer
  * @param pos_p left-top coordinate of the latter
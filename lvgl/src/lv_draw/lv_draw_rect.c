@@ -161,7 +161,14 @@ static void lv_draw_rect_main_mid(const lv_area_t * coords, const lv_area_t * ma
         lv_coord_t row;
         lv_coord_t row_start = coords->y1 + radius;
         lv_coord_t row_end   = coords->y2 - radius;
+#if LV_COLOR_DEPTH == 16 && LV_DITHER_GRADIENT
+        uint32_t mcolor32 = lv_color_to32(mcolor);
+        uint32_t gcolor32 = lv_color_to32(gcolor);
+        uint32_t act_color;
+        uint8_t shift;
+#else
         lv_color_t act_color;
+#endif
 
         if(style->body.radius != 0) {
             if(aa) {
@@ -178,9 +185,20 @@ static void lv_draw_rect_main_mid(const lv_area_t * coords, const lv_area_t * ma
             work_area.y1 = row;
             work_area.y2 = row;
             mix          = (uint32_t)((uint32_t)(coords->y2 - work_area.y1) * 255) / height;
+#if LV_COLOR_DEPTH == 16 && LV_DITHER_GRADIENT
+            /*Mix with 8 bits per channel, the dither approximates the result*/
+            act_color = 0;
+            for(shift = 0; shift < 24; shift += 8) {
+                act_color |= ((((mcolor32 >> shift) & 0xFF) * mix + ((gcolor32 >> shift) & 0xFF) * (255 - mix)) >> 8)
+                             << shift;
+            }
+
+            lv_draw_fill_dither(&work_area, mask, act_color, opa);
+#else
             act_color    = lv_color_mix(mcolor, gcolor, mix);
 
             lv_draw_fill(&work_area, mask, act_color, opa);
+#endif
         }
     }
 }
@@ -16,6 +16,7 @@
 #include "../lv_misc/lv_mem.h"
 #include "../lv_core/lv_obj.h"
 #include "../lv_core/lv_refr.h"
+#include "../lv_core/lv_scr_cache.h"
 #include "../lv_misc/lv_gc.h"
 
 #if defined(LV_GC_INCLUDE)
@@ -58,6 +59,7 @@ void lv_disp_drv_init(lv_disp_drv_t * driver)
     memset(driver, 0, sizeof(lv_disp_drv_t));
 
     driver->flush_cb         = NULL;
+    driver->wait_cb          = NULL;
     driver->hor_res          = LV_HOR_RES_MAX;
     driver->ver_res          = LV_VER_RES_MAX;
     driver->buffer           = NULL;
@@ -135,7 +137,14 @@ lv_disp_t * lv_disp_drv_register(lv_disp_drv_t * driver)
     disp_def                 = disp; /*Temporarily change the default screen to create the default screens on the
                                         new display*/
 
-    disp->inv_p = 0;
+    disp->inv_p      = 0;
+    disp->sync_p     = 0;
+    disp->refr_input = 0;
+#if LV_USE_LATENCY
+    disp->lat_input_time = 0;
+    disp->lat_frame_time = 0;
+#endif
+    disp->refr_task  = NULL; /*Created below, once the screens are*/
 
     disp->act_scr   = lv_obj_create(NULL, NULL); /*Create a default screen on the display*/
     disp->top_layer = lv_obj_create(NULL, NULL); /*Create top layer on the display*/
@@ -192,6 +201,10 @@ void lv_disp_remove(lv_disp_t * disp)
         indev = lv_indev_get_next(indev);
     }
 
+#if LV_USE_SCR_CACHE
+    lv_scr_cache_remove(disp, NULL);
+#endif
+
     lv_ll_rem(&LV_GC_ROOT(_lv_disp_ll), disp);
     lv_mem_free(disp);
 
@@ -276,9 +289,24 @@ LV_ATTRIBUTE_FLUSH_READY void lv_disp_flush_ready(lv_disp_drv_t * disp_drv)
     }
 #endif
 
+#if defined(__GNUC__)
+    /*The flushing might have been done on another thread, make its writes visible first*/
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
     disp_drv->buffer->flushing = 0;
 }
 
+/**
+ * Tell if it's the last area of the refreshing process.
+ * Can be called from `flush_cb` to execute some special display refreshing if needed when all areas were flushed.
+ * @param disp_drv pointer to display driver
+ * @return true: it's the last area to flush; false: there are other areas too which will be refreshed soon
+ */
+bool lv_disp_flush_is_last(lv_disp_drv_t * disp_drv)
+{
+    return disp_drv->buffer->last_area && disp_drv->buffer->last_part;
+}
+
 /**
  * Get the next display.
  * @param disp pointer to the current display. NULL to initialize.
@@ -53,7 +53,9 @@ typedef struct
     void * buf_act;
     uint32_t size; /*In pixel count*/
     lv_area_t area;
-    volatile uint32_t flushing : 1;
+    volatile int flushing; /*Not a bit field: it can be cleared from another thread while the others are written*/
+    volatile uint32_t last_area : 1; /*1: the last area is being rendered*/
+    volatile uint32_t last_part : 1; /*1: the last part of the current area is being rendered*/
 } lv_disp_buf_t;
 
 /**
@@ -80,6 +82,12 @@ typedef struct _disp_drv_t
     uint32_t screen_transp : 1;
 #endif
 
+#if LV_USE_LATENCY
+    /**1: the driver calls `lv_latency_presented` once a frame is shown;
+     * 0: frames are considered shown once flushed*/
+    uint32_t present_report : 1;
+#endif
+
     /** MANDATORY: Write the internal buffer (VDB) to the display. 'lv_disp_flush_ready()' has to be
      * called when finished */
     void (*flush_cb)(struct _disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p);
@@ -98,6 +106,10 @@ typedef struct _disp_drv_t
      * number of flushed pixels */
     void (*monitor_cb)(struct _disp_drv_t * disp_drv, uint32_t time, uint32_t px);
 
+    /** OPTIONAL: Called repeatedly while LVGL waits for 'lv_disp_flush_ready()'.
+     * For drivers whose flushes complete on events only handled when asked to */
+    void (*wait_cb)(struct _disp_drv_t * disp_drv);
+
 #if LV_USE_GPU
     /** OPTIONAL: Blend two memories using opacity (GPU only)*/
     void (*gpu_blend_cb)(struct _disp_drv_t * disp_drv, lv_color_t * dest, const lv_color_t * src, uint32_t length,
@@ -143,6 +155,23 @@ typedef struct _disp_t
     uint8_t inv_area_joined[LV_INV_BUF_SIZE];
     uint32_t inv_p : 10;
 
+    /** True double buffering: areas of the last frame to copy to the other buffer before drawing in it*/
+    lv_area_t sync_areas[LV_INV_BUF_SIZE];
+    uint32_t sync_p : 10;
+
+    /*The refresh task runs sooner for an input (see `lv_refr_input`)*/
+    uint32_t refr_input : 1;
+    lv_task_prio_t refr_prio; /**< Priority of the refresh task to restore once it ran*/
+
+#if LV_USE_LATENCY
+    /*Inputs waiting to be shown (see `lv_latency.h`), times in microseconds*/
+    uint64_t lat_input_time;  /**< Event time of the oldest input not drawn yet. 0: none*/
+    uint64_t lat_input_read;  /**< When it was read*/
+    uint64_t lat_frame_time;  /**< Event time of the oldest input of the frame not shown yet. 0: none*/
+    uint64_t lat_frame_read;  /**< When it was read*/
+    uint64_t lat_frame_drawn; /**< When the frame was drawn*/
+#endif
+
     /*Miscellaneous data*/
     uint32_t last_activity_time; /**< Last time there was activity on this display */
 } lv_disp_t;
@@ -238,6 +267,14 @@ bool lv_disp_get_antialiasing(lv_disp_t * disp);
  */
 LV_ATTRIBUTE_FLUSH_READY void lv_disp_flush_ready(lv_disp_drv_t * disp_drv);
 
+/**
+ * Tell if it's the last area of the refreshing process.
+ * Can be called from `flush_cb` to execute some special display refreshing if needed when all areas were flushed.
+ * @param disp_drv pointer to display driver
+ * @return true: it's the last area to flush; false: there are other areas too which will be refreshed soon
+ */
+bool lv_disp_flush_is_last(lv_disp_drv_t * disp_drv);
+
 //! @endcond
 
 /**
@@ -67,6 +67,8 @@ typedef struct
     char string[64]; /**< For LV_INDEV_TYPE_KEYBOARD; string data from the current input event. */
 
     lv_indev_type_t event_type; /**< What kind of device type produced the event. */
+
+    uint64_t time_usec; /**< When the event happened, in microseconds of `CLOCK_MONOTONIC`. 0: unknown*/
 } lv_indev_data_t;
 
 /** Initialized by the user and registered by 'lv_indev_add()'*/
@@ -42,6 +42,7 @@ static bool anim_ready_handler(lv_anim_t * a);
  **********************/
 static uint32_t last_task_run;
 static bool anim_list_changed;
+static lv_task_t * anim_task_p;
 
 /**********************
  *      MACROS
@@ -58,7 +59,8 @@ void lv_anim_core_init(void)
 {
     lv_ll_init(&LV_GC_ROOT(_lv_anim_ll), sizeof(lv_anim_t));
     last_task_run = lv_tick_get();
-    lv_task_create(anim_task, LV_DISP_DEF_REFR_PERIOD, LV_TASK_PRIO_MID, NULL);
+    anim_task_p   = lv_task_create(anim_task, LV_DISP_DEF_REFR_PERIOD, LV_TASK_PRIO_MID, NULL);
+    lv_task_pause(anim_task_p); /*Resumed by the first animation*/
 }
 
 /**
@@ -214,6 +216,13 @@ void lv_anim_create(lv_anim_t * a)
     /*Set the start value*/
     if(new_anim->exec_cb) new_anim->exec_cb(new_anim->var, new_anim->start);
 
+    /*The animation task is paused while there are no animations.
+     *Don't count the time it was paused in the animation.*/
+    if(anim_task_p->paused) {
+        last_task_run = lv_tick_get();
+        lv_task_resume(anim_task_p);
+    }
+
     /* Creating an animation changed the linked list.
      * It's important if it happens in a ready callback. (see `anim_task`)*/
     anim_list_changed = true;
@@ -281,6 +290,15 @@ uint16_t lv_anim_count_running(void)
     return cnt++;
 }
 
+/**
+ * Manually refresh the state of the animations.
+ * Useful when the display refresh is not driven by `lv_task_handler`.
+ */
+void lv_anim_refr_now(void)
+{
+    anim_task(NULL);
+}
+
 /**
  * Calculate the time of an animation with a given speed and the start and end values
  * @param speed speed of animation in unit/sec
@@ -554,6 +572,9 @@ static void anim_task(lv_task_t * param)
     }
 
     last_task_run = lv_tick_get();
+
+    /*Nothing to animate, don't wake up until an animation is created*/
+    if(lv_ll_is_empty(&LV_GC_ROOT(_lv_anim_ll))) lv_task_pause(anim_task_p);
 }
 
 /**
@@ -220,6 +220,12 @@ bool lv_anim_custom_del(lv_anim_t * a, lv_anim_custom_exec_cb_t exec_cb);
  */
 uint16_t lv_anim_count_running(void);
 
+/**
+ * Manually refresh the state of the animations.
+ * Useful when the display refresh is not driven by `lv_task_handler`.
+ */
+void lv_anim_refr_now(void);
+
 /**
  * Calculate the time of an animation with a given speed and the start and end values
  * @param speed speed of animation in unit/sec
@@ -24,6 +24,7 @@ extern "C" {
 #include <stdbool.h>
 #include "lv_mem.h"
 #include "lv_ll.h"
+#include "lv_task.h"
 #include "../lv_draw/lv_img_cache.h"
 
 /*********************
@@ -32,6 +33,7 @@ extern "C" {
 
 #define LV_ITERATE_ROOTS(f) \
     f(lv_ll_t, _lv_task_ll)  /*Linked list to store the lv_tasks*/ \
+    f(lv_task_queues_t, _lv_task_queue) /*Due order of the lv_tasks per priority*/ \
     f(lv_ll_t, _lv_disp_ll)  /*Linked list of screens*/            \
     f(lv_ll_t, _lv_indev_ll) /*Linked list of screens*/            \
     f(lv_ll_t, _lv_drv_ll)                                         \
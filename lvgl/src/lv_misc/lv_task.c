@@ -2,12 +2,15 @@
  * @file lv_task.c
  * An 'lv_task'  is a void (*fp) (void* param) type function which will be called periodically.
  * A priority (5 levels + disable) can be assigned to lv_tasks.
+ * The tasks of each priority are kept in a min-heap ordered by when they are due,
+ * so the handler finds the next task without walking all of them.
  */
 
 /*********************
  *      INCLUDES
  *********************/
 #include <stddef.h>
+#include <string.h>
 #include "lv_task.h"
 #include "../lv_core/lv_debug.h"
 #include "../lv_hal/lv_hal_tick.h"
@@ -24,6 +27,9 @@
 #define DEF_PRIO LV_TASK_PRIO_MID
 #define DEF_PERIOD 500
 
+/*`queue_index` of the tasks not in a queue: paused or `LV_TASK_PRIO_OFF`*/
+#define QUEUE_NONE 0xFFFFFFFF
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -31,7 +37,16 @@
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-static bool lv_task_exec(lv_task_t * task);
+static void lv_task_exec(lv_task_t * task, uint64_t handler_start);
+static lv_task_t * lv_task_get_due(uint64_t time);
+static uint64_t lv_task_tick(void);
+static uint64_t lv_task_get_next_run(const lv_task_t * task);
+static void lv_task_queue_update(lv_task_t * task, uint64_t next_run);
+static bool lv_task_queue_insert(lv_task_t * task);
+static void lv_task_queue_remove(lv_task_t * task);
+static void lv_task_queue_sift_up(lv_task_t ** queue, uint32_t i);
+static void lv_task_queue_sift_down(lv_task_t ** queue, uint32_t cnt, uint32_t i);
+static bool lv_task_is_before(const lv_task_t * a, const lv_task_t * b);
 
 /**********************
  *  STATIC VARIABLES
@@ -39,7 +54,11 @@ static bool lv_task_exec(lv_task_t * task);
 static bool lv_task_run  = false;
 static uint8_t idle_last = 0;
 static bool task_deleted;
-static bool task_created;
+static uint32_t task_order;
+
+/*Tasks of each priority as min-heaps by `next_run`, in `_lv_task_queue`*/
+static uint32_t queue_cnt[_LV_TASK_PRIO_NUM];
+static uint32_t queue_size[_LV_TASK_PRIO_NUM];
 
 /**********************
  *      MACROS
@@ -55,6 +74,9 @@ static bool task_created;
 void lv_task_core_init(void)
 {
     lv_ll_init(&LV_GC_ROOT(_lv_task_ll), sizeof(lv_task_t));
+    memset(LV_GC_ROOT(_lv_task_queue), 0, sizeof(LV_GC_ROOT(_lv_task_queue)));
+    memset(queue_cnt, 0, sizeof(queue_cnt));
+    memset(queue_size, 0, sizeof(queue_size));
 
     /*Initially enable the lv_task handling*/
     lv_task_enable(true);
@@ -64,12 +86,21 @@ void lv_task_core_init(void)
  * Call it  periodically to handle lv_tasks.
  */
 LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void)
+{
+    lv_task_handler_next();
+}
+
+/**
+ * Handle the lv_tasks due, like `lv_task_handler`, and tell when to call it again.
+ * @return time in milliseconds until a task is due, see `lv_task_get_time_till_next`
+ */
+LV_ATTRIBUTE_TASK_HANDLER uint32_t lv_task_handler_next(void)
 {
     LV_LOG_TRACE("lv_task_handler started");
 
     /*Avoid concurrent running of the task handler*/
     static bool already_running = false;
-    if(already_running) return;
+    if(already_running) return 0;
     already_running = true;
 
     static uint32_t idle_period_start = 0;
@@ -78,78 +109,20 @@ LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void)
 
     if(lv_task_run == false) {
         already_running = false; /*Release mutex*/
-        return;
+        return LV_NO_TASK_READY;
     }
 
     handler_start = lv_tick_get();
 
-    /* Run all task from the highest to the lowest priority
-     * If a lower priority task is executed check task again from the highest priority
-     * but on the priority of executed tasks don't run tasks before the executed*/
-    lv_task_t * task_interrupter = NULL;
-    lv_task_t * next;
-    bool end_flag;
-    do {
-        end_flag                 = true;
-        task_deleted             = false;
-        task_created             = false;
-        LV_GC_ROOT(_lv_task_act) = lv_ll_get_head(&LV_GC_ROOT(_lv_task_ll));
-        while(LV_GC_ROOT(_lv_task_act)) {
-            /* The task might be deleted if it runs only once ('once = 1')
-             * So get next element until the current is surely valid*/
-            next = lv_ll_get_next(&LV_GC_ROOT(_lv_task_ll), LV_GC_ROOT(_lv_task_act));
-
-            /*We reach priority of the turned off task. There is nothing more to do.*/
-            if(((lv_task_t *)LV_GC_ROOT(_lv_task_act))->prio == LV_TASK_PRIO_OFF) {
-                break;
-            }
-
-            /*Here is the interrupter task. Don't execute it again.*/
-            if(LV_GC_ROOT(_lv_task_act) == task_interrupter) {
-                task_interrupter = NULL; /*From this point only task after the interrupter comes, so
-                                            the interrupter is not interesting anymore*/
-                LV_GC_ROOT(_lv_task_act) = next;
-                continue; /*Load the next task*/
-            }
-
-            /*Just try to run the tasks with highest priority.*/
-            if(((lv_task_t *)LV_GC_ROOT(_lv_task_act))->prio == LV_TASK_PRIO_HIGHEST) {
-                lv_task_exec(LV_GC_ROOT(_lv_task_act));
-            }
-            /*Tasks with higher priority than the interrupted shall be run in every case*/
-            else if(task_interrupter) {
-                if(((lv_task_t *)LV_GC_ROOT(_lv_task_act))->prio > task_interrupter->prio) {
-                    if(lv_task_exec(LV_GC_ROOT(_lv_task_act))) {
-                        if(!task_created && !task_deleted) {
-                            /*Check all tasks again from the highest priority */
-                            task_interrupter = LV_GC_ROOT(_lv_task_act);
-                            end_flag = false;
-                            break;
-                        }
-                    }
-                }
-            }
-            /* It is no interrupter task or we already reached it earlier.
-             * Just run the remaining tasks*/
-            else {
-                if(lv_task_exec(LV_GC_ROOT(_lv_task_act))) {
-                    if(!task_created && !task_deleted) {
-                        task_interrupter = LV_GC_ROOT(_lv_task_act); /*Check all tasks again from the highest priority */
-                        end_flag         = false;
-                        break;
-                    }
-                }
-            }
-
-            /*If a task was created or deleted then this or the next item might be corrupted*/
-            if(task_created || task_deleted) {
-                task_interrupter = NULL;
-                break;
-            }
-
-            LV_GC_ROOT(_lv_task_act) = next; /*Load the next task*/
-        }
-    } while(!end_flag);
+    /* Run the due tasks from the highest to the lowest priority.
+     * Once a task ran, look again from the highest priority: it might have made others ready.
+     * Tasks are due if they were due when the handler started, so each runs at most once
+     * per call, unless made ready again with `lv_task_ready` by another task.*/
+    uint64_t start = lv_task_tick();
+    lv_task_t * task;
+    while((task = lv_task_get_due(start)) != NULL) {
+        lv_task_exec(task, start);
+    }
 
     busy_time += lv_tick_elaps(handler_start);
     uint32_t idle_period_time = lv_tick_elaps(idle_period_start);
@@ -164,6 +137,8 @@ LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void)
     already_running = false; /*Release the mutex*/
 
     LV_LOG_TRACE("lv_task_handler ready");
+
+    return lv_task_get_time_till_next();
 }
 /**
  * Create an "empty" task. It needs to initialzed with at least
@@ -172,48 +147,24 @@ LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void)
  */
 lv_task_t * lv_task_create_basic(void)
 {
-    lv_task_t * new_task = NULL;
-    lv_task_t * tmp;
-
-    /*Create task lists in order of priority from high to low*/
-    tmp = lv_ll_get_head(&LV_GC_ROOT(_lv_task_ll));
-
-    /*It's the first task*/
-    if(NULL == tmp) {
-        new_task = lv_ll_ins_head(&LV_GC_ROOT(_lv_task_ll));
-        LV_ASSERT_MEM(new_task);
-        if(new_task == NULL) return NULL;
-    }
-    /*Insert the new task to proper place according to its priority*/
-    else {
-        do {
-            if(tmp->prio <= DEF_PRIO) {
-                new_task = lv_ll_ins_prev(&LV_GC_ROOT(_lv_task_ll), tmp);
-                LV_ASSERT_MEM(new_task);
-                if(new_task == NULL) return NULL;
-                break;
-            }
-            tmp = lv_ll_get_next(&LV_GC_ROOT(_lv_task_ll), tmp);
-        } while(tmp != NULL);
-
-        /*Only too high priority tasks were found. Add the task to the end*/
-        if(tmp == NULL) {
-            new_task = lv_ll_ins_tail(&LV_GC_ROOT(_lv_task_ll));
-            LV_ASSERT_MEM(new_task);
-            if(new_task == NULL) return NULL;
-        }
-    }
+    lv_task_t * new_task = lv_ll_ins_tail(&LV_GC_ROOT(_lv_task_ll));
+    LV_ASSERT_MEM(new_task);
+    if(new_task == NULL) return NULL;
 
     new_task->period  = DEF_PERIOD;
     new_task->task_cb = NULL;
     new_task->prio    = DEF_PRIO;
 
     new_task->once     = 0;
+    new_task->paused   = 0;
     new_task->last_run = lv_tick_get();
 
     new_task->user_data = NULL;
 
-    task_created = true;
+    /*Tasks due at the same time run in the order they were created*/
+    new_task->order       = task_order++;
+    new_task->queue_index = QUEUE_NONE;
+    lv_task_queue_update(new_task, lv_task_get_next_run(new_task));
 
     return new_task;
 }
@@ -258,6 +209,8 @@ void lv_task_set_cb(lv_task_t * task, lv_task_cb_t task_cb)
  */
 void lv_task_del(lv_task_t * task)
 {
+    if(task->queue_index != QUEUE_NONE) lv_task_queue_remove(task);
+
     lv_ll_rem(&LV_GC_ROOT(_lv_task_ll), task);
 
     lv_mem_free(task);
@@ -274,22 +227,12 @@ void lv_task_set_prio(lv_task_t * task, lv_task_prio_t prio)
 {
     if(task->prio == prio) return;
 
-    /*Find the tasks with new priority*/
-    lv_task_t * i;
-    LV_LL_READ(LV_GC_ROOT(_lv_task_ll), i)
-    {
-        if(i->prio <= prio) {
-            if(i != task) lv_ll_move_before(&LV_GC_ROOT(_lv_task_ll), task, i);
-            break;
-        }
-    }
-
-    /*There was no such a low priority so far then add the node to the tail*/
-    if(i == NULL) {
-        lv_ll_move_before(&LV_GC_ROOT(_lv_task_ll), task, NULL);
-    }
+    /*Move it to the queue of its new priority*/
+    if(task->queue_index != QUEUE_NONE) lv_task_queue_remove(task);
 
     task->prio = prio;
+
+    lv_task_queue_update(task, task->next_run);
 }
 
 /**
@@ -300,6 +243,8 @@ void lv_task_set_prio(lv_task_t * task, lv_task_prio_t prio)
 void lv_task_set_period(lv_task_t * task, uint32_t period)
 {
     task->period = period;
+
+    lv_task_queue_update(task, lv_task_get_next_run(task));
 }
 
 /**
@@ -309,6 +254,33 @@ void lv_task_set_period(lv_task_t * task, uint32_t period)
 void lv_task_ready(lv_task_t * task)
 {
     task->last_run = lv_tick_get() - task->period - 1;
+
+    /*Before the tasks which are just due, even in the running `lv_task_handler`*/
+    lv_task_queue_update(task, 0);
+}
+
+/**
+ * Pause a lv_task. It won't run, whatever its period, until resumed.
+ * @param task pointer to a lv_task.
+ */
+void lv_task_pause(lv_task_t * task)
+{
+    task->paused = 1;
+
+    lv_task_queue_update(task, task->next_run);
+}
+
+/**
+ * Resume a paused lv_task. It runs as soon as its period elapsed since it last ran.
+ * @param task pointer to a lv_task.
+ */
+void lv_task_resume(lv_task_t * task)
+{
+    if(task->paused == 0) return;
+
+    task->paused = 0;
+
+    lv_task_queue_update(task, lv_task_get_next_run(task));
 }
 
 /**
@@ -328,6 +300,8 @@ void lv_task_once(lv_task_t * task)
 void lv_task_reset(lv_task_t * task)
 {
     task->last_run = lv_tick_get();
+
+    lv_task_queue_update(task, lv_task_get_next_run(task));
 }
 
 /**
@@ -348,35 +322,236 @@ uint8_t lv_task_get_idle(void)
     return idle_last;
 }
 
+/**
+ * Get the time until a task has to run.
+ * Tasks which are paused or have `LV_TASK_PRIO_OFF` priority are not considered.
+ * `lv_task_handler` has nothing to do until then, so it's the longest the caller can sleep.
+ * @return time in milliseconds, 0 if a task is already due, `LV_NO_TASK_READY` if no task will run
+ */
+uint32_t lv_task_get_time_till_next(void)
+{
+    if(lv_task_run == false) return LV_NO_TASK_READY;
+
+    /*The first task of each queue is the next one due of its priority*/
+    uint64_t now  = lv_task_tick();
+    uint64_t next = UINT64_MAX;
+    uint8_t prio;
+    for(prio = LV_TASK_PRIO_LOWEST; prio < _LV_TASK_PRIO_NUM; prio++) {
+        if(queue_cnt[prio] == 0) continue;
+
+        uint64_t next_run = LV_GC_ROOT(_lv_task_queue)[prio][0]->next_run;
+        if(next_run <= now) return 0;
+        if(next_run < next) next = next_run;
+    }
+
+    if(next == UINT64_MAX) return LV_NO_TASK_READY;
+
+    return next - now >= LV_NO_TASK_READY ? LV_NO_TASK_READY - 1 : (uint32_t)(next - now);
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
 /**
- * Execute task if its the priority is appropriate
+ * Execute a task which is due
  * @param task pointer to lv_task
- * @return true: execute, false: not executed
+ * @param handler_start when `lv_task_handler` started, on the clock of `lv_task_tick`
  */
-static bool lv_task_exec(lv_task_t * task)
+static void lv_task_exec(lv_task_t * task, uint64_t handler_start)
 {
-    bool exec = false;
-
-    /*Execute if at least 'period' time elapsed*/
-    uint32_t elp = lv_tick_elaps(task->last_run);
-    if(elp >= task->period) {
-        task->last_run = lv_tick_get();
-        task_deleted   = false;
-        task_created   = false;
-        if(task->task_cb) task->task_cb(task);
-
-        /*Delete if it was a one shot lv_task*/
-        if(task_deleted == false) { /*The task might be deleted by itself as well*/
-            if(task->once != 0) {
-                lv_task_del(task);
-            }
+    task->last_run = lv_tick_get();
+
+    /*Not due again in this `lv_task_handler`, unless the callback makes it ready*/
+    uint64_t next_run = lv_task_get_next_run(task);
+    if(next_run <= handler_start) next_run = handler_start + 1;
+    lv_task_queue_update(task, next_run);
+
+    LV_GC_ROOT(_lv_task_act) = task;
+    task_deleted             = false;
+    if(task->task_cb) task->task_cb(task);
+
+    /*Delete if it was a one shot lv_task*/
+    if(task_deleted == false) { /*The task might be deleted by itself as well*/
+        if(task->once != 0) {
+            lv_task_del(task);
+        }
+        /*Made ready by itself: run it in the next `lv_task_handler`, not again and again in this one*/
+        else if(task->queue_index != QUEUE_NONE && task->next_run <= handler_start) {
+            lv_task_queue_update(task, handler_start + 1);
         }
-        exec = true;
     }
+    LV_GC_ROOT(_lv_task_act) = NULL;
+}
+
+/**
+ * Get the task to run next
+ * @param time tasks due at this time (on the clock of `lv_task_tick`) are considered
+ * @return the task due with the highest priority, NULL if there is none
+ */
+static lv_task_t * lv_task_get_due(uint64_t time)
+{
+    uint8_t prio;
+    for(prio = LV_TASK_PRIO_HIGHEST; prio > LV_TASK_PRIO_OFF; prio--) {
+        if(queue_cnt[prio] == 0) continue;
+
+        lv_task_t * task = LV_GC_ROOT(_lv_task_queue)[prio][0];
+        if(task->next_run <= time) return task;
+    }
+
+    return NULL;
+}
+
+/**
+ * Get the time of `lv_tick_get`, not wrapping around.
+ * It starts at 2^32 so times before the first call are positive too.
+ * @return time in milliseconds
+ */
+static uint64_t lv_task_tick(void)
+{
+    static uint32_t last_tick = 0;
+    static uint64_t tick      = (uint64_t)1 << 32;
+
+    uint32_t act_tick = lv_tick_get();
+    tick += (uint32_t)(act_tick - last_tick);
+    last_tick = act_tick;
+
+    return tick;
+}
+
+/**
+ * Get when a task is due from when it last ran and its period.
+ * @param task pointer to a lv_task
+ * @return time on the clock of `lv_task_tick`
+ */
+static uint64_t lv_task_get_next_run(const lv_task_t * task)
+{
+    return lv_task_tick() - lv_tick_elaps(task->last_run) + task->period;
+}
+
+/**
+ * Set when a task is due, and keep it in the queue of its priority unless it
+ * shouldn't run (paused or `LV_TASK_PRIO_OFF`).
+ * @param task pointer to a lv_task
+ * @param next_run when it's due, on the clock of `lv_task_tick`
+ */
+static void lv_task_queue_update(lv_task_t * task, uint64_t next_run)
+{
+    if(task->queue_index != QUEUE_NONE) lv_task_queue_remove(task);
+
+    task->next_run = next_run;
+
+    if(task->paused || task->prio == LV_TASK_PRIO_OFF) return;
+
+    if(lv_task_queue_insert(task) == false) {
+        LV_LOG_ERROR("lv_task: no memory to queue a task, it won't run");
+    }
+}
+
+/**
+ * Add a task to the queue of its priority
+ * @param task pointer to a lv_task, not in a queue
+ * @return false if the queue couldn't grow
+ */
+static bool lv_task_queue_insert(lv_task_t * task)
+{
+    uint8_t prio = task->prio;
+
+    if(queue_cnt[prio] == queue_size[prio]) {
+        uint32_t size = queue_size[prio] ? queue_size[prio] * 2 : 8;
+        lv_task_t ** queue = lv_mem_realloc(LV_GC_ROOT(_lv_task_queue)[prio], size * sizeof(lv_task_t *));
+        LV_ASSERT_MEM(queue);
+        if(queue == NULL) return false;
+
+        LV_GC_ROOT(_lv_task_queue)[prio] = queue;
+        queue_size[prio] = size;
+    }
+
+    lv_task_t ** queue = LV_GC_ROOT(_lv_task_queue)[prio];
+    uint32_t i         = queue_cnt[prio]++;
+    queue[i]           = task;
+    task->queue_index  = i;
+    lv_task_queue_sift_up(queue, i);
+
+    return true;
+}
+
+/**
+ * Remove a task from the queue of its priority
+ * @param task pointer to a lv_task in a queue
+ */
+static void lv_task_queue_remove(lv_task_t * task)
+{
+    uint8_t prio        = task->prio;
+    lv_task_t ** queue  = LV_GC_ROOT(_lv_task_queue)[prio];
+    uint32_t i          = task->queue_index;
+    uint32_t last       = --queue_cnt[prio];
+    task->queue_index   = QUEUE_NONE;
+
+    if(i == last) return;
+
+    /*Fill the hole with the last task, and move it where it belongs*/
+    lv_task_t * moved  = queue[last];
+    queue[i]           = moved;
+    moved->queue_index = i;
+    lv_task_queue_sift_up(queue, i);
+    lv_task_queue_sift_down(queue, last, moved->queue_index);
+}
+
+/**
+ * Move a task towards the head of a queue until it's in order
+ * @param queue the queue
+ * @param i index of the task
+ */
+static void lv_task_queue_sift_up(lv_task_t ** queue, uint32_t i)
+{
+    while(i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if(lv_task_is_before(queue[i], queue[parent]) == false) break;
+
+        lv_task_t * tmp              = queue[parent];
+        queue[parent]                = queue[i];
+        queue[i]                     = tmp;
+        queue[parent]->queue_index   = parent;
+        queue[i]->queue_index        = i;
+        i = parent;
+    }
+}
+
+/**
+ * Move a task towards the tail of a queue until it's in order
+ * @param queue the queue
+ * @param cnt number of tasks in the queue
+ * @param i index of the task
+ */
+static void lv_task_queue_sift_down(lv_task_t ** queue, uint32_t cnt, uint32_t i)
+{
+    for(;;) {
+        uint32_t first = i;
+        uint32_t left  = 2 * i + 1;
+        uint32_t right = 2 * i + 2;
+        if(left < cnt && lv_task_is_before(queue[left], queue[first])) first = left;
+        if(right < cnt && lv_task_is_before(queue[right], queue[first])) first = right;
+        if(first == i) break;
+
+        lv_task_t * tmp            = queue[first];
+        queue[first]               = queue[i];
+        queue[i]                   = tmp;
+        queue[first]->queue_index  = first;
+        queue[i]->queue_index      = i;
+        i = first;
+    }
+}
+
+/**
+ * Tell whether a task runs before another one of the same priority
+ * @param a pointer to a lv_task
+ * @param b pointer to a lv_task
+ * @return true: `a` is due first, or at the same time but was created first
+ */
+static bool lv_task_is_before(const lv_task_t * a, const lv_task_t * b)
+{
+    if(a->next_run != b->next_run) return a->next_run < b->next_run;
 
-    return exec;
+    return (int32_t)(a->order - b->order) < 0;
 }
@@ -31,6 +31,9 @@ extern "C" {
 #ifndef LV_ATTRIBUTE_TASK_HANDLER
 #define LV_ATTRIBUTE_TASK_HANDLER
 #endif
+
+/*Returned by `lv_task_get_time_till_next` when no task will run*/
+#define LV_NO_TASK_READY 0xFFFFFFFF
 /**********************
  *      TYPEDEFS
  **********************/
@@ -69,8 +72,16 @@ typedef struct _lv_task_t
 
     uint8_t prio : 3; /**< Task priority */
     uint8_t once : 1; /**< 1: one shot task */
+    uint8_t paused : 1; /**< 1: not run until resumed */
+
+    uint64_t next_run; /**< When the task is due, on the clock of the task module (internal) */
+    uint32_t order; /**< Creation order, to run tasks due at the same time in order (internal) */
+    uint32_t queue_index; /**< Position in the queue of its priority (internal) */
 } lv_task_t;
 
+/** Queue of the tasks of each priority, a min-heap by `next_run` (internal) */
+typedef lv_task_t ** lv_task_queues_t[_LV_TASK_PRIO_NUM];
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
@@ -87,6 +98,12 @@ void lv_task_core_init(void);
  */
 LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void);
 
+/**
+ * Handle the lv_tasks due, like `lv_task_handler`, and tell when to call it again.
+ * @return time in milliseconds until a task is due, see `lv_task_get_time_till_next`
+ */
+LV_ATTRIBUTE_TASK_HANDLER uint32_t lv_task_handler_next(void);
+
 //! @endcond
 
 /**
@@ -141,6 +158,18 @@ void lv_task_set_period(lv_task_t * task, uint32_t period);
  */
 void lv_task_ready(lv_task_t * task);
 
+/**
+ * Pause a lv_task. It won't run, whatever its period, until resumed.
+ * @param task pointer to a lv_task.
+ */
+void lv_task_pause(lv_task_t * task);
+
+/**
+ * Resume a paused lv_task. It runs as soon as its period elapsed since it last ran.
+ * @param task pointer to a lv_task.
+ */
+void lv_task_resume(lv_task_t * task);
+
 /**
  * Delete the lv_task after one call
  * @param task pointer to a lv_task.
@@ -166,6 +195,14 @@ void lv_task_enable(bool en);
  */
 uint8_t lv_task_get_idle(void);
 
+/**
+ * Get the time until a task has to run.
+ * Tasks which are paused or have `LV_TASK_PRIO_OFF` priority are not considered.
+ * `lv_task_handler` has nothing to do until then, so it's the longest the caller can sleep.
+ * @return time in milliseconds, 0 if a task is already due, `LV_NO_TASK_READY` if no task will run
+ */
+uint32_t lv_task_get_time_till_next(void);
+
 /**********************
  *      MACROS
  **********************/
@@ -1,4 +1,12 @@
 LVGL_ENV_SIMULATOR ?= 1
+# Renders in memory only, without display nor input (takes precedence)
+LVGL_ENV_HEADLESS ?= 0
+# 32 (XRGB8888) or 16 (RGB565)
+LVGL_COLOR_DEPTH ?= 32
+# Keep the pixels of the last shown screens to load them again quickly (costs memory)
+LVGL_SCR_CACHE ?= 0
+# Measure the latency from inputs to the screen (see lv_latency.h)
+LVGL_LATENCY ?= 0
 
 WARNING_FLAGS ?= \
 	-Wall \
@@ -47,6 +55,10 @@ DEBUG_FLAGS ?= -O3 -g0
 CFLAGS += $(WARNING_FLAGS) $(DEBUG_FLAGS)
 CFLAGS += -I$(LVGL_DIR)/
 CFLAGS += -DLVGL_ENV_SIMULATOR=$(LVGL_ENV_SIMULATOR)
+CFLAGS += -DLVGL_ENV_HEADLESS=$(LVGL_ENV_HEADLESS)
+CFLAGS += -DLV_COLOR_DEPTH=$(LVGL_COLOR_DEPTH)
+CFLAGS += -DLV_USE_SCR_CACHE=$(LVGL_SCR_CACHE)
+CFLAGS += -DLV_USE_LATENCY=$(LVGL_LATENCY)
 CFLAGS += -fPIC
 CFLAGS += -DVERSION=$(VERSION)
 
@@ -56,7 +68,9 @@ PKG_CONFIG ?= pkg-config
 
 LDFLAGS += -lm
 
-ifeq ($(LVGL_ENV_SIMULATOR), 1)
+ifeq ($(LVGL_ENV_HEADLESS), 1)
+# Nothing more needed.
+else ifeq ($(LVGL_ENV_SIMULATOR), 1)
 CFLAGS += $(shell $(PKG_CONFIG) --cflags sdl2)
 LDFLAGS += $(shell $(PKG_CONFIG) --libs sdl2)
 REQUIRES += sdl2
@@ -14,7 +14,4 @@
 #error HELLO_ASSETS_PATH must be defined
 #endif
 
-#define FRAME_RATE 1 / 60
-#define SECOND_AS_MICROSECONDS 1000000
-
 #endif
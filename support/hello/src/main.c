@@ -1,4 +1,3 @@
-#include <unistd.h>
 #include "conf.h"
 
 #include <hal.h>
@@ -71,6 +70,15 @@ void tbgui_app_init()
 	tbgui_theme_default();
 }
 
+static bool main_loop_cb(void * user_data)
+{
+	(void) user_data;
+
+	handle_app_actions(app);
+
+	return true;
+}
+
 int main()
 {
 	tbgui_app_init();
@@ -80,9 +88,8 @@ int main()
 
 	present_window(app->main_window);
 
-	while (true) {
-		lv_task_handler();
-		usleep(SECOND_AS_MICROSECONDS * FRAME_RATE);
-		handle_app_actions(app);
-	}
+	// Sleeps until input arrives, a frame is presented or a task is due.
+	hal_run(main_loop_cb, NULL);
+
+	return 0;
 }
@@ -10,6 +10,14 @@
 , nix-gitignore
 , SDL2
 , withSimulator ? false
+# Renders in memory only, for tests (takes precedence over the simulator)
+, withHeadless ? false
+# 32 (XRGB8888) or 16 (RGB565)
+, colorDepth ? 32
+# Keep the pixels of the last shown screens to load them again quickly (costs memory)
+, withScrCache ? false
+# Measure the latency from inputs to the screen
+, withLatency ? false
 }:
 
 let stdenv = pkgs.stdenvAdapters.keepDebugInfo pkgs.stdenv; in
@@ -21,16 +29,20 @@ let
   ];
 in
   stdenv.mkDerivation {
-    pname = "lvgui${optionalString withSimulator "-simulator"}";
+    pname = "lvgui${optionalString withSimulator "-simulator"}${optionalString withHeadless "-headless"}";
     version = "2023-02-25";
 
     src = nix-gitignore.gitignoreSource [] ../.;
 
-    # Document `LVGL_ENV_SIMULATOR` in the built headers.
+    # Document `LVGL_ENV_SIMULATOR`, `LVGL_ENV_HEADLESS`, `LV_COLOR_DEPTH`, `LV_USE_SCR_CACHE` and `LV_USE_LATENCY` in the built headers.
     # This allows the mrbgem to know about it.
     # (In reality this should be part of a ./configure step or something similar.)
     postPatch = ''
       sed -i"" '/^#define LV_CONF_H/a #define LVGL_ENV_SIMULATOR ${if withSimulator then "1" else "0"}' lv_conf.h
+      sed -i"" '/^#define LV_CONF_H/a #define LV_COLOR_DEPTH ${toString colorDepth}' lv_conf.h
+      sed -i"" '/^#define LV_CONF_H/a #define LVGL_ENV_HEADLESS ${if withHeadless then "1" else "0"}' lv_conf.h
+      sed -i"" '/^#define LV_CONF_H/a #define LV_USE_SCR_CACHE ${if withScrCache then "1" else "0"}' lv_conf.h
+      sed -i"" '/^#define LV_CONF_H/a #define LV_USE_LATENCY ${if withLatency then "1" else "0"}' lv_conf.h
     '';
 
     nativeBuildInputs = [
@@ -54,6 +66,10 @@ in
     ]
     ++ optional withSimulator "LVGL_ENV_SIMULATOR=1"
     ++ optional (!withSimulator) "LVGL_ENV_SIMULATOR=0"
+    ++ [ "LVGL_COLOR_DEPTH=${toString colorDepth}" ]
+    ++ optional withHeadless "LVGL_ENV_HEADLESS=1"
+    ++ optional withScrCache "LVGL_SCR_CACHE=1"
+    ++ optional withLatency "LVGL_LATENCY=1"
     ;
 
     enableParallelBuilding = true;